@@ -0,0 +1,1415 @@
+/*
+Title: Reflection and refraction
+File Name: Benchmarks.cpp
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+Microbenchmarks for the performance sensitive parts of the program.
+See Benchmarks.h.
+*/
+
+#include "Benchmarks.h"
+#include "SphereGenerator.h"
+#include "MeshOptimizer.h"
+#include "MeshCache.h"
+#include "MeshImporter.h"
+#include "Culling.h"
+#include "Scene.h"
+#include "DrawList.h"
+#include "CommandList.h"
+#include "UniformBuffers.h"
+#include "JobSystem.h"
+#include "CubeMapLoader.h"
+#include "TextureUploader.h"
+#include <cstdio>
+#include <thread>
+#include "glm\gtc\packing.hpp"
+#include <cmath>
+#include <iomanip>
+
+// The sphere loop as it was before SphereGenerator.cpp: sin/cos for every vertex, degrees converted at every call,
+// and vectors grown with push_back. Kept here only as the baseline for the generator benchmark.
+static void legacySphereLoop(float radius, int divisions, MeshData& mesh)
+{
+	std::vector<VertexFormat> vertexSet;
+	std::vector<GLuint> indexSet;
+
+	float DIVISIONS = (float)divisions;
+	float pitchDelta = 180 / DIVISIONS;
+	float yawDelta = 360 / DIVISIONS;
+	VertexFormat p;
+
+	for (int i = 0; i <= DIVISIONS; i++)
+	{
+		float pitch = i * pitchDelta;
+		for (int j = 0; j <= DIVISIONS; j++)
+		{
+			float yaw = j * yawDelta;
+			p.position.x = radius * sin((pitch)* PI / 180.0) * cos((yaw)* PI / 180.0);
+			p.position.y = radius * sin((pitch)* PI / 180.0) * sin((yaw)* PI / 180.0);
+			p.position.z = radius * cos((pitch)* PI / 180.0);
+			p.normal = p.position;
+			vertexSet.push_back(p);
+		}
+	}
+
+	int verticesPerRing = divisions + 1;
+	for (int i = 0; i < divisions; i++)
+	{
+		for (int j = 0; j < divisions; j++)
+		{
+			GLuint p1 = i * verticesPerRing + j;
+			GLuint p2 = p1 + 1;
+			GLuint p3 = p2 + verticesPerRing;
+			GLuint p4 = p1 + verticesPerRing;
+			indexSet.push_back(p1); indexSet.push_back(p3); indexSet.push_back(p2);
+			indexSet.push_back(p1); indexSet.push_back(p4); indexSet.push_back(p3);
+		}
+	}
+
+	mesh.vertices.swap(vertexSet);
+	mesh.indices.swap(indexSet);
+}
+
+// Runs the generator until at least minSeconds have passed and returns the best time of a single run.
+template <typename Generator>
+static double timeGenerator(Generator generate, int divisions, double minSeconds)
+{
+	double best = 1e30;
+	double start = glfwGetTime();
+	do
+	{
+		MeshData mesh;
+		double t0 = glfwGetTime();
+		generate(0.25f, divisions, mesh);
+		double t1 = glfwGetTime();
+		best = std::min(best, t1 - t0);
+	} while (glfwGetTime() - start < minSeconds);
+	return best;
+}
+
+static void legacyGenerator(float radius, int divisions, MeshData& mesh) { legacySphereLoop(radius, divisions, mesh); }
+static void tableGenerator(float radius, int divisions, MeshData& mesh) { generateUVSphere(radius, divisions, divisions, mesh); }
+
+static void benchmarkSphereGenerator()
+{
+	std::cout << "\nUV sphere generation (vertices per second, best run)\n";
+	std::cout << std::setw(10) << "divisions" << std::setw(12) << "vertices" << std::setw(16) << "legacy loop" << std::setw(16) << "table + SSE" << std::setw(10) << "speedup" << "\n";
+
+	int sizes[] = { 40, 256, 1024, 2048 };
+	for (int s = 0; s < 4; s++)
+	{
+		int divisions = sizes[s];
+		double vertices = (double)(divisions + 1) * (divisions + 1);
+		double legacy = timeGenerator(legacyGenerator, divisions, 0.5);
+		double table = timeGenerator(tableGenerator, divisions, 0.5);
+
+		std::cout << std::setw(10) << divisions << std::setw(12) << (long long)vertices
+			<< std::setw(16) << std::setprecision(4) << vertices / legacy
+			<< std::setw(16) << vertices / table
+			<< std::setw(9) << std::setprecision(3) << legacy / table << "x\n";
+	}
+}
+
+static void benchmarkSphereQuality()
+{
+	std::cout << "\nSphere tessellation quality (triangles against maximum angular error)\n";
+	std::cout << std::setw(22) << "mode" << std::setw(12) << "triangles" << std::setw(12) << "vertices" << std::setw(14) << "error (deg)" << "\n";
+
+	int divisions[] = { 8, 16, 24, 32, 40, 64, 128 };
+	for (int i = 0; i < 7; i++)
+	{
+		MeshData mesh;
+		generateSphere(SPHERE_UV, 0.25f, divisions[i], mesh);
+		std::cout << std::setw(14) << "UV divisions " << std::setw(8) << divisions[i] << std::setw(12) << mesh.indices.size() / 3
+			<< std::setw(12) << mesh.vertices.size() << std::setw(14) << std::setprecision(3) << maxAngularError(mesh) << "\n";
+	}
+	for (int n = 0; n <= 6; n++)
+	{
+		MeshData mesh;
+		generateSphere(SPHERE_ICOSPHERE, 0.25f, n, mesh);
+		std::cout << std::setw(14) << "icosphere " << std::setw(8) << n << std::setw(12) << mesh.indices.size() / 3
+			<< std::setw(12) << mesh.vertices.size() << std::setw(14) << std::setprecision(3) << maxAngularError(mesh) << "\n";
+	}
+}
+
+// Shows which level of detail is drawn, and how many triangles it costs, as the sphere moves away from the camera.
+static void benchmarkLODSelection()
+{
+	std::cout << "\nLevel of detail selection (radius 0.25, 800 pixel viewport, 1 pixel error)\n";
+	std::cout << std::setw(10) << "distance" << std::setw(14) << "radius (px)" << std::setw(16) << "UV triangles" << std::setw(18) << "ico triangles" << "\n";
+
+	glm::mat4 projection = glm::perspective(45.0f, 1.0f, 0.01f, 100.0f);
+
+	std::vector<MeshLOD> lods[2];
+	std::vector<size_t> triangles[2];
+	for (int mode = 0; mode < 2; mode++)
+	{
+		std::vector<MeshData> levels;
+		std::vector<float> errors;
+		generateSphereLODs(mode == 0 ? SPHERE_UV : SPHERE_ICOSPHERE, 0.25f, levels, errors);
+		for (size_t i = 0; i < levels.size(); i++)
+		{
+			MeshLOD lod = { 0, 0, (GLsizei)levels[i].indices.size(), errors[i] };
+			lods[mode].push_back(lod);
+			triangles[mode].push_back(levels[i].indices.size() / 3);
+		}
+	}
+
+	float distances[] = { 0.5f, 1.0f, 2.0f, 4.0f, 8.0f, 16.0f, 32.0f };
+	for (int d = 0; d < 7; d++)
+	{
+		glm::mat4 view = glm::lookAt(glm::vec3(0.0f, 0.0f, distances[d]), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+		float radius = projectedRadius(projection * view, glm::vec3(0.0f), 0.25f, 800.0f);
+		int uv = selectLOD(lods[0], radius, 0, 1.0f, 0.75f);
+		int ico = selectLOD(lods[1], radius, 0, 1.0f, 0.75f);
+		std::cout << std::setw(10) << distances[d] << std::setw(14) << std::setprecision(4) << radius
+			<< std::setw(16) << triangles[0][uv] << std::setw(18) << triangles[1][ico] << "\n";
+	}
+}
+
+// Prints the vertex cache statistics after every step of the mesh optimizer. The spheres are convex and skip the overdraw
+// step; the bumpy sphere covers parts of itself, and shows what the overdraw order costs in ACMR.
+static void benchmarkMeshOptimizer()
+{
+	struct { SphereMode mode; int detail; bool bumpy; const char* name; } meshes[] = {
+		{ SPHERE_UV, 40, false, "UV sphere, 40 divisions" },
+		{ SPHERE_UV, 256, false, "UV sphere, 256 divisions" },
+		{ SPHERE_ICOSPHERE, 4, false, "icosphere, 4 subdivisions" },
+		{ SPHERE_UV, 256, true, "bumpy UV sphere, 256 divisions" } };
+
+	for (int i = 0; i < 4; i++)
+	{
+		MeshData mesh;
+		generateSphere(meshes[i].mode, 0.25f, meshes[i].detail, mesh);
+		if (meshes[i].bumpy)
+		{
+			// Push the surface in and out along the normals, so bumps hide the valleys next to them.
+			for (size_t v = 0; v < mesh.vertices.size(); v++)
+			{
+				glm::vec3 n = mesh.vertices[v].normal;
+				float bump = 1.0f + 0.3f * sinf(12.0f * atan2f(n.z, n.x)) * sinf(12.0f * acosf(glm::clamp(n.y, -1.0f, 1.0f)));
+				mesh.vertices[v].position *= bump;
+			}
+		}
+
+		std::cout << "\nMesh optimizer: " << meshes[i].name << " (FIFO cache of 16 vertices)\n";
+		double start = glfwGetTime();
+		optimizeMesh(mesh, true, meshes[i].bumpy);
+		std::cout << "total time including the report: " << (glfwGetTime() - start) * 1000.0 << " ms\n";
+	}
+}
+
+// Reads a vertex back the way VertexShader.glsl does, to measure what the compact vertex formats lose.
+static VertexFormat decodeVertex(const unsigned char* vertex, const VertexLayout& layout)
+{
+	VertexFormat v;
+	if (layout.positionEncoding == POSITION_FLOAT)
+		memcpy(&v.position, vertex + layout.positionOffset, sizeof(v.position));
+	else
+	{
+		const GLushort* in = (const GLushort*)(vertex + layout.positionOffset);
+		for (int k = 0; k < 3; k++)
+			v.position[k] = (layout.positionEncoding == POSITION_SNORM16) ? std::max((GLshort)in[k] / 32767.0f, -1.0f) : glm::unpackHalf1x16(in[k]);
+	}
+	v.position = v.position * layout.posScale + layout.posOffset;
+
+	glm::vec3 n;
+	if (layout.normalEncoding == NORMAL_FLOAT)
+	{
+		memcpy(&v.normal, vertex + layout.normalOffset, sizeof(v.normal));
+		return v;
+	}
+	else if (layout.normalEncoding == NORMAL_INT_2_10_10_10)
+	{
+		GLuint packed;
+		memcpy(&packed, vertex + layout.normalOffset, sizeof(packed));
+		for (int k = 0; k < 3; k++)
+		{
+			int value = (packed >> (10 * k)) & 0x3FF;
+			n[k] = std::max((value >= 512 ? value - 1024 : value) / 511.0f, -1.0f);
+		}
+	}
+	else
+	{
+		glm::vec2 e;
+		if (layout.normalEncoding == NORMAL_OCT16)
+		{
+			const GLshort* in = (const GLshort*)(vertex + layout.normalOffset);
+			e = glm::vec2(std::max(in[0] / 32767.0f, -1.0f), std::max(in[1] / 32767.0f, -1.0f));
+		}
+		else
+		{
+			const GLbyte* in = (const GLbyte*)(vertex + layout.normalOffset);
+			e = glm::vec2(std::max(in[0] / 127.0f, -1.0f), std::max(in[1] / 127.0f, -1.0f));
+		}
+		n = glm::vec3(e, 1.0f - fabsf(e.x) - fabsf(e.y));
+		if (n.z < 0.0f)
+			n = glm::vec3((1.0f - fabsf(e.y)) * (e.x >= 0.0f ? 1.0f : -1.0f), (1.0f - fabsf(e.x)) * (e.y >= 0.0f ? 1.0f : -1.0f), n.z);
+	}
+	v.normal = glm::normalize(n) * layout.normalScale;
+	return v;
+}
+
+// Size and precision of every vertex format, on the vertices of the whole UV sphere LOD chain.
+static void benchmarkVertexFormats()
+{
+	std::vector<MeshData> levels;
+	std::vector<float> errors;
+	const float radius = 0.25f;
+	generateSphereLODs(SPHERE_UV, radius, levels, errors);
+	std::vector<VertexFormat> vertices;
+	for (size_t i = 0; i < levels.size(); i++)
+		vertices.insert(vertices.end(), levels[i].vertices.begin(), levels[i].vertices.end());
+
+	struct { PositionEncoding positions; NormalEncoding normals; const char* name; } formats[] = {
+		{ POSITION_FLOAT, NORMAL_FLOAT, "float + float" },
+		{ POSITION_SNORM16, NORMAL_OCT16, "snorm16 + oct16" },
+		{ POSITION_SNORM16, NORMAL_OCT8, "snorm16 + oct8" },
+		{ POSITION_SNORM16, NORMAL_INT_2_10_10_10, "snorm16 + 2_10_10_10" },
+		{ POSITION_HALF, NORMAL_OCT16, "half + oct16" } };
+
+	std::cout << "\nVertex formats: " << vertices.size() << " vertices of the UV sphere LOD chain\n";
+	std::cout << std::setw(22) << "format" << std::setw(8) << "bytes" << std::setw(12) << "buffer KB"
+		<< std::setw(18) << "position error" << std::setw(18) << "normal error deg" << std::setw(12) << "encode ms" << "\n";
+	for (int f = 0; f < 5; f++)
+	{
+		VertexLayout layout = makeVertexLayout(formats[f].positions, formats[f].normals);
+		std::vector<unsigned char> data;
+		double start = glfwGetTime();
+		encodeVertices(&vertices[0], (int)vertices.size(), layout, data);
+		double encodeTime = glfwGetTime() - start;
+
+		double positionError = 0.0, normalError = 0.0;
+		for (size_t i = 0; i < vertices.size(); i++)
+		{
+			VertexFormat v = decodeVertex(&data[i * layout.stride], layout);
+			positionError = std::max(positionError, (double)glm::length(v.position - vertices[i].position));
+			// In double precision, acos of a float close to 1 is not precise enough for these angles.
+			double cosine = glm::dot(glm::normalize(glm::dvec3(v.normal)), glm::normalize(glm::dvec3(vertices[i].normal)));
+			normalError = std::max(normalError, acos(glm::clamp(cosine, -1.0, 1.0)) * 180.0 / PI);
+		}
+
+		std::cout << std::setw(22) << formats[f].name << std::setw(8) << layout.stride << std::setw(12) << std::setprecision(4) << data.size() / 1024.0
+			<< std::setw(18) << positionError / radius << std::setw(18) << normalError << std::setw(12) << encodeTime * 1000.0 << "\n";
+	}
+	std::cout << "(position error is relative to the radius)\n";
+}
+
+// Building a mesh from scratch against loading it from the mesh cache. The copy out of the mapped file stands in for glBufferData.
+static void benchmarkMeshCache()
+{
+	struct { bool lod; int divisions; const char* name; } meshes[] = {
+		{ true, 0, "UV sphere LOD chain" },
+		{ false, 512, "UV sphere, 512 divisions" } };
+
+	std::cout << "\nMesh cache (snorm16 + oct16 vertices)\n";
+	std::cout << std::setw(26) << "mesh" << std::setw(12) << "file KB" << std::setw(14) << "generate ms" << std::setw(12) << "write ms" << std::setw(12) << "load ms" << "\n";
+	for (int m = 0; m < 2; m++)
+	{
+		double start = glfwGetTime();
+		std::vector<MeshData> levels;
+		std::vector<float> errors;
+		if (meshes[m].lod)
+			generateSphereLODs(SPHERE_UV, 0.25f, levels, errors);
+		else
+		{
+			levels.resize(1);
+			errors.push_back(0.0f);
+			generateUVSphere(0.25f, meshes[m].divisions, meshes[m].divisions, levels[0]);
+		}
+		for (size_t i = 0; i < levels.size(); i++)
+			optimizeMesh(levels[i], false, false);
+		PackedMesh packed;
+		packMesh(levels, errors, POSITION_SNORM16, NORMAL_OCT16, packed);
+		double generateTime = glfwGetTime() - start;
+
+		std::string name = "benchmark_" + std::to_string(m);
+		start = glfwGetTime();
+		writeMeshCache(name, packed.view());
+		double writeTime = glfwGetTime() - start;
+
+		start = glfwGetTime();
+		MappedFile file;
+		MeshView mesh;
+		std::vector<unsigned char> destination(packed.vertexData.size() + packed.indexData.size());
+		bool loaded = mapMeshCache(name, file, mesh);
+		if (loaded)
+		{
+			memcpy(&destination[0], mesh.vertexData, packed.vertexData.size());
+			memcpy(&destination[packed.vertexData.size()], mesh.indexData, packed.indexData.size());
+		}
+		double loadTime = glfwGetTime() - start;
+		size_t fileSize = file.size;
+		file.close();
+		remove(meshCachePath(name).c_str());
+
+		if (!loaded || memcmp(&destination[0], &packed.vertexData[0], packed.vertexData.size()) != 0)
+		{
+			std::cout << std::setw(26) << meshes[m].name << "  could not be written to " << MESH_CACHE_DIRECTORY << "\n";
+			continue;
+		}
+		std::cout << std::setw(26) << meshes[m].name << std::setw(12) << std::setprecision(5) << fileSize / 1024.0 << std::setw(14) << generateTime * 1000.0
+			<< std::setw(12) << writeTime * 1000.0 << std::setw(12) << loadTime * 1000.0 << "\n";
+	}
+}
+
+// Writes a valid cache file, then copies of it with one thing broken, and checks that mapMeshCache rejects every broken copy.
+static void checkMeshCacheValidation()
+{
+	std::vector<MeshData> levels;
+	std::vector<float> errors;
+	generateSphereLODs(SPHERE_UV, 0.25f, levels, errors);
+	PackedMesh packed;
+	packMesh(levels, errors, POSITION_SNORM16, NORMAL_OCT16, packed);
+
+	std::cout << "\nMesh cache validation\n";
+	std::string name = "validation";
+	std::vector<unsigned char> original;
+	{
+		MappedFile file;
+		MeshView mesh;
+		if (!writeMeshCache(name, packed.view()) || !mapMeshCache(name, file, mesh))
+		{
+			std::cout << "could not write to " << MESH_CACHE_DIRECTORY << "\n";
+			return;
+		}
+		original.assign(file.data, file.data + file.size);
+	}
+
+	const char* corruptions[] = {
+		"truncated in the LOD table",
+		"last level past the end of the index blob",
+		"first index past the end of the index blob",
+		"base vertex past the end of the vertex blob",
+		"negative base vertex",
+		"stride of another layout",
+		"normal offset of another layout",
+		"unknown normal encoding",
+		"index past the last vertex",
+		"index offset which wraps around",
+		"LOD offset which wraps around" };
+	const int count = sizeof(corruptions) / sizeof(corruptions[0]);
+	int rejected = 0;
+	for (int c = 0; c < count; c++)
+	{
+		std::vector<unsigned char> bytes = original;
+		MeshCacheHeader* header = (MeshCacheHeader*)bytes.data();
+		MeshLOD* lods = (MeshLOD*)(bytes.data() + header->lodOffset);
+		MeshLOD& last = lods[header->lodCount - 1];
+		switch (c)
+		{
+		case 0:
+			header->fileSize = header->lodOffset + sizeof(MeshLOD) / 2;
+			bytes.resize((size_t)header->fileSize);
+			break;
+		case 1: last.indexCount += 3; break;
+		case 2: lods[0].firstIndex = header->indexCount; break;
+		case 3: last.baseVertex = header->vertexCount; break;
+		case 4: last.baseVertex = -1; break;
+		case 5: header->stride += 4; break;
+		case 6: header->normalOffset = 2; break;
+		case 7: header->normalEncoding = NORMAL_INT_2_10_10_10 + 1; break;
+		case 8:
+			// The first index of the finest level, which reaches one vertex past the end with its base vertex.
+			if (header->indexType == GL_UNSIGNED_SHORT)
+				((GLushort*)(bytes.data() + header->indexOffset))[last.firstIndex] = (GLushort)(header->vertexCount - last.baseVertex);
+			else
+				((GLuint*)(bytes.data() + header->indexOffset))[last.firstIndex] = (GLuint)(header->vertexCount - last.baseVertex);
+			break;
+		case 9: header->indexOffset = 0ULL - (unsigned long long)header->indexCount * (header->indexType == GL_UNSIGNED_SHORT ? 2 : 4); break;
+		case 10: header->lodOffset = 0ULL - (unsigned long long)header->lodCount * sizeof(MeshLOD); break;
+		}
+
+		FILE* out = fopen(meshCachePath(name).c_str(), "wb");
+		if (out == NULL)
+			break;
+		fwrite(bytes.data(), 1, bytes.size(), out);
+		fclose(out);
+
+		MappedFile file;
+		MeshView mesh;
+		bool accepted = mapMeshCache(name, file, mesh);
+		rejected += accepted ? 0 : 1;
+		std::cout << std::setw(46) << corruptions[c] << (accepted ? "  ACCEPTED" : "  rejected") << "\n";
+	}
+	remove(meshCachePath(name).c_str());
+	std::cout << rejected << " of " << count << " broken files rejected\n";
+}
+
+// Writes the mesh as an OBJ file, with or without normals.
+static void writeObj(const char* path, const MeshData& mesh, bool normals)
+{
+	FILE* out = fopen(path, "w");
+	if (out == NULL)
+		return;
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+		fprintf(out, "v %.6f %.6f %.6f\n", mesh.vertices[i].position.x, mesh.vertices[i].position.y, mesh.vertices[i].position.z);
+	if (normals)
+		for (size_t i = 0; i < mesh.vertices.size(); i++)
+			fprintf(out, "vn %.6f %.6f %.6f\n", mesh.vertices[i].normal.x, mesh.vertices[i].normal.y, mesh.vertices[i].normal.z);
+	for (size_t i = 0; i < mesh.indices.size(); i += 3)
+	{
+		if (normals)
+			fprintf(out, "f %u//%u %u//%u %u//%u\n", mesh.indices[i] + 1, mesh.indices[i] + 1, mesh.indices[i + 1] + 1, mesh.indices[i + 1] + 1, mesh.indices[i + 2] + 1, mesh.indices[i + 2] + 1);
+		else
+			fprintf(out, "f %u %u %u\n", mesh.indices[i] + 1, mesh.indices[i + 1] + 1, mesh.indices[i + 2] + 1);
+	}
+	fclose(out);
+}
+
+// Writes the mesh as a binary PLY file with positions and normals.
+static void writePly(const char* path, const MeshData& mesh)
+{
+	FILE* out = fopen(path, "wb");
+	if (out == NULL)
+		return;
+	unsigned int one = 1;
+	fprintf(out, "ply\nformat %s 1.0\n", (*(unsigned char*)&one == 1) ? "binary_little_endian" : "binary_big_endian");
+	fprintf(out, "element vertex %u\nproperty float x\nproperty float y\nproperty float z\n", (unsigned int)mesh.vertices.size());
+	fprintf(out, "property float nx\nproperty float ny\nproperty float nz\n");
+	fprintf(out, "element face %u\nproperty list uchar int vertex_indices\nend_header\n", (unsigned int)(mesh.indices.size() / 3));
+	fwrite(&mesh.vertices[0], sizeof(VertexFormat), mesh.vertices.size(), out);
+	for (size_t i = 0; i < mesh.indices.size(); i += 3)
+	{
+		unsigned char count = 3;
+		fwrite(&count, 1, 1, out);
+		fwrite(&mesh.indices[i], sizeof(GLuint), 3, out);
+	}
+	fclose(out);
+}
+
+// Writes the mesh as an OBJ file whose faces use relative (negative) indices. With interleaved, every triangle writes its own
+// three positions right before it (f -3 -2 -1); otherwise all the positions come first and the faces point far back.
+static void writeRelativeObj(const char* path, const MeshData& mesh, bool interleaved)
+{
+	FILE* out = fopen(path, "w");
+	if (out == NULL)
+		return;
+	int count = (int)mesh.vertices.size();
+	if (!interleaved)
+		for (size_t i = 0; i < mesh.vertices.size(); i++)
+			fprintf(out, "v %.6f %.6f %.6f\n", mesh.vertices[i].position.x, mesh.vertices[i].position.y, mesh.vertices[i].position.z);
+	for (size_t i = 0; i < mesh.indices.size(); i += 3)
+	{
+		if (!interleaved)
+		{
+			fprintf(out, "f %d %d %d\n", (int)mesh.indices[i] - count, (int)mesh.indices[i + 1] - count, (int)mesh.indices[i + 2] - count);
+			continue;
+		}
+		for (int k = 0; k < 3; k++)
+		{
+			const glm::vec3& p = mesh.vertices[mesh.indices[i + k]].position;
+			fprintf(out, "v %.6f %.6f %.6f\n", p.x, p.y, p.z);
+		}
+		fprintf(out, "f -3 -2 -1\n");
+	}
+	fclose(out);
+}
+
+// Relative OBJ indices which point back past the start of the chunk they are read in: the triangles have to come out the same
+// as from the file with absolute indices, whatever the number of chunks the file is cut into.
+static void checkObjRelativeIndices()
+{
+	MeshData sphere;
+	generateUVSphere(0.25f, 64, 64, sphere);
+	writeObj("importer_absolute.obj", sphere, false);
+	writeRelativeObj("importer_relative.obj", sphere, false);
+	writeRelativeObj("importer_interleaved.obj", sphere, true);
+
+	std::cout << "\nOBJ relative indices, compared with absolute indices\n";
+	MeshData expected;
+	if (!importMesh("importer_absolute.obj", expected, 1))
+		std::cout << "importer_absolute.obj  import failed\n";
+	const char* files[] = { "importer_relative.obj", "importer_interleaved.obj" };
+	for (int f = 0; f < 2 && !expected.indices.empty(); f++)
+	{
+		std::cout << std::setw(28) << files[f];
+		for (int threads = 1; threads <= 8; threads++)
+		{
+			MeshData mesh;
+			bool same = importMesh(files[f], mesh, threads) && mesh.indices.size() == expected.indices.size();
+			for (size_t i = 0; same && i < mesh.indices.size(); i++)
+				same = mesh.vertices[mesh.indices[i]].position == expected.vertices[expected.indices[i]].position;
+			std::cout << "  " << threads << (same ? " ok" : " FAILED");
+		}
+		std::cout << "\n";
+	}
+	remove("importer_absolute.obj");
+	remove("importer_relative.obj");
+	remove("importer_interleaved.obj");
+}
+
+// Import throughput of the OBJ and PLY readers for 1, 2, 4... threads, up to the number of hardware threads.
+static void benchmarkMeshImporter()
+{
+	MeshData sphere;
+	generateUVSphere(0.25f, 512, 512, sphere);
+	writeObj("importer_benchmark.obj", sphere, true);
+	writeObj("importer_benchmark_no_normals.obj", sphere, false);
+	writePly("importer_benchmark.ply", sphere);
+
+	const char* files[] = { "importer_benchmark.obj", "importer_benchmark_no_normals.obj", "importer_benchmark.ply" };
+	int hardwareThreads = std::max(1, (int)std::thread::hardware_concurrency());
+
+	std::cout << "\nMesh importer: UV sphere, 512 divisions (" << sphere.indices.size() / 3 << " triangles), "
+		<< hardwareThreads << " hardware threads\n";
+	std::cout << std::setw(36) << "file" << std::setw(10) << "threads" << std::setw(10) << "MB" << std::setw(12) << "ms" << std::setw(10) << "MB/s" << "\n";
+	for (int f = 0; f < 3; f++)
+	{
+		for (int threads = 1; ; threads = std::min(threads * 2, hardwareThreads))
+		{
+			MeshData mesh;
+			ImportStats stats;
+			if (!importMesh(files[f], mesh, threads, &stats) || mesh.indices.size() != sphere.indices.size())
+			{
+				std::cout << std::setw(36) << files[f] << "  import failed\n";
+				break;
+			}
+			std::cout << std::setw(36) << files[f] << std::setw(10) << threads << std::setw(10) << std::setprecision(4) << stats.fileBytes / (1024.0 * 1024.0)
+				<< std::setw(12) << stats.seconds * 1000.0 << std::setw(10) << stats.megabytesPerSecond() << (stats.generatedNormals ? "  (normals generated)" : "") << "\n";
+			if (threads == hardwareThreads)
+				break;
+		}
+		remove(files[f]);
+	}
+}
+
+// Frustum culling of a million bounding spheres, one at a time and 4 or 8 at a time, in ms per million spheres.
+static void benchmarkFrustumCulling()
+{
+	const int count = 1000000;
+	SphereBounds bounds;
+	bounds.resize(count);
+	srand(1);
+	for (int i = 0; i < count; i++)
+	{
+		glm::vec3 center(rand() / (float)RAND_MAX * 20.0f - 10.0f, rand() / (float)RAND_MAX * 20.0f - 10.0f, -rand() / (float)RAND_MAX * 40.0f);
+		bounds.set(i, center, 0.02f + rand() / (float)RAND_MAX * 0.2f);
+	}
+
+	// The camera of the demo, and the same camera turned to the side and up, so different parts of the spheres are visible.
+	glm::mat4 PV = glm::perspective(45.0f, 1.0f, 0.01f, 100.0f) * glm::lookAt(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::mat4 views[3] = { PV, PV * glm::rotate(glm::mat4(1), 0.6f, glm::vec3(0.0f, 1.0f, 0.0f)), PV * glm::rotate(glm::mat4(1), 0.4f, glm::vec3(1.0f, 0.0f, 0.0f)) };
+
+	const char* names[] = { "scalar", "SSE", "AVX" };
+	CullingKernel kernels[] = { CULL_SCALAR, CULL_SSE, CULL_AVX };
+#ifdef __AVX__
+	int kernelCount = 3;
+#else
+	int kernelCount = 2;		// AVX is not compiled in, CULL_AVX would run the SSE code again
+#endif
+
+	std::cout << "\nFrustum culling: " << count << " bounding spheres\n";
+	std::cout << std::setw(8) << "view" << std::setw(10) << "kernel" << std::setw(10) << "visible" << std::setw(12) << "ms/million" << std::setw(10) << "speedup" << "\n";
+	std::vector<GLuint> reference, visible;
+	for (int v = 0; v < 3; v++)
+	{
+		glm::vec4 planes[6];
+		frustumPlanes(views[v], planes);
+		double scalarTime = 0.0;
+		for (int k = 0; k < kernelCount; k++)
+		{
+			const int repeats = 10;
+			double start = glfwGetTime();
+			for (int r = 0; r < repeats; r++)
+				cullSpheres(planes, bounds, visible, kernels[k]);
+			double seconds = (glfwGetTime() - start) / repeats;
+			if (k == 0)
+			{
+				scalarTime = seconds;
+				reference = visible;
+			}
+
+			std::cout << std::setw(8) << v << std::setw(10) << names[k] << std::setw(10) << visible.size()
+				<< std::setw(12) << std::setprecision(4) << seconds * 1000.0 * 1000000.0 / count << std::setw(10) << scalarTime / seconds
+				<< (visible != reference ? "  (differs from scalar)" : "") << "\n";
+		}
+	}
+}
+
+// The sphere struct main.cpp used before Scene.h: every object carries its matrix, position and the whole stuff_for_drawing.
+struct LegacySphere
+{
+	glm::mat4 Translation;
+	glm::vec3 origin;
+	float radius;
+	int lod;
+	GLuint lightingtype;
+	stuff_for_drawing base;
+};
+
+// Moving every object, recomputing the world matrices and going over the bounding spheres for the level of detail,
+// with one struct per object against the component arrays of Scene.
+static void benchmarkScene()
+{
+	const int count = 100000;
+	const int repeats = 20;
+	glm::mat4 PV = glm::perspective(45.0f, 1.0f, 0.01f, 100.0f) * glm::lookAt(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	std::vector<LegacySphere> legacy(count);
+	Scene scene;
+	std::vector<ObjectHandle> handles(count);
+	for (int i = 0; i < count; i++)
+	{
+		glm::vec3 position((float)(i % 100) * 0.1f - 5.0f, (float)(i / 100 % 100) * 0.1f - 5.0f, -(float)(i / 10000));
+		legacy[i].origin = position;
+		legacy[i].radius = 0.05f;
+		legacy[i].lod = 0;
+		handles[i] = scene.create(NO_MESH, position, 0.05f, glm::vec4(0.5f, 0.2f, 0.75f, 0.5f));
+	}
+
+	// Destroying and creating objects keeps the arrays packed, and the handles of the destroyed objects stop working.
+	for (int i = 0; i < count; i += 2)
+		scene.destroy(handles[i]);
+	bool handlesValid = scene.size() == count / 2 && scene.indexOf(handles[0]) < 0 && scene.indexOf(handles[1]) >= 0
+		&& scene.positions[scene.indexOf(handles[count - 1])] == legacy[count - 1].origin;
+	for (int i = 0; i < count; i += 2)
+		handles[i] = scene.create(NO_MESH, legacy[i].origin, 0.05f, glm::vec4(0.5f, 0.2f, 0.75f, 0.5f));
+	handlesValid = handlesValid && scene.size() == count && scene.positions[scene.indexOf(handles[0])] == legacy[0].origin;
+
+	float checksum[2] = { 0.0f, 0.0f };
+	double start = glfwGetTime();
+	for (int r = 0; r < repeats; r++)
+	{
+		glm::vec3 offset(0.001f * r, 0.0f, 0.0f);
+		for (int i = 0; i < count; i++)
+		{
+			legacy[i].origin += offset;
+			legacy[i].Translation = glm::translate(glm::mat4(1), legacy[i].origin);
+		}
+		for (int i = 0; i < count; i++)
+			checksum[0] += projectedRadius(PV, legacy[i].origin, legacy[i].radius, 800.0f);
+	}
+	double legacyTime = (glfwGetTime() - start) / repeats;
+
+	start = glfwGetTime();
+	for (int r = 0; r < repeats; r++)
+	{
+		glm::vec3 offset(0.001f * r, 0.0f, 0.0f);
+		for (int i = 0; i < count; i++)
+		{
+			scene.positions[i] += offset;
+			scene.dirty[i] = 1;
+		}
+		scene.updateWorldMatrices();
+		for (int i = 0; i < scene.size(); i++)
+			checksum[1] += projectedRadius(PV, scene.positions[i], scene.radii[i], 800.0f);
+	}
+	double sceneTime = (glfwGetTime() - start) / repeats;
+
+	std::cout << "\nScene update: " << count << " objects, " << sizeof(LegacySphere) << " bytes per legacy sphere"
+		<< (handlesValid ? "" : ", HANDLES BROKEN") << "\n";
+	std::cout << std::setw(24) << "layout" << std::setw(12) << "ms/frame" << std::setw(14) << "checksum" << "\n";
+	std::cout << std::setw(24) << "struct per object" << std::setw(12) << std::setprecision(4) << legacyTime * 1000.0 << std::setw(14) << checksum[0] << "\n";
+	std::cout << std::setw(24) << "component arrays" << std::setw(12) << sceneTime * 1000.0 << std::setw(14) << checksum[1] << "\n";
+}
+
+static bool compareSortEntries(const SortEntry& a, const SortEntry& b) { return a.key < b.key; }
+
+// Radix sort of the draw keys against std::sort, and the state changes of a draw list in the order it was built against sorted.
+static void benchmarkDrawList()
+{
+	const int count = 100000;
+	const int repeats = 20;
+
+	// Draws of a scene built object by object: 4 programs, 2 cube maps and 64 meshes, in no particular order.
+	DrawList list;
+	CommandList commands;
+	std::vector<float> distances(count);
+	srand(1);
+	for (int i = 0; i < count; i++)
+	{
+		RenderPass pass = i % 10 == 0 ? PASS_TRANSPARENT : PASS_OPAQUE;
+		distances[i] = rand() / (float)RAND_MAX * list.farDistance;
+		size_t begin = commands.size();
+		commands.draw(GL_TRIANGLES, 0, 3);
+		list.add(pass, 1 + rand() % 4, 1 + rand() % 2, 1 + rand() % 64, distances[i], commands, begin);
+	}
+	DrawStats unsorted = list.countStateChanges();
+	std::vector<SortEntry> unsortedOrder = list.order;
+
+	std::vector<SortEntry> entries, scratch;
+	double start = glfwGetTime();
+	for (int r = 0; r < repeats; r++)
+	{
+		entries = unsortedOrder;
+		radixSort(entries, scratch);
+	}
+	double radixTime = (glfwGetTime() - start) / repeats;
+
+	std::vector<SortEntry> reference;
+	start = glfwGetTime();
+	for (int r = 0; r < repeats; r++)
+	{
+		reference = unsortedOrder;
+		std::stable_sort(reference.begin(), reference.end(), compareSortEntries);
+	}
+	double stdTime = (glfwGetTime() - start) / repeats;
+
+	bool same = true;
+	for (int i = 0; i < count; i++)
+		same = same && entries[i].index == reference[i].index;
+
+	list.sort();
+	DrawStats sorted = list.countStateChanges();
+
+	// The opaque draws should go front to back within the same state, the transparent ones back to front whatever their state.
+	// The transparent draws are the ones added at multiples of 10, and they come after all the opaque ones.
+	int wrongOrder = 0;
+	for (int i = 1; i < count; i++)
+	{
+		int a = list.order[i - 1].index;
+		int b = list.order[i].index;
+		const DrawCommand& first = list.commands[a];
+		const DrawCommand& second = list.commands[b];
+		bool sameState = first.program == second.program && first.texture == second.texture && first.vao == second.vao;
+		if (a % 10 != 0 && b % 10 != 0 && sameState && distances[a] > distances[b] + 0.0001f)
+			wrongOrder++;
+		if (a % 10 == 0 && (b % 10 != 0 || distances[a] + 0.0001f < distances[b]))
+			wrongOrder++;
+	}
+
+	std::cout << "\nDraw list: " << count << " draws, 4 programs, 2 cube maps, 64 VAOs, 10% transparent\n";
+	std::cout << std::setw(16) << "sort" << std::setw(12) << "ms" << "\n";
+	std::cout << std::setw(16) << "radix" << std::setw(12) << std::setprecision(4) << radixTime * 1000.0 << (same ? "" : "  (differs from std::stable_sort)") << "\n";
+	std::cout << std::setw(16) << "std::stable_sort" << std::setw(12) << stdTime * 1000.0 << "\n";
+	std::cout << std::setw(16) << "order" << std::setw(12) << "programs" << std::setw(12) << "textures" << std::setw(12) << "VAOs" << "\n";
+	std::cout << std::setw(16) << "as built" << std::setw(12) << unsorted.programChanges << std::setw(12) << unsorted.textureChanges << std::setw(12) << unsorted.vaoChanges << "\n";
+	std::cout << std::setw(16) << "sorted" << std::setw(12) << sorted.programChanges << std::setw(12) << sorted.textureChanges << std::setw(12) << sorted.vaoChanges
+		<< (wrongOrder ? "  (DEPTH ORDER WRONG)" : "") << "\n";
+}
+
+// Records the draws of objects first to last - 1 the way renderScene() does: object uniforms, level of detail, a uniform range and a draw.
+static void recordBenchmarkObjects(const std::vector<glm::vec3>& positions, const std::vector<MeshLOD>& lods, const glm::mat4& PV,
+	std::vector<ObjectUniforms>& uniforms, std::vector<int>& levels, CommandList& commands, DrawList& draws, int first, int last)
+{
+	for (int i = first; i < last; i++)
+	{
+		ObjectUniforms& object = uniforms[i];
+		object.translation = glm::translate(glm::mat4(1), positions[i]);
+		object.material = glm::vec4(0.5f, 0.2f, 0.75f, 0.5f);
+		object.center = positions[i];
+		object.radius = 0.25f;
+
+		size_t begin = commands.size();
+		commands.bindUniformBuffer(1, 1, i * sizeof(ObjectUniforms), sizeof(ObjectUniforms));
+		levels[i] = selectLOD(lods, projectedRadius(PV, positions[i], 0.25f, 800.0f), levels[i], 1.0f, 0.75f);
+		const MeshLOD& lod = lods[levels[i]];
+		commands.drawIndexed(GL_TRIANGLES, lod.indexCount, GL_UNSIGNED_SHORT, lod.firstIndex, lod.baseVertex);
+		draws.add(PASS_OPAQUE, 1 + i % 4, 1, 1 + i % 64, glm::length(positions[i] - glm::vec3(0.0f, 0.0f, 2.0f)), commands, begin);
+	}
+}
+
+// Recording the draws of many objects on several threads, each into its own command list, then appending and sorting the lists on one thread.
+// The sorted commands have to be the same bytes whatever the number of threads.
+static void benchmarkCommandRecording()
+{
+	const int count = 100000;
+	const int repeats = 10;
+
+	std::vector<glm::vec3> positions(count);
+	srand(1);
+	for (int i = 0; i < count; i++)
+		positions[i] = glm::vec3(rand() / (float)RAND_MAX * 8.0f - 4.0f, rand() / (float)RAND_MAX * 8.0f - 4.0f, -2.0f - rand() / (float)RAND_MAX * 20.0f);
+	std::vector<MeshData> levels;
+	std::vector<float> errors;
+	generateSphereLODs(SPHERE_UV, 0.25f, levels, errors);
+	PackedMesh packed;
+	packMesh(levels, errors, POSITION_SNORM16, NORMAL_OCT16, packed);
+	std::vector<MeshLOD>& lods = packed.lods;
+	glm::mat4 PV = glm::perspective(45.0f, 1.0f, 0.01f, 100.0f) * glm::lookAt(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+
+	// At least 4, so the merged lists are checked even where there is only one hardware thread.
+	int maxThreads = std::max(4, (int)std::thread::hardware_concurrency());
+	std::cout << "\nCommand recording: " << count << " objects, recorded on worker threads and sorted on one\n";
+	std::cout << std::setw(10) << "threads" << std::setw(14) << "record ms" << std::setw(14) << "merge ms" << std::setw(14) << "bytes" << "\n";
+
+	std::vector<unsigned char> reference;
+	for (int threadCount = 1; threadCount <= maxThreads; threadCount *= 2)
+	{
+		std::vector<CommandList> commands(threadCount);
+		std::vector<DrawList> draws(threadCount);
+		std::vector<ObjectUniforms> uniforms(count);
+		std::vector<int> lodLevels(count, 0);
+		DrawList merged;
+		double recordTime = 0.0, mergeTime = 0.0;
+		for (int r = 0; r < repeats; r++)
+		{
+			double start = glfwGetTime();
+			for (int t = 0; t < threadCount; t++)
+			{
+				commands[t].clear();
+				draws[t].clear();
+			}
+			std::vector<std::thread> threads;
+			for (int t = 1; t < threadCount; t++)
+				threads.push_back(std::thread(recordBenchmarkObjects, std::cref(positions), std::cref(lods), std::cref(PV), std::ref(uniforms), std::ref(lodLevels),
+					std::ref(commands[t]), std::ref(draws[t]), count * t / threadCount, count * (t + 1) / threadCount));
+			recordBenchmarkObjects(positions, lods, PV, uniforms, lodLevels, commands[0], draws[0], 0, count / threadCount);
+			for (size_t t = 0; t < threads.size(); t++)
+				threads[t].join();
+			recordTime += glfwGetTime() - start;
+
+			start = glfwGetTime();
+			merged.clear();
+			for (int t = 0; t < threadCount; t++)
+				merged.append(draws[t]);
+			merged.sort();
+			mergeTime += glfwGetTime() - start;
+		}
+
+		// The commands in the order they would be replayed.
+		std::vector<unsigned char> replayed;
+		size_t bytes = 0;
+		for (size_t i = 0; i < merged.order.size(); i++)
+		{
+			const DrawCommand& draw = merged.commands[merged.order[i].index];
+			replayed.insert(replayed.end(), draw.commands->data.begin() + draw.begin, draw.commands->data.begin() + draw.end);
+		}
+		for (int t = 0; t < threadCount; t++)
+			bytes += commands[t].size();
+		if (threadCount == 1)
+			reference = replayed;
+
+		std::cout << std::setw(10) << threadCount << std::setw(14) << std::setprecision(4) << recordTime / repeats * 1000.0
+			<< std::setw(14) << mergeTime / repeats * 1000.0 << std::setw(14) << bytes << (replayed == reference ? "" : "  (COMMANDS DIFFER)") << "\n";
+	}
+}
+
+// More jobs in flight than the ring of a thread holds, with one job kept live the whole time, which the ring has to go around.
+static void checkJobPool()
+{
+	const int count = 3 * JOB_POOL_SIZE;
+	std::cout << "\nJob pool: " << count << " jobs in flight, " << JOB_POOL_SIZE << " per thread\n";
+	for (int threadCount = 1; threadCount <= 4; threadCount *= 2)
+	{
+		JobSystem jobs;
+		jobs.start(threadCount);
+		std::atomic<int> ran(0);
+		std::atomic<int> heldRan(0);
+		Job* held = jobs.create([&]() { heldRan++; });
+		Job* parent = jobs.create(std::function<void()>());
+		for (int i = 0; i < count; i++)
+			jobs.run(jobs.create([&]() { ran++; }, parent));
+		jobs.run(parent);
+		jobs.wait(parent);
+		jobs.run(held);
+		jobs.wait(held);
+		bool ok = ran == count && heldRan == 1;
+		std::cout << std::setw(10) << threadCount << " threads  " << (ok ? "ok" : "FAILED") << "\n";
+	}
+}
+
+// The data of one part of the scene in benchmarkJobSystem.
+struct BenchmarkPart
+{
+	std::vector<GLuint> visible;
+	CommandList commands;
+	DrawList draws;
+};
+
+// The CPU side of a frame of 100000 objects as jobs: update the world matrices, cull, record and sort, each step waiting for the one before,
+// on more and more threads. The sorted commands have to be the same bytes whatever the number of threads.
+static void benchmarkJobSystem()
+{
+	const int count = 100000;
+	const int perJob = 1024;
+	const int repeats = 10;
+	int partCount = (count + perJob - 1) / perJob;
+
+	Scene scene;
+	srand(1);
+	for (int i = 0; i < count; i++)
+	{
+		glm::vec3 position(rand() / (float)RAND_MAX * 8.0f - 4.0f, rand() / (float)RAND_MAX * 8.0f - 4.0f, 2.0f - rand() / (float)RAND_MAX * 24.0f);
+		scene.create(NO_MESH, position, 0.25f, glm::vec4(0.5f, 0.2f, 0.75f, 0.5f));
+	}
+	glm::mat4 PV = glm::perspective(45.0f, 1.0f, 0.01f, 100.0f) * glm::lookAt(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	glm::vec4 planes[6];
+	frustumPlanes(PV, planes);
+
+	int maxThreads = std::max(4, (int)std::thread::hardware_concurrency());
+	std::cout << "\nJob system: update, cull, record and sort " << count << " objects, " << perJob << " per job\n";
+	std::cout << std::setw(10) << "threads" << std::setw(12) << "ms/frame" << std::setw(12) << "visible" << "\n";
+
+	std::vector<unsigned char> reference;
+	for (int threadCount = 1; threadCount <= maxThreads; threadCount *= 2)
+	{
+		JobSystem jobs;
+		jobs.start(threadCount);
+		std::vector<BenchmarkPart> parts(partCount);
+		std::vector<ObjectUniforms> uniforms(count);
+		DrawList drawList;
+
+		double start = glfwGetTime();
+		for (int r = 0; r < repeats; r++)
+		{
+			// Every object moved.
+			std::fill(scene.dirty.begin(), scene.dirty.end(), 1);
+
+			Job* update = jobs.parallelFor(count, perJob, [&](int first, int last)
+			{
+				scene.updateWorldMatrices(first, last);
+			});
+			Job* cull = jobs.parallelFor(partCount, 1, [&](int first, int last)
+			{
+				for (int p = first; p < last; p++)
+					cullSpheres(planes, scene.bounds, p * perJob, std::min(count, (p + 1) * perJob), parts[p].visible);
+			});
+			Job* record = jobs.parallelFor(partCount, 1, [&](int first, int last)
+			{
+				for (int p = first; p < last; p++)
+				{
+					BenchmarkPart& part = parts[p];
+					part.commands.clear();
+					part.draws.clear();
+					for (size_t v = 0; v < part.visible.size(); v++)
+					{
+						int i = part.visible[v];
+						uniforms[i].translation = scene.worldMatrices[i];
+						uniforms[i].material = scene.materials[i];
+						size_t begin = part.commands.size();
+						part.commands.bindUniformBuffer(1, 1, i * sizeof(ObjectUniforms), sizeof(ObjectUniforms));
+						part.commands.drawIndexed(GL_TRIANGLES, 960, GL_UNSIGNED_SHORT, 0, 0);
+						part.draws.add(PASS_OPAQUE, 1 + i % 4, 1, 1 + i % 64, glm::length(scene.positions[i] - glm::vec3(0.0f, 0.0f, 2.0f)), part.commands, begin);
+					}
+				}
+			});
+			Job* sort = jobs.create([&]()
+			{
+				drawList.clear();
+				for (int p = 0; p < partCount; p++)
+					drawList.append(parts[p].draws);
+				drawList.sort();
+			});
+			jobs.addDependency(cull, update);
+			jobs.addDependency(record, cull);
+			jobs.addDependency(sort, record);
+			jobs.run(update);
+			jobs.run(cull);
+			jobs.run(record);
+			jobs.run(sort);
+			jobs.wait(sort);
+		}
+		double time = (glfwGetTime() - start) / repeats;
+
+		std::vector<unsigned char> replayed;
+		for (size_t i = 0; i < drawList.order.size(); i++)
+		{
+			const DrawCommand& draw = drawList.commands[drawList.order[i].index];
+			replayed.insert(replayed.end(), draw.commands->data.begin() + draw.begin, draw.commands->data.begin() + draw.end);
+		}
+		if (threadCount == 1)
+			reference = replayed;
+
+		std::cout << std::setw(10) << threadCount << std::setw(12) << std::setprecision(4) << time * 1000.0 << std::setw(12) << drawList.commands.size()
+			<< (replayed == reference ? "" : "  (COMMANDS DIFFER)") << "\n";
+	}
+}
+
+// Decodes the six skybox faces with 1, 2, 4... threads, without uploading them. The faces are checked against the ones decoded by one thread.
+static void benchmarkCubeMapDecoding()
+{
+	const char* files[CUBE_MAP_FACES] = { "posx.jpg", "negx.jpg", "posy.jpg", "negy.jpg", "posz.jpg", "negz.jpg" };
+	if (!std::ifstream(files[0]).good())
+	{
+		std::cout << "\nCube map decoding: skipped, " << files[0] << " not found\n";
+		return;
+	}
+
+	int maxThreads = std::max(4, (int)std::thread::hardware_concurrency());
+	std::cout << "\nCube map decoding: six faces, one job per face\n";
+	std::cout << std::setw(10) << "threads" << std::setw(12) << "wall ms" << std::setw(12) << "decode ms" << std::setw(12) << "speedup" << "\n";
+
+	unsigned long long reference[CUBE_MAP_FACES];
+	double singleThread = 0.0;
+	for (int threadCount = 1; threadCount <= maxThreads; threadCount *= 2)
+	{
+		JobSystem jobs;
+		jobs.start(threadCount);
+		unsigned long long checksums[CUBE_MAP_FACES];
+		CubeMapLoadTimes times;
+		decodeCubeMapFaces(jobs, files, [&checksums](CubeMapFace& face)
+		{
+			unsigned long long sum = 0;
+			for (int i = 0; i < face.width * face.height * 4; i++)
+				sum = sum * 31 + face.pixels[i];
+			checksums[face.face] = sum;
+			SOIL_free_image_data(face.pixels);
+		}, times);
+
+		if (threadCount == 1)
+		{
+			std::copy(checksums, checksums + CUBE_MAP_FACES, reference);
+			singleThread = times.decode;
+		}
+		std::cout << std::setw(10) << threadCount << std::setw(12) << std::setprecision(4) << times.decode * 1000.0 << std::setw(12) << times.decodeSum * 1000.0
+			<< std::setw(12) << singleThread / times.decode << (std::equal(checksums, checksums + CUBE_MAP_FACES, reference) ? "" : "  (FACES DIFFER)") << "\n";
+	}
+}
+
+void benchmarkGpuCulling(GpuCulling& culling, const glm::mat4& PV, float viewportHeight, float maxPixelError)
+{
+	std::cout << "\nGPU culling: " << culling.instanceCount << " instances, " << culling.lods.size() << " levels of detail"
+		<< (GLEW_ARB_indirect_parameters ? ", draw count from the GPU" : "") << "\n";
+
+	// The camera of the demo, and the same camera turned to the side and up, so the frustum cuts through the instances.
+	glm::mat4 views[3] = { PV, PV * glm::rotate(glm::mat4(1), 0.6f, glm::vec3(0.0f, 1.0f, 0.0f)), PV * glm::rotate(glm::mat4(1), 0.4f, glm::vec3(1.0f, 0.0f, 0.0f)) };
+	std::cout << std::setw(8) << "view" << std::setw(10) << "visible" << std::setw(14) << "differences" << std::setw(10) << "CPU ms" << std::setw(10) << "GPU ms" << "\n";
+	for (int v = 0; v < 3; v++)
+	{
+		int differences = culling.validate(views[v], viewportHeight, maxPixelError);
+
+		const int repeats = 20;
+		std::vector<int> visible;
+		double start = glfwGetTime();
+		for (int r = 0; r < repeats; r++)
+			culling.cullOnCPU(views[v], viewportHeight, maxPixelError, visible);
+		double cpuTime = (glfwGetTime() - start) / repeats;
+
+		// glFinish waits for the compute shader, so the time includes the GPU's work and not just the submission.
+		glFinish();
+		start = glfwGetTime();
+		for (int r = 0; r < repeats; r++)
+			culling.cull(views[v], viewportHeight, maxPixelError);
+		glFinish();
+		double gpuTime = (glfwGetTime() - start) / repeats;
+
+		int visibleCount = (int)(visible.size() - std::count(visible.begin(), visible.end(), -1));
+		std::cout << std::setw(8) << v << std::setw(10) << visibleCount << std::setw(14) << differences
+			<< std::setw(10) << std::setprecision(4) << cpuTime * 1000.0 << std::setw(10) << gpuTime * 1000.0 << "\n";
+	}
+	std::cout << "(differences are instances the GPU put in another level than the CPU, or culled differently; a few can come from rounding at the thresholds)\n";
+}
+
+// A quad over the left part of the screen, from x = -1 to x = -1 + 2 * coverage, halfway into the depth range. It stands in for the objects.
+static const char* occluderVertexShader =
+	"#version 430 core\n"
+	"uniform float coverage;\n"
+	"void main(void)\n"
+	"{\n"
+	"	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+	"	gl_Position = vec4(-1.0 + corner.x * 2.0 * coverage, corner.y * 2.0 - 1.0, 0.0, 1.0);\n"
+	"}\n";
+static const char* occluderFragmentShader =
+	"#version 430 core\n"
+	"out vec4 out_color;\n"
+	"void main(void) { out_color = vec4(0.3, 0.3, 0.3, 1.0); }\n";
+
+static GLuint compileBenchmarkProgram(const char* vertexSource, const char* fragmentSource)
+{
+	GLuint vertexShader = glCreateShader(GL_VERTEX_SHADER);
+	glShaderSource(vertexShader, 1, &vertexSource, NULL);
+	glCompileShader(vertexShader);
+	GLuint fragmentShader = glCreateShader(GL_FRAGMENT_SHADER);
+	glShaderSource(fragmentShader, 1, &fragmentSource, NULL);
+	glCompileShader(fragmentShader);
+
+	GLuint program = glCreateProgram();
+	glAttachShader(program, vertexShader);
+	glAttachShader(program, fragmentShader);
+	glLinkProgram(program);
+	glDeleteShader(vertexShader);
+	glDeleteShader(fragmentShader);
+	return program;
+}
+
+void benchmarkSkyBox(GLuint skyProgram, GLuint skyVAO, int skyVertexCount, GLuint cubeMap)
+{
+	const int size = 800;
+	const int repeats = 20;
+
+	// An offscreen target, so the results do not depend on the window being visible.
+	GLuint framebuffer, renderbuffers[2];
+	glGenFramebuffers(1, &framebuffer);
+	glGenRenderbuffers(2, renderbuffers);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[0]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size, size);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffers[1]);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, size, size);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffers[0]);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, renderbuffers[1]);
+	glViewport(0, 0, size, size);
+
+	GLuint occluderProgram = compileBenchmarkProgram(occluderVertexShader, occluderFragmentShader);
+	GLint uniCoverage = glGetUniformLocation(occluderProgram, "coverage");
+	GLuint emptyVAO;
+	glGenVertexArrays(1, &emptyVAO);
+	GLuint queries[2];
+	glGenQueries(2, queries);
+
+	glEnable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, cubeMap);
+
+	std::cout << "\nSkybox: " << size << "x" << size << ", drawn before the objects (depth test off) or after them at the far plane (GL_LEQUAL)\n";
+	std::cout << std::setw(10) << "covered" << std::setw(14) << "first: shaded" << std::setw(8) << "ms" << std::setw(14) << "last: shaded" << std::setw(8) << "ms" << "\n";
+	for (int step = 0; step <= 4; step++)
+	{
+		float coverage = step / 4.0f;
+		GLuint shaded[2];
+		double time[2];
+		for (int last = 0; last < 2; last++)
+		{
+			GLuint64 nanoseconds = 0;
+			for (int r = 0; r < repeats; r++)
+			{
+				glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
+				glBeginQuery(GL_TIME_ELAPSED, queries[0]);
+				for (int pass = 0; pass < 2; pass++)
+				{
+					if ((pass == 1) == (last == 1))
+					{
+						// The skybox, with every fragment which passes the depth test counted.
+						glDepthMask(GL_FALSE);
+						glDepthFunc(last ? GL_LEQUAL : GL_ALWAYS);
+						glUseProgram(skyProgram);
+						glBindVertexArray(skyVAO);
+						glBeginQuery(GL_SAMPLES_PASSED, queries[1]);
+						glDrawArrays(GL_TRIANGLES, 0, skyVertexCount);
+						glEndQuery(GL_SAMPLES_PASSED);
+						glDepthFunc(GL_LESS);
+						glDepthMask(GL_TRUE);
+					}
+					else
+					{
+						glUseProgram(occluderProgram);
+						glUniform1f(uniCoverage, coverage);
+						glBindVertexArray(emptyVAO);
+						glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+					}
+				}
+				glEndQuery(GL_TIME_ELAPSED);
+
+				GLuint64 elapsed;
+				glGetQueryObjectui64v(queries[0], GL_QUERY_RESULT, &elapsed);
+				nanoseconds += elapsed;
+			}
+			glGetQueryObjectuiv(queries[1], GL_QUERY_RESULT, &shaded[last]);
+			time[last] = nanoseconds / 1000000.0 / repeats;
+		}
+		std::cout << std::setw(9) << (int)(coverage * 100.0f) << "%" << std::setw(14) << shaded[0] << std::setw(8) << std::setprecision(3) << time[0]
+			<< std::setw(14) << shaded[1] << std::setw(8) << time[1] << "\n";
+	}
+
+	glBindVertexArray(0);
+	glUseProgram(0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteQueries(2, queries);
+	glDeleteVertexArrays(1, &emptyVAO);
+	glDeleteProgram(occluderProgram);
+	glDeleteRenderbuffers(2, renderbuffers);
+	glDeleteFramebuffers(1, &framebuffer);
+}
+
+// A grid of tiny mirror balls filling the screen: every tile of tileSize pixels reflects the whole cube map, so the smaller the
+// tiles, the more the cube map is minified, like the reflections on small or distant spheres.
+static const char* mirrorBallVertexShader =
+	"#version 430 core\n"
+	"void main(void)\n"
+	"{\n"
+	"	vec2 corner = vec2(gl_VertexID & 1, gl_VertexID >> 1);\n"
+	"	gl_Position = vec4(corner * 2.0 - 1.0, 0.0, 1.0);\n"
+	"}\n";
+static const char* mirrorBallFragmentShader =
+	"#version 430 core\n"
+	"uniform samplerCube cubeMap;\n"
+	"uniform float tileSize;\n"
+	"out vec4 out_color;\n"
+	"void main(void)\n"
+	"{\n"
+	"	vec2 p = fract(gl_FragCoord.xy / tileSize) * 2.0 - 1.0;\n"
+	"	vec3 normal = vec3(p, sqrt(max(0.0, 1.0 - dot(p, p))));\n"
+	"	out_color = texture(cubeMap, reflect(vec3(0.0, 0.0, -1.0), normalize(normal)));\n"
+	"}\n";
+
+void benchmarkCubeMapFiltering(GLuint cubeMap)
+{
+	const int size = 800;
+	const int repeats = 10;
+
+	GLuint framebuffer, renderbuffer;
+	glGenFramebuffers(1, &framebuffer);
+	glGenRenderbuffers(1, &renderbuffer);
+	glBindRenderbuffer(GL_RENDERBUFFER, renderbuffer);
+	glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, size, size);
+	glBindRenderbuffer(GL_RENDERBUFFER, 0);
+	glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+	glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, renderbuffer);
+	glViewport(0, 0, size, size);
+
+	GLuint program = compileBenchmarkProgram(mirrorBallVertexShader, mirrorBallFragmentShader);
+	GLint uniTileSize = glGetUniformLocation(program, "tileSize");
+	glUseProgram(program);
+	glUniform1i(glGetUniformLocation(program, "cubeMap"), 0);
+	GLuint emptyVAO;
+	glGenVertexArrays(1, &emptyVAO);
+	glBindVertexArray(emptyVAO);
+
+	glDisable(GL_DEPTH_TEST);
+	glDisable(GL_BLEND);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, cubeMap);
+	GLint minFilter;
+	GLfloat anisotropy = 1.0f;
+	glGetTexParameteriv(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, &minFilter);
+	if (GLEW_EXT_texture_filter_anisotropic)
+		glGetTexParameterfv(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_ANISOTROPY_EXT, &anisotropy);
+
+	// Bilinear from level 0 as the skybox used to be sampled, trilinear, and trilinear with 8x anisotropy if there is any.
+	const GLenum filters[3] = { GL_LINEAR, GL_LINEAR_MIPMAP_LINEAR, GL_LINEAR_MIPMAP_LINEAR };
+	const float anisotropies[3] = { 1.0f, 1.0f, 8.0f };
+	const char* names[3] = { "bilinear", "trilinear", "trilinear 8x" };
+	int filterCount = GLEW_EXT_texture_filter_anisotropic ? 3 : 2;
+
+	std::cout << "\nCube map filtering: " << size << "x" << size << " of mirror balls, ms per frame\n";
+	std::cout << std::setw(10) << "ball px";
+	for (int f = 0; f < filterCount; f++)
+		std::cout << std::setw(14) << names[f];
+	std::cout << "\n";
+	for (int tileSize = 4; tileSize <= 256; tileSize *= 4)
+	{
+		std::cout << std::setw(10) << tileSize;
+		glUniform1f(uniTileSize, (float)tileSize);
+		for (int f = 0; f < filterCount; f++)
+		{
+			glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, filters[f]);
+			if (GLEW_EXT_texture_filter_anisotropic)
+				glTexParameterf(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_ANISOTROPY_EXT, anisotropies[f]);
+			// Once first, so the time does not include setting up the new state. Timed to glFinish(), as software renderers draw
+			// later than the time queries see.
+			glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+			glFinish();
+			double start = glfwGetTime();
+			for (int r = 0; r < repeats; r++)
+				glDrawArrays(GL_TRIANGLE_STRIP, 0, 4);
+			glFinish();
+			std::cout << std::setw(14) << std::setprecision(3) << (glfwGetTime() - start) * 1000.0 / repeats;
+		}
+		std::cout << "\n";
+	}
+
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, minFilter);
+	if (GLEW_EXT_texture_filter_anisotropic)
+		glTexParameterf(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_ANISOTROPY_EXT, anisotropy);
+	glEnable(GL_DEPTH_TEST);
+	glBindVertexArray(0);
+	glUseProgram(0);
+	glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	glDeleteVertexArrays(1, &emptyVAO);
+	glDeleteProgram(program);
+	glDeleteRenderbuffers(1, &renderbuffer);
+	glDeleteFramebuffers(1, &framebuffer);
+}
+
+void benchmarkTextureUpload()
+{
+	const int size = 2048;
+	const int repeats = 4;
+	const size_t faceBytes = (size_t)size * size * 4;
+
+	TextureUploader uploader;
+	if (!uploader.init(faceBytes * CUBE_MAP_FACES))
+	{
+		std::cout << "\nTexture upload: skipped, no ARB_buffer_storage\n";
+		return;
+	}
+	std::vector<unsigned char> pixels(faceBytes * CUBE_MAP_FACES);
+	for (size_t i = 0; i < pixels.size(); i++)
+		pixels[i] = (unsigned char)(i * 7);
+
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glActiveTexture(GL_TEXTURE0);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+	glTexStorage2D(GL_TEXTURE_CUBE_MAP, 1, GL_RGBA8, size, size);
+
+	std::cout << "\nTexture upload: six " << size << "x" << size << " faces\n";
+	std::cout << std::setw(16) << "from" << std::setw(14) << "GL calls ms" << std::setw(14) << "finished ms" << "\n";
+	for (int ring = 0; ring < 2; ring++)
+	{
+		double callTime = 0.0;
+		double totalTime = 0.0;
+		for (int r = 0; r < repeats; r++)
+		{
+			glFinish();
+			// The faces are written into the ring by the caller, as the decoding threads would; only the GL calls count.
+			unsigned char* block = NULL;
+			if (ring)
+			{
+				while (!(block = uploader.allocate(pixels.size())))
+				{
+					glFinish();
+					uploader.update();
+				}
+				memcpy(block, &pixels[0], pixels.size());
+			}
+
+			double start = glfwGetTime();
+			if (ring)
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, uploader.buffer);
+			for (int face = 0; face < CUBE_MAP_FACES; face++)
+			{
+				const void* source = ring ? uploader.offset(block + face * faceBytes) : (const void*)&pixels[face * faceBytes];
+				glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face, 0, 0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, source);
+			}
+			if (ring)
+			{
+				glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+				uploader.retire(block);
+				uploader.update();
+			}
+			callTime += glfwGetTime() - start;
+			glFinish();
+			totalTime += glfwGetTime() - start;
+		}
+		std::cout << std::setw(16) << (ring ? "upload ring" : "client memory") << std::setw(14) << std::setprecision(4) << callTime / repeats * 1000.0
+			<< std::setw(14) << totalTime / repeats * 1000.0 << "\n";
+	}
+
+	glBindTexture(GL_TEXTURE_CUBE_MAP, 0);
+	glDeleteTextures(1, &texture);
+	uploader.release();
+}
+
+void runBenchmarks()
+{
+	benchmarkSphereGenerator();
+	benchmarkSphereQuality();
+	benchmarkLODSelection();
+	benchmarkMeshOptimizer();
+	benchmarkVertexFormats();
+	benchmarkMeshCache();
+	checkMeshCacheValidation();
+	benchmarkMeshImporter();
+	checkObjRelativeIndices();
+	benchmarkFrustumCulling();
+	benchmarkScene();
+	benchmarkDrawList();
+	benchmarkCommandRecording();
+	benchmarkJobSystem();
+	checkJobPool();
+	benchmarkCubeMapDecoding();
+}
@@ -0,0 +1,55 @@
+/*
+Title: Reflection and refraction
+File Name: Benchmarks.h
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+Microbenchmarks for the performance sensitive parts of the program.
+Run the program with --benchmark to print the results to the console
+instead of opening the demo.
+*/
+
+#ifndef _BENCHMARKS_H
+#define _BENCHMARKS_H
+
+#include "GLIncludes.h"
+#include "GpuCulling.h"
+
+// Runs every benchmark. Expects glfwInit() to have been called (glfwGetTime is used as the timer).
+void runBenchmarks();
+
+// Compares the compute shader culling with the same culling on the CPU, for correctness and for time.
+// Needs an OpenGL 4.3 context and an initialized GpuCulling, so it is run separately from runBenchmarks.
+void benchmarkGpuCulling(GpuCulling& culling, const glm::mat4& PV, float viewportHeight, float maxPixelError);
+
+// Draws the skybox before and after an opaque quad which covers more and more of the screen, and measures how many skybox fragments
+// are shaded and how long the frame takes. Needs an OpenGL 4.3 context, the skybox program with its VAO and cube map, and the frame uniforms set.
+void benchmarkSkyBox(GLuint skyProgram, GLuint skyVAO, int skyVertexCount, GLuint cubeMap);
+
+// Draws a screen of small mirror balls which reflect the cube map, with bilinear filtering from level 0, trilinear filtering and
+// anisotropic filtering, and measures the time per frame. Needs an OpenGL 4.3 context and a cube map with all its mip levels.
+void benchmarkCubeMapFiltering(GLuint cubeMap);
+
+// Uploads six 2048x2048 faces from client memory and from a TextureUploader ring, and measures how long the GL thread spends in the
+// calls and how long until the copies are done. Needs an OpenGL context with ARB_buffer_storage.
+void benchmarkTextureUpload();
+
+#endif //_BENCHMARKS_H
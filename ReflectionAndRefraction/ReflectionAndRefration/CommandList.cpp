@@ -0,0 +1,212 @@
+/*
+Title: Reflection and refraction
+File Name: CommandList.cpp
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Description:
+Recording and replay of command lists, see CommandList.h.
+*/
+
+#include "CommandList.h"
+
+// The commands as they are stored in the buffer. Every one starts with its header.
+struct BindPipelineCommand		{ CommandHeader header; GLuint program; };
+struct BindVertexArrayCommand	{ CommandHeader header; GLuint vao; };
+struct BindTextureCommand		{ CommandHeader header; int unit; GLenum target; GLuint texture; };
+struct BindUniformBufferCommand	{ CommandHeader header; GLuint binding; GLuint buffer; GLintptr offset; GLsizeiptr size; };
+struct SetUniformFloatCommand	{ CommandHeader header; GLuint program; GLint location; float value; };
+struct SetDepthWriteCommand		{ CommandHeader header; GLboolean enabled; };
+struct SetDepthFuncCommand		{ CommandHeader header; GLenum function; };
+struct DrawCommandData			{ CommandHeader header; GLenum mode; int first; int count; };
+struct DrawIndexedCommand		{ CommandHeader header; GLenum mode; int count; GLenum indexType; GLuint firstIndex; GLint baseVertex; int instanceCount; GLuint baseInstance; };
+struct DrawIndexedIndirectCommand { CommandHeader header; GLenum mode; GLenum indexType; GLuint commandBuffer; GLuint countBuffer; int maxDraws; };
+
+// Every command is padded to a multiple of 8 bytes, so the GLintptr members of the next one stay aligned.
+#define COMMAND_ALIGNMENT 8
+
+template <typename Command>
+Command& CommandList::push(CommandType type)
+{
+	size_t size = (sizeof(Command) + COMMAND_ALIGNMENT - 1) / COMMAND_ALIGNMENT * COMMAND_ALIGNMENT;
+	size_t offset = data.size();
+	data.resize(offset + size);
+	Command& command = *(Command*)&data[offset];
+	command.header.type = type;
+	command.header.size = (int)size;
+	return command;
+}
+
+void CommandList::bindPipeline(GLuint program)
+{
+	push<BindPipelineCommand>(COMMAND_BIND_PIPELINE).program = program;
+}
+
+void CommandList::bindVertexArray(GLuint vao)
+{
+	push<BindVertexArrayCommand>(COMMAND_BIND_VERTEX_ARRAY).vao = vao;
+}
+
+void CommandList::bindTexture(int unit, GLenum target, GLuint texture)
+{
+	BindTextureCommand& command = push<BindTextureCommand>(COMMAND_BIND_TEXTURE);
+	command.unit = unit;
+	command.target = target;
+	command.texture = texture;
+}
+
+void CommandList::bindUniformBuffer(GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size)
+{
+	BindUniformBufferCommand& command = push<BindUniformBufferCommand>(COMMAND_BIND_UNIFORM_BUFFER);
+	command.binding = binding;
+	command.buffer = buffer;
+	command.offset = offset;
+	command.size = size;
+}
+
+void CommandList::setUniform(GLuint program, GLint location, float value)
+{
+	SetUniformFloatCommand& command = push<SetUniformFloatCommand>(COMMAND_SET_UNIFORM_FLOAT);
+	command.program = program;
+	command.location = location;
+	command.value = value;
+}
+
+void CommandList::setDepthWrite(bool enabled)
+{
+	push<SetDepthWriteCommand>(COMMAND_SET_DEPTH_WRITE).enabled = enabled ? GL_TRUE : GL_FALSE;
+}
+
+void CommandList::setDepthFunc(GLenum function)
+{
+	push<SetDepthFuncCommand>(COMMAND_SET_DEPTH_FUNC).function = function;
+}
+
+void CommandList::draw(GLenum mode, int first, int count)
+{
+	DrawCommandData& command = push<DrawCommandData>(COMMAND_DRAW);
+	command.mode = mode;
+	command.first = first;
+	command.count = count;
+}
+
+void CommandList::drawIndexed(GLenum mode, int count, GLenum indexType, GLuint firstIndex, GLint baseVertex, int instanceCount, GLuint baseInstance)
+{
+	DrawIndexedCommand& command = push<DrawIndexedCommand>(COMMAND_DRAW_INDEXED);
+	command.mode = mode;
+	command.count = count;
+	command.indexType = indexType;
+	command.firstIndex = firstIndex;
+	command.baseVertex = baseVertex;
+	command.instanceCount = instanceCount;
+	command.baseInstance = baseInstance;
+}
+
+void CommandList::drawIndexedIndirect(GLenum mode, GLenum indexType, GLuint commandBuffer, GLuint countBuffer, int maxDraws)
+{
+	DrawIndexedIndirectCommand& command = push<DrawIndexedIndirectCommand>(COMMAND_DRAW_INDEXED_INDIRECT);
+	command.mode = mode;
+	command.indexType = indexType;
+	command.commandBuffer = commandBuffer;
+	command.countBuffer = countBuffer;
+	command.maxDraws = maxDraws;
+}
+
+static size_t indexSize(GLenum indexType)
+{
+	return indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : indexType == GL_UNSIGNED_BYTE ? sizeof(GLubyte) : sizeof(GLuint);
+}
+
+void CommandList::replay(size_t begin, size_t end, GLStateCache& state) const
+{
+	size_t offset = begin;
+	while (offset < end)
+	{
+		const CommandHeader* header = (const CommandHeader*)&data[offset];
+		switch (header->type)
+		{
+		case COMMAND_BIND_PIPELINE:
+			state.useProgram(((const BindPipelineCommand*)header)->program);
+			break;
+		case COMMAND_BIND_VERTEX_ARRAY:
+			state.bindVertexArray(((const BindVertexArrayCommand*)header)->vao);
+			break;
+		case COMMAND_BIND_TEXTURE:
+		{
+			const BindTextureCommand* command = (const BindTextureCommand*)header;
+			state.activeTexture(GL_TEXTURE0 + command->unit);
+			state.bindTexture(command->target, command->texture);
+			break;
+		}
+		case COMMAND_BIND_UNIFORM_BUFFER:
+		{
+			const BindUniformBufferCommand* command = (const BindUniformBufferCommand*)header;
+			glBindBufferRange(GL_UNIFORM_BUFFER, command->binding, command->buffer, command->offset, command->size);
+			break;
+		}
+		case COMMAND_SET_UNIFORM_FLOAT:
+		{
+			const SetUniformFloatCommand* command = (const SetUniformFloatCommand*)header;
+			glProgramUniform1f(command->program, command->location, command->value);
+			break;
+		}
+		case COMMAND_SET_DEPTH_WRITE:
+			state.depthMask(((const SetDepthWriteCommand*)header)->enabled);
+			break;
+		case COMMAND_SET_DEPTH_FUNC:
+			state.depthFunc(((const SetDepthFuncCommand*)header)->function);
+			break;
+		case COMMAND_DRAW:
+		{
+			const DrawCommandData* command = (const DrawCommandData*)header;
+			glDrawArrays(command->mode, command->first, command->count);
+			break;
+		}
+		case COMMAND_DRAW_INDEXED:
+		{
+			const DrawIndexedCommand* command = (const DrawIndexedCommand*)header;
+			void* indices = (void*)(command->firstIndex * indexSize(command->indexType));
+			if (command->instanceCount == 1 && command->baseInstance == 0)
+				glDrawElementsBaseVertex(command->mode, command->count, command->indexType, indices, command->baseVertex);
+			else if (command->instanceCount > 0)
+				glDrawElementsInstancedBaseVertexBaseInstance(command->mode, command->count, command->indexType, indices,
+					command->instanceCount, command->baseVertex, command->baseInstance);
+			break;
+		}
+		case COMMAND_DRAW_INDEXED_INDIRECT:
+		{
+			const DrawIndexedIndirectCommand* command = (const DrawIndexedIndirectCommand*)header;
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, command->commandBuffer);
+			if (command->countBuffer != 0 && GLEW_ARB_indirect_parameters)
+			{
+				glBindBuffer(GL_PARAMETER_BUFFER_ARB, command->countBuffer);
+				glMultiDrawElementsIndirectCountARB(command->mode, command->indexType, 0, 0, command->maxDraws, 0);
+				glBindBuffer(GL_PARAMETER_BUFFER_ARB, 0);
+			}
+			else
+				glMultiDrawElementsIndirect(command->mode, command->indexType, 0, command->maxDraws, 0);
+			glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+			break;
+		}
+		}
+		offset += header->size;
+	}
+}
@@ -0,0 +1,102 @@
+/*
+Title: Reflection and refraction
+File Name: CommandList.h
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Description:
+A list of rendering commands recorded into one linear buffer, to be
+replayed later on the thread which owns the OpenGL context.
+
+The recording functions only write the command and its arguments at the
+end of the buffer, they never call OpenGL, so any thread can record its
+own list: bind a pipeline (a linked program), bind a VAO, a texture or a
+range of a uniform buffer, set a uniform, change the depth write or the
+depth test, and draw. The GL thread then replays the lists one after the other, in the
+order it chooses, through a GLStateCache so binds which change nothing
+are dropped.
+
+Each command is a small struct starting with a CommandHeader, which gives
+its type and size. Nothing in a command points into other memory, so a
+list can be replayed any number of times and its buffer can grow while
+it is recorded. Parts of a list are addressed by their byte offsets, as
+returned by size() before and after recording them.
+*/
+
+#ifndef _COMMAND_LIST_H
+#define _COMMAND_LIST_H
+
+#include "GLIncludes.h"
+#include "GLStateCache.h"
+
+enum CommandType
+{
+	COMMAND_BIND_PIPELINE,
+	COMMAND_BIND_VERTEX_ARRAY,
+	COMMAND_BIND_TEXTURE,
+	COMMAND_BIND_UNIFORM_BUFFER,
+	COMMAND_SET_UNIFORM_FLOAT,
+	COMMAND_SET_DEPTH_WRITE,
+	COMMAND_SET_DEPTH_FUNC,
+	COMMAND_DRAW,
+	COMMAND_DRAW_INDEXED,
+	COMMAND_DRAW_INDEXED_INDIRECT
+};
+
+struct CommandHeader
+{
+	int type;						// A CommandType
+	int size;						// Bytes from this header to the next one
+};
+
+struct CommandList
+{
+	std::vector<unsigned char> data;
+
+	void clear() { data.clear(); }
+	size_t size() const { return data.size(); }
+
+	void bindPipeline(GLuint program);
+	void bindVertexArray(GLuint vao);
+	void bindTexture(int unit, GLenum target, GLuint texture);
+	void bindUniformBuffer(GLuint binding, GLuint buffer, GLintptr offset, GLsizeiptr size);
+	// Sets the uniform on the program directly (glProgramUniform), whichever pipeline is bound.
+	void setUniform(GLuint program, GLint location, float value);
+	void setDepthWrite(bool enabled);
+	void setDepthFunc(GLenum function);
+
+	void draw(GLenum mode, int first, int count);
+	// firstIndex is counted in indices, not bytes. Instanced when instanceCount is not 1.
+	void drawIndexed(GLenum mode, int count, GLenum indexType, GLuint firstIndex, GLint baseVertex, int instanceCount = 1, GLuint baseInstance = 0);
+	// maxDraws DrawElementsIndirectCommands from commandBuffer. With a countBuffer (and ARB_indirect_parameters), the GPU reads
+	// the number of commands to draw from its first GLuint; without it, all maxDraws are drawn.
+	void drawIndexedIndirect(GLenum mode, GLenum indexType, GLuint commandBuffer, GLuint countBuffer, int maxDraws);
+
+	// Makes the OpenGL calls of the commands from byte offset begin to byte offset end. Only on the GL thread.
+	void replay(size_t begin, size_t end, GLStateCache& state) const;
+	void replay(GLStateCache& state) const { replay(0, data.size(), state); }
+
+private:
+	template <typename Command>
+	Command& push(CommandType type);
+};
+
+#endif //_COMMAND_LIST_H
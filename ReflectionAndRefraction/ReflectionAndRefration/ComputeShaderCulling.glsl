@@ -0,0 +1,98 @@
+/*
+Title: Reflection and refraction
+File Name: ComputeShaderCulling.glsl
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+Frustum culling and level of detail selection for one instance per
+invocation, see GpuCulling.h. The visible instances are appended to the
+part of the visible instance buffer belonging to their level, and the
+instanceCount of that level's draw command is the append counter.
+*/
+
+#version 430 core
+
+layout(local_size_x = 64) in;
+
+struct Instance
+{
+	mat4 model;
+	vec4 material;
+};
+
+// The layout of DrawElementsIndirectCommand
+struct DrawCommand
+{
+	uint count;
+	uint instanceCount;
+	uint firstIndex;
+	int baseVertex;
+	uint baseInstance;
+};
+
+layout(std430, binding = 0) readonly buffer Instances { Instance instances[]; };
+layout(std430, binding = 1) writeonly buffer Visible { Instance visible[]; };
+layout(std430, binding = 2) buffer Commands { DrawCommand commands[]; };
+layout(std430, binding = 3) buffer DrawCount { uint drawCount; };
+
+uniform vec4 planes[6];						// Frustum planes, pointing inwards
+uniform mat4 PV;
+uniform uint instanceCount;
+uniform float viewportHeight;
+uniform float maxPixelError;
+uniform float lodErrors[8];					// MeshLOD::error of every level, coarsest first
+uniform int lodCount;
+uniform float boundingRadius;				// Radius of the mesh before the model matrix scales it
+
+void main(void)
+{
+	uint index = gl_GlobalInvocationID.x;
+	if (index >= instanceCount)
+		return;
+
+	mat4 model = instances[index].model;
+	vec3 center = model[3].xyz;
+	float radius = length(model[0].xyz) * boundingRadius;
+
+	for (int i = 0; i < 6; i++)
+		if (dot(planes[i].xyz, center) + planes[i].w < -radius)
+			return;
+
+	// Radius on screen in pixels, as projectedRadius() in Mesh.cpp computes it.
+	float projectionScale = length(vec3(PV[0][1], PV[1][1], PV[2][1]));
+	float w = dot(vec4(PV[0][3], PV[1][3], PV[2][3], PV[3][3]), vec4(center, 1.0f));
+	float radiusInPixels = (w <= radius) ? viewportHeight : radius * projectionScale / w * (viewportHeight * 0.5f);
+
+	// The coarsest level which is close enough to the true surface, as selectLOD() does.
+	int level = lodCount - 1;
+	for (int i = 0; i < lodCount; i++)
+	{
+		if (lodErrors[i] * radiusInPixels <= maxPixelError)
+		{
+			level = i;
+			break;
+		}
+	}
+
+	uint slot = atomicAdd(commands[level].instanceCount, 1u);
+	visible[commands[level].baseInstance + slot] = instances[index];
+	atomicMax(drawCount, uint(level + 1));
+}
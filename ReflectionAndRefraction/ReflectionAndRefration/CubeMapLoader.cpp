@@ -0,0 +1,151 @@
+/*
+Title: Reflection and refraction
+File Name: CubeMapLoader.cpp
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Description:
+Parallel decoding and overlapped upload of cube map faces, see
+CubeMapLoader.h.
+*/
+
+#include "CubeMapLoader.h"
+#include "LockFreeQueue.h"
+
+void CubeMapLoadTimes::print() const
+{
+	std::cout << "\n Cube map: decoded on " << threads << " threads in " << decode * 1000.0 << " ms ("
+		<< decodeSum * 1000.0 << " ms of decoding, " << (decode > 0.0 ? decodeSum / decode : 0.0) << "x in parallel), uploaded in "
+		<< upload * 1000.0 << " ms, mipmapped in " << mipmaps * 1000.0 << " ms, ready in " << total * 1000.0 << " ms";
+}
+
+void decodeCubeMapFaces(JobSystem& jobs, const char* const files[CUBE_MAP_FACES], std::function<void(CubeMapFace&)> receive, CubeMapLoadTimes& times)
+{
+	double start = glfwGetTime();
+	times.threads = jobs.threadCount();
+	times.decodeSum = 0.0;
+
+	LockFreeQueue<CubeMapFace> decoded(CUBE_MAP_FACES);
+	Job* all = jobs.create(std::function<void()>());
+	for (int i = 0; i < CUBE_MAP_FACES; i++)
+	{
+		const char* file = files[i];
+		jobs.run(jobs.create([i, file, &decoded]()
+		{
+			CubeMapFace face;
+			face.face = i;
+			double faceStart = glfwGetTime();
+			face.pixels = SOIL_load_image(file, &face.width, &face.height, 0, SOIL_LOAD_RGBA);
+			face.decodeTime = glfwGetTime() - faceStart;
+			if (!face.pixels)
+				face.width = face.height = 0;
+			// The queue has room for every face, so this never fails.
+			decoded.push(face);
+		}, all));
+	}
+	jobs.run(all);
+
+	// Hand every face on as soon as it arrives; decode one here while none is ready.
+	for (int received = 0; received < CUBE_MAP_FACES;)
+	{
+		CubeMapFace face;
+		if (decoded.pop(face))
+		{
+			times.decodeSum += face.decodeTime;
+			times.decode = glfwGetTime() - start;
+			if (!face.pixels)
+				std::cout << "\n Can't load cube map face: " << files[face.face];
+			receive(face);
+			received++;
+		}
+		else if (!jobs.runOne())
+			std::this_thread::yield();
+	}
+	// The jobs have pushed their faces, but may not have finished yet, and decoded lives on this stack.
+	jobs.wait(all);
+}
+
+int cubeMapLevels(int size)
+{
+	int levels = 1;
+	while ((size >> levels) > 0)
+		levels++;
+	return levels;
+}
+
+void setCubeMapSampling(float anisotropy)
+{
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+	if (anisotropy > 1.0f && GLEW_EXT_texture_filter_anisotropic)
+	{
+		GLfloat largest;
+		glGetFloatv(GL_MAX_TEXTURE_MAX_ANISOTROPY_EXT, &largest);
+		glTexParameterf(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_ANISOTROPY_EXT, std::min(anisotropy, (float)largest));
+	}
+}
+
+GLuint loadCubeMap(JobSystem& jobs, const char* const files[CUBE_MAP_FACES], CubeMapLoadTimes& times, float anisotropy)
+{
+	double start = glfwGetTime();
+	times.upload = 0.0;
+
+	GLuint texture;
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+
+	// The storage gets the size of the first face which arrives, with all its levels. The other faces have to be the same size.
+	int size = 0;
+	int levels = 0;
+	decodeCubeMapFaces(jobs, files, [&times, &size, &levels, files](CubeMapFace& face)
+	{
+		double uploadStart = glfwGetTime();
+		if (face.pixels)
+		{
+			if (size == 0 && face.width == face.height)
+			{
+				size = face.width;
+				levels = cubeMapLevels(size);
+				glTexStorage2D(GL_TEXTURE_CUBE_MAP, levels, GL_RGBA8, size, size);
+			}
+			if (face.width == size && face.height == size)
+				glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + face.face, 0, 0, 0, size, size, GL_RGBA, GL_UNSIGNED_BYTE, face.pixels);
+			else
+				std::cout << "\n Cube map face " << files[face.face] << " is " << face.width << "x" << face.height << ", not square or not the size of the others";
+			SOIL_free_image_data(face.pixels);
+		}
+		times.upload += glfwGetTime() - uploadStart;
+	}, times);
+
+	// The smaller levels, from level 0 of every face.
+	double mipmapStart = glfwGetTime();
+	if (levels > 1)
+		glGenerateMipmap(GL_TEXTURE_CUBE_MAP);
+	times.mipmaps = glfwGetTime() - mipmapStart;
+
+	setCubeMapSampling(anisotropy);
+
+	times.total = glfwGetTime() - start;
+	return texture;
+}
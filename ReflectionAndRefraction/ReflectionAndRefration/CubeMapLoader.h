@@ -0,0 +1,96 @@
+/*
+Title: Reflection and refraction
+File Name: CubeMapLoader.h
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Description:
+Loads the six faces of a cube map with the decoding spread over the job
+system, and the upload to OpenGL overlapped with it.
+
+Every face is decoded by its own job, so as many faces are decoded at a
+time as there are threads. A decoded face is pushed onto a LockFreeQueue
+and the thread which started the load, the one with the OpenGL context,
+pops it and uploads it right away, while the other faces are still being
+decoded. When the queue is empty that thread decodes a face itself
+instead of waiting, so with a single thread the load is just as fast as
+decoding the faces one after the other.
+
+The texture is immutable (glTexStorage2D), sized by the first face
+which arrives, with the whole mip chain, which glGenerateMipmap fills
+once all the faces are in. It is sampled trilinearly: reflections on
+small or distant spheres read the small levels instead of scattered
+texels of the 2048x2048 faces, which is both smoother and much kinder
+to the texture cache.
+
+SOIL (stb_image underneath) keeps no state between the images it loads,
+apart from the text of the last error, so faces can be decoded on
+several threads at once. The only thing the jobs share is the queue.
+*/
+
+#ifndef _CUBE_MAP_LOADER_H
+#define _CUBE_MAP_LOADER_H
+
+#include "GLIncludes.h"
+#include "JobSystem.h"
+
+#define CUBE_MAP_FACES 6
+
+// A decoded face, RGBA with 8 bits per channel. pixels is NULL if the file could not be loaded.
+struct CubeMapFace
+{
+	int face;					// 0 to 5, in the order of GL_TEXTURE_CUBE_MAP_POSITIVE_X and the following targets
+	int width;
+	int height;
+	unsigned char* pixels;		// Free with SOIL_free_image_data
+	double decodeTime;			// Seconds the decoding of this face took
+};
+
+// Wall times of the stages of a load, in seconds.
+struct CubeMapLoadTimes
+{
+	int threads;
+	double decode;				// From the start until the last face is decoded
+	double decodeSum;			// The decode times of all the faces added up, the time one thread would need
+	double upload;				// Spent in the OpenGL calls, on the calling thread
+	double mipmaps;				// Spent in glGenerateMipmap
+	double total;				// From the start until the texture is complete
+
+	void print() const;
+};
+
+// Decodes the files (posx, negx, posy, negy, posz, negz) with one job per face and calls receive for every face, on the calling
+// thread, in the order the faces finish. receive owns the pixels of the face.
+void decodeCubeMapFaces(JobSystem& jobs, const char* const files[CUBE_MAP_FACES], std::function<void(CubeMapFace&)> receive, CubeMapLoadTimes& times);
+
+// Creates a cube map texture from the files, see above. Binds it to GL_TEXTURE_CUBE_MAP on the active texture unit.
+// anisotropy above 1 turns on anisotropic filtering, if the driver has it.
+GLuint loadCubeMap(JobSystem& jobs, const char* const files[CUBE_MAP_FACES], CubeMapLoadTimes& times, float anisotropy = 1.0f);
+
+// The number of mip levels of a face of size x size, down to 1x1.
+int cubeMapLevels(int size);
+
+// Sets the filtering and wrapping of the cube map bound to GL_TEXTURE_CUBE_MAP: trilinear, clamped to the edges, and anisotropic
+// with up to anisotropy samples (clamped to what the driver allows). Filtering across the edges of the faces needs
+// GL_TEXTURE_CUBE_MAP_SEAMLESS, which is global state.
+void setCubeMapSampling(float anisotropy);
+
+#endif //_CUBE_MAP_LOADER_H
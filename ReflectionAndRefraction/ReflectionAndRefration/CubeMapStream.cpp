@@ -0,0 +1,408 @@
+/*
+Title: Reflection and refraction
+File Name: CubeMapStream.cpp
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Description:
+Progressive loading of a cube map, see CubeMapStream.h.
+*/
+
+#include "CubeMapStream.h"
+
+bool readImageSize(const char* file, int& width, int& height)
+{
+	std::ifstream in(file, std::ios::in | std::ios::binary);
+	unsigned char header[24];
+	if (!in.read((char*)header, 2))
+		return false;
+
+	// PNG: the signature, then the IHDR chunk, which starts with the width and height as big endian 32 bit numbers.
+	if (header[0] == 0x89 && header[1] == 'P')
+	{
+		if (!in.read((char*)header + 2, 22))
+			return false;
+		width = (header[16] << 24) | (header[17] << 16) | (header[18] << 8) | header[19];
+		height = (header[20] << 24) | (header[21] << 16) | (header[22] << 8) | header[23];
+		return true;
+	}
+
+	// JPEG: a chain of segments, each one a marker and a big endian length. The start of frame segment has the height and width.
+	if (header[0] != 0xFF || header[1] != 0xD8)
+		return false;
+	for (;;)
+	{
+		unsigned char marker[4];
+		if (!in.read((char*)marker, 2) || marker[0] != 0xFF)
+			return false;
+		// Padding before the marker.
+		if (marker[1] == 0xFF)
+		{
+			in.seekg(-1, std::ios::cur);
+			continue;
+		}
+		if (!in.read((char*)marker + 2, 2))
+			return false;
+		int length = (marker[2] << 8) | marker[3];
+
+		// SOF0 to SOF15, apart from DHT (C4), JPG (C8) and DAC (CC), which share the range.
+		if (marker[1] >= 0xC0 && marker[1] <= 0xCF && marker[1] != 0xC4 && marker[1] != 0xC8 && marker[1] != 0xCC)
+		{
+			unsigned char frame[5];
+			if (!in.read((char*)frame, 5))
+				return false;
+			height = (frame[1] << 8) | frame[2];
+			width = (frame[3] << 8) | frame[4];
+			return true;
+		}
+		in.seekg(length - 2, std::ios::cur);
+	}
+}
+
+// One mip level from the one above it: every pixel is the average of a 2x2 block. Odd sizes repeat the last row and column.
+static void downsample(const unsigned char* source, int sourceSize, unsigned char* target, int targetSize)
+{
+	for (int y = 0; y < targetSize; y++)
+	{
+		const unsigned char* row0 = source + std::min(2 * y, sourceSize - 1) * sourceSize * 4;
+		const unsigned char* row1 = source + std::min(2 * y + 1, sourceSize - 1) * sourceSize * 4;
+		for (int x = 0; x < targetSize; x++)
+		{
+			int x0 = std::min(2 * x, sourceSize - 1) * 4;
+			int x1 = std::min(2 * x + 1, sourceSize - 1) * 4;
+			for (int c = 0; c < 4; c++)
+				target[(y * targetSize + x) * 4 + c] = (unsigned char)((row0[x0 + c] + row0[x1 + c] + row1[x0 + c] + row1[x1 + c] + 2) / 4);
+		}
+	}
+}
+
+CubeMapStream::CubeMapStream() : decoded(CUBE_MAP_FACES)
+{
+	texture = 0;
+	size = 0;
+	levels = 0;
+	baseLevel = 0;
+	pendingFaces = 0;
+	nextFace = 0;
+	stopping = false;
+	uploader = NULL;
+	startTime = 0.0;
+	frames = 0;
+	longestUpdate = 0.0;
+	for (int i = 0; i < CUBE_MAP_FACES; i++)
+	{
+		files[i] = NULL;
+		faces[i].decoded.face = i;
+		faces[i].decoded.pixels = NULL;
+		faces[i].decoded.mipmaps = NULL;
+		faces[i].decoded.block = NULL;
+		faces[i].level = -1;
+		faces[i].row = 0;
+		faces[i].failed = false;
+	}
+}
+
+CubeMapStream::~CubeMapStream()
+{
+	// Only the threads and the memory: the OpenGL context may already be gone.
+	stopDecoding();
+}
+
+bool CubeMapStream::start(const char* const faceFiles[CUBE_MAP_FACES], int decodeThreads, TextureUploader* ringUploader, float anisotropy)
+{
+	release();
+	int width, height;
+	if (!readImageSize(faceFiles[0], width, height) || width != height || width <= 0)
+		return false;
+
+	size = width;
+	levels = std::min(cubeMapLevels(size), CUBE_MAP_MAX_LEVELS);
+	baseLevel = levels - 1;
+	pendingFaces = CUBE_MAP_FACES;
+	uploader = (ringUploader && ringUploader->ready()) ? ringUploader : NULL;
+	startTime = glfwGetTime();
+	frames = 0;
+	longestUpdate = 0.0;
+	for (int i = 0; i < CUBE_MAP_FACES; i++)
+	{
+		files[i] = faceFiles[i];
+		faces[i].decoded.face = i;
+		faces[i].decoded.pixels = NULL;
+		faces[i].decoded.mipmaps = NULL;
+		faces[i].decoded.block = NULL;
+		faces[i].level = levels - 1;
+		faces[i].row = 0;
+		faces[i].failed = false;
+	}
+
+	// All the levels now, the grey placeholder in the last one, and the sampling clamped to it.
+	glGenTextures(1, &texture);
+	glBindTexture(GL_TEXTURE_CUBE_MAP, texture);
+	glTexStorage2D(GL_TEXTURE_CUBE_MAP, levels, GL_RGBA8, size, size);
+	const unsigned char grey[4] = { 128, 128, 128, 255 };
+	for (int i = 0; i < CUBE_MAP_FACES; i++)
+		glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + i, levels - 1, 0, 0, 1, 1, GL_RGBA, GL_UNSIGNED_BYTE, grey);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, baseLevel);
+	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAX_LEVEL, levels - 1);
+	setCubeMapSampling(anisotropy);
+
+	stopping = false;
+	nextFace = 0;
+	decodeThreads = std::min(std::max(1, decodeThreads), CUBE_MAP_FACES);
+	for (int i = 0; i < decodeThreads; i++)
+		decoders.push_back(std::thread(&CubeMapStream::decodeLoop, this));
+	return true;
+}
+
+void CubeMapStream::decodeLoop()
+{
+	while (!stopping)
+	{
+		int face = nextFace++;
+		if (face >= CUBE_MAP_FACES)
+			return;
+
+		DecodedFace result;
+		result.face = face;
+		result.mipmaps = NULL;
+		result.block = NULL;
+		int width, height;
+		result.pixels = SOIL_load_image(files[face], &width, &height, 0, SOIL_LOAD_RGBA);
+		if (result.pixels && (width != size || height != size))
+		{
+			SOIL_free_image_data(result.pixels);
+			result.pixels = NULL;
+		}
+
+		if (result.pixels)
+		{
+			// The smaller levels, each one averaged from the one before, in client memory: the ring is mapped write only and
+			// may be uncached, so nothing is read back from it.
+			size_t levelBytes = (size_t)size * size * 4;
+			size_t bytes = 0;
+			for (int level = 1; level < levels; level++)
+				bytes += (size_t)levelSize(level) * levelSize(level) * 4;
+			result.mipmaps = new unsigned char[bytes];
+			const unsigned char* source = result.pixels;
+			unsigned char* target = result.mipmaps;
+			for (int level = 1; level < levels; level++)
+			{
+				downsample(source, levelSize(level - 1), target, levelSize(level));
+				source = target;
+				target += (size_t)levelSize(level) * levelSize(level) * 4;
+			}
+
+			// Then the whole chain into the upload ring if there is one, in one pass from front to back, waiting for the GPU to
+			// finish with the faces before if it is full.
+			if (uploader && levelBytes + bytes <= uploader->size)
+			{
+				while (!stopping && !(result.block = uploader->allocate(levelBytes + bytes)))
+					std::this_thread::sleep_for(std::chrono::milliseconds(1));
+			}
+			if (result.block)
+			{
+				memcpy(result.block, result.pixels, levelBytes);
+				memcpy(result.block + levelBytes, result.mipmaps, bytes);
+				SOIL_free_image_data(result.pixels);
+				delete[] result.mipmaps;
+				result.pixels = result.block;
+				result.mipmaps = result.block + levelBytes;
+			}
+		}
+
+		// The queue has room for every face, so this never fails.
+		decoded.push(result);
+	}
+}
+
+void CubeMapStream::receive(const DecodedFace& face)
+{
+	FaceState& state = faces[face.face];
+	state.decoded = face;
+	if (!face.pixels)
+	{
+		// The face is streamed like the others, grey in every level, so the base level of the other faces still moves down.
+		// One level of the full size serves all of them.
+		std::cout << "\n Can't load cube map face: " << files[face.face] << " (missing, or not " << size << "x" << size << ")";
+		state.failed = true;
+		size_t levelBytes = (size_t)size * size * 4;
+		state.decoded.mipmaps = new unsigned char[levelBytes];
+		for (size_t i = 0; i < levelBytes; i += 4)
+		{
+			state.decoded.mipmaps[i] = 128;
+			state.decoded.mipmaps[i + 1] = 128;
+			state.decoded.mipmaps[i + 2] = 128;
+			state.decoded.mipmaps[i + 3] = 255;
+		}
+		state.decoded.pixels = state.decoded.mipmaps;
+		for (int level = 0; level < levels; level++)
+			state.levelPixels[level] = state.decoded.mipmaps;
+		return;
+	}
+
+	state.levelPixels[0] = face.pixels;
+	unsigned char* pixels = face.mipmaps;
+	for (int level = 1; level < levels; level++)
+	{
+		state.levelPixels[level] = pixels;
+		pixels += (size_t)levelSize(level) * levelSize(level) * 4;
+	}
+}
+
+void CubeMapStream::update(GLStateCache& state)
+{
+	bool wasPending = !finished();
+	double start = glfwGetTime();
+	frames++;
+	upload(state, CUBE_MAP_STREAM_BUDGET);
+	longestUpdate = std::max(longestUpdate, glfwGetTime() - start);
+
+	if (wasPending && finished())
+	{
+		std::cout << "\n Cube map streamed: " << size << "x" << size << " after " << frames << " frames, "
+			<< (glfwGetTime() - startTime) * 1000.0 << " ms, at most " << longestUpdate * 1000.0 << " ms a frame on the GL thread"
+			<< (uploader ? " (from the upload ring)" : "");
+	}
+}
+
+void CubeMapStream::upload(GLStateCache& state, size_t budget)
+{
+	DecodedFace arrived;
+	while (decoded.pop(arrived))
+		receive(arrived);
+
+	size_t uploaded = 0;
+	while (uploaded < budget)
+	{
+		// The coarsest level any decoded face still needs, so all the faces get sharper together.
+		int next = -1;
+		for (int i = 0; i < CUBE_MAP_FACES; i++)
+		{
+			if (faces[i].decoded.pixels && faces[i].level >= 0 && (next < 0 || faces[i].level > faces[next].level))
+				next = i;
+		}
+		if (next < 0)
+			break;
+
+		FaceState& face = faces[next];
+		int width = levelSize(face.level);
+		size_t rowBytes = (size_t)width * 4;
+		int rows = (int)std::min((size_t)(width - face.row), std::max((size_t)1, (budget - uploaded) / rowBytes));
+		const unsigned char* pixels = face.levelPixels[face.level] + face.row * rowBytes;
+		state.activeTexture(GL_TEXTURE0);
+		state.bindTexture(GL_TEXTURE_CUBE_MAP, texture);
+		if (face.decoded.block)
+		{
+			// Only queues a copy from the ring.
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, uploader->buffer);
+			glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + next, face.level, 0, face.row, width, rows, GL_RGBA, GL_UNSIGNED_BYTE, uploader->offset(pixels));
+			glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+		}
+		else
+			glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X + next, face.level, 0, face.row, width, rows, GL_RGBA, GL_UNSIGNED_BYTE, pixels);
+		uploaded += rows * rowBytes;
+
+		face.row += rows;
+		if (face.row == width)
+		{
+			face.row = 0;
+			face.level--;
+			if (face.level < 0)
+			{
+				// The copies from the ring are issued, so its block can be retired.
+				freeFace(face.decoded);
+				pendingFaces--;
+			}
+		}
+	}
+
+	updateBaseLevel(state);
+}
+
+void CubeMapStream::updateBaseLevel(GLStateCache& state)
+{
+	// A face is complete down to the level above the one it is uploading.
+	int finest = 0;
+	for (int i = 0; i < CUBE_MAP_FACES; i++)
+		finest = std::max(finest, std::min(levels - 1, faces[i].level + 1));
+	if (finest != baseLevel)
+	{
+		baseLevel = finest;
+		state.activeTexture(GL_TEXTURE0);
+		state.bindTexture(GL_TEXTURE_CUBE_MAP, texture);
+		glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_BASE_LEVEL, baseLevel);
+	}
+}
+
+void CubeMapStream::finish(GLStateCache& state)
+{
+	while (!finished())
+	{
+		upload(state, (size_t)-1);
+		if (uploader)
+			uploader->update();
+		if (!finished())
+			std::this_thread::yield();
+	}
+}
+
+void CubeMapStream::freeFace(DecodedFace& face)
+{
+	if (face.block)
+		uploader->retire(face.block);
+	else
+	{
+		// The grey of a face which could not be loaded is in mipmaps alone.
+		if (face.pixels && face.pixels != face.mipmaps)
+			SOIL_free_image_data(face.pixels);
+		delete[] face.mipmaps;
+	}
+	face.pixels = NULL;
+	face.mipmaps = NULL;
+	face.block = NULL;
+}
+
+void CubeMapStream::stopDecoding()
+{
+	stopping = true;
+	for (size_t i = 0; i < decoders.size(); i++)
+		decoders[i].join();
+	decoders.clear();
+
+	// The faces which were decoded but not uploaded.
+	DecodedFace face;
+	while (decoded.pop(face))
+		freeFace(face);
+	for (int i = 0; i < CUBE_MAP_FACES; i++)
+	{
+		if (faces[i].level >= 0)
+			freeFace(faces[i].decoded);
+	}
+	pendingFaces = 0;
+}
+
+void CubeMapStream::release()
+{
+	stopDecoding();
+	if (texture)
+		glDeleteTextures(1, &texture);
+	texture = 0;
+}
@@ -0,0 +1,156 @@
+/*
+Title: Reflection and refraction
+File Name: CubeMapStream.h
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Description:
+A cube map which is on screen from the first frame and gets sharper over
+the frames after it, instead of holding up the start until all six
+faces are decoded and uploaded.
+
+start() reads the size of the faces from the header of the first file
+and allocates the whole mip chain at once with glTexStorage2D, so the
+texture never changes size while it fills up. The last level, one pixel
+per face, is set to grey right away, and GL_TEXTURE_BASE_LEVEL and
+GL_TEXTURE_MAX_LEVEL clamp the sampling to it.
+
+Background threads decode the faces (SOIL cannot decode a JPEG at a
+smaller size, so every face is decoded whole) and build the rest of its
+mip chain by averaging 2x2 blocks. A finished face is handed to the GL
+thread through a LockFreeQueue. Once per frame, update() uploads
+decoded levels, the smallest first, until the bytes of the frame
+budget are used up.
+
+With a TextureUploader, the threads build the mip chain in their own
+memory as well, then copy the face and its mip chain into the upload
+ring in one sequential pass, which is only ever written, and update()
+only queues copies from the ring on the GPU (see TextureUploader.h).
+Without one, the pixels are copied from client memory by glTexSubImage2D. Large levels are uploaded in bands of rows, so a
+2048x2048 face is spread over several frames instead of stalling one.
+Whenever every face has a finer level, the base level moves down to it.
+A face which cannot be loaded is streamed grey in all its levels, so it
+does not hold the other faces at the placeholder.
+
+The texture is sampled trilinearly like a loaded one (see
+CubeMapLoader.h). The levels are uploaded from the smallest up, so all
+the levels below the base level are always complete and the filtering
+never reads one which is still missing.
+*/
+
+#ifndef _CUBE_MAP_STREAM_H
+#define _CUBE_MAP_STREAM_H
+
+#include "GLIncludes.h"
+#include "GLStateCache.h"
+#include "CubeMapLoader.h"
+#include "LockFreeQueue.h"
+#include "TextureUploader.h"
+#include <thread>
+#include <atomic>
+
+// The most bytes update() uploads in a frame. At least one band of rows goes up every frame, however large the rows are.
+#define CUBE_MAP_STREAM_BUDGET (2 * 1024 * 1024)
+
+// Enough for faces of 32768x32768.
+#define CUBE_MAP_MAX_LEVELS 16
+
+struct CubeMapStream
+{
+	GLuint texture;
+	int size;					// Width and height of level 0 of every face
+	int levels;
+	int baseLevel;				// The finest level all the faces have, which is the one sampled
+
+	CubeMapStream();
+	~CubeMapStream();
+
+	// Creates the texture with a grey placeholder and starts decoding the files (posx, negx, posy, negy, posz, negz) on
+	// decodeThreads threads. Returns false if the size of the faces cannot be read from the first file. Binds the texture to
+	// GL_TEXTURE_CUBE_MAP on the active texture unit directly, not through a GLStateCache. The file names are not copied.
+	// uploader, if not NULL, has to stay initialized until the stream is finished or released. anisotropy is as for loadCubeMap().
+	bool start(const char* const files[CUBE_MAP_FACES], int decodeThreads, TextureUploader* uploader = NULL, float anisotropy = 1.0f);
+
+	// Uploads the decoded levels the frame budget allows. Call it once per frame on the GL thread; it binds the texture through state.
+	void update(GLStateCache& state);
+
+	// Waits for the decoding and uploads everything that is left.
+	void finish(GLStateCache& state);
+
+	// True once every face has all its levels, or could not be loaded.
+	bool finished() const { return pendingFaces == 0; }
+
+	// Stops the decoding threads and deletes the texture.
+	void release();
+
+private:
+	// A face as the decoding threads hand it over: level 0, then the smaller levels one after the other in mipmaps. Either both are
+	// in a block of the upload ring, or level 0 is from SOIL and the mipmaps from new[].
+	struct DecodedFace
+	{
+		int face;
+		unsigned char* pixels;
+		unsigned char* mipmaps;
+		unsigned char* block;	// The block of the upload ring, NULL if not in the ring
+	};
+
+	// What the GL thread knows about a face.
+	struct FaceState
+	{
+		DecodedFace decoded;
+		unsigned char* levelPixels[CUBE_MAP_MAX_LEVELS];
+		int level;				// The next level to upload, from levels - 1 down to 0, -1 once done
+		int row;				// The first row of it which is not uploaded yet
+		bool failed;			// Could not be loaded, streamed grey
+	};
+
+	const char* files[CUBE_MAP_FACES];
+	FaceState faces[CUBE_MAP_FACES];
+	int pendingFaces;
+
+	LockFreeQueue<DecodedFace> decoded;
+	std::vector<std::thread> decoders;
+	std::atomic<int> nextFace;			// The next face a decoding thread takes
+	std::atomic<bool> stopping;
+
+	TextureUploader* uploader;
+
+	double startTime;
+	int frames;
+	double longestUpdate;		// The most time update() took in a frame, in seconds
+
+	int levelSize(int level) const { return std::max(1, size >> level); }
+	void decodeLoop();
+	void stopDecoding();
+	void receive(const DecodedFace& face);
+	void upload(GLStateCache& state, size_t budget);
+	void freeFace(DecodedFace& face);
+	void updateBaseLevel(GLStateCache& state);
+
+	// Not copyable.
+	CubeMapStream(const CubeMapStream&);
+	CubeMapStream& operator=(const CubeMapStream&);
+};
+
+// Reads the width and height of a JPEG or PNG file from its header, without decoding it.
+bool readImageSize(const char* file, int& width, int& height);
+
+#endif //_CUBE_MAP_STREAM_H
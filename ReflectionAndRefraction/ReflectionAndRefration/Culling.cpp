@@ -0,0 +1,202 @@
+/*
+Title: Reflection and refraction
+File Name: Culling.cpp
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+SIMD frustum culling of bounding spheres, see Culling.h.
+*/
+
+#include "Culling.h"
+#include <emmintrin.h>
+#ifdef __AVX__
+#include <immintrin.h>
+#endif
+
+void SphereBounds::resize(int count)
+{
+	x.resize(count);
+	y.resize(count);
+	z.resize(count);
+	radius.resize(count);
+}
+
+void SphereBounds::set(int index, const glm::vec3& center, float r)
+{
+	x[index] = center.x;
+	y[index] = center.y;
+	z[index] = center.z;
+	radius[index] = r;
+}
+
+int SphereBounds::add(const glm::vec3& center, float r)
+{
+	x.push_back(center.x);
+	y.push_back(center.y);
+	z.push_back(center.z);
+	radius.push_back(r);
+	return size() - 1;
+}
+
+// Gribb and Hartmann: every plane is a sum or difference of the fourth row of PV and one of the other rows.
+void frustumPlanes(const glm::mat4& PV, glm::vec4 planes[6])
+{
+	glm::vec4 rows[4];
+	for (int r = 0; r < 4; r++)
+		rows[r] = glm::vec4(PV[0][r], PV[1][r], PV[2][r], PV[3][r]);
+
+	planes[0] = rows[3] + rows[0];		// left
+	planes[1] = rows[3] - rows[0];		// right
+	planes[2] = rows[3] + rows[1];		// bottom
+	planes[3] = rows[3] - rows[1];		// top
+	planes[4] = rows[3] + rows[2];		// near
+	planes[5] = rows[3] - rows[2];		// far
+	for (int i = 0; i < 6; i++)
+		planes[i] /= glm::length(glm::vec3(planes[i]));
+}
+
+// For every 4 bit mask of visible spheres: the positions of the set bits, and how many there are.
+// The kernels store all four entries and then move the output on by the count, so they never branch on the mask.
+static const unsigned char maskIndices[16][4] = {
+	{ 0, 0, 0, 0 }, { 0, 0, 0, 0 }, { 1, 0, 0, 0 }, { 0, 1, 0, 0 },
+	{ 2, 0, 0, 0 }, { 0, 2, 0, 0 }, { 1, 2, 0, 0 }, { 0, 1, 2, 0 },
+	{ 3, 0, 0, 0 }, { 0, 3, 0, 0 }, { 1, 3, 0, 0 }, { 0, 1, 3, 0 },
+	{ 2, 3, 0, 0 }, { 0, 2, 3, 0 }, { 1, 2, 3, 0 }, { 0, 1, 2, 3 } };
+static const unsigned char maskCount[16] = { 0, 1, 1, 2, 1, 2, 2, 3, 1, 2, 2, 3, 2, 3, 3, 4 };
+
+static inline GLuint* appendVisible(GLuint* out, GLuint first, int mask)
+{
+	out[0] = first + maskIndices[mask][0];
+	out[1] = first + maskIndices[mask][1];
+	out[2] = first + maskIndices[mask][2];
+	out[3] = first + maskIndices[mask][3];
+	return out + maskCount[mask];
+}
+
+static GLuint* cullScalar(const glm::vec4 planes[6], const SphereBounds& bounds, int first, int last, GLuint* out)
+{
+	for (int i = first; i < last; i++)
+	{
+		bool inside = true;
+		for (int p = 0; p < 6; p++)
+			inside = inside && (planes[p].x * bounds.x[i] + planes[p].y * bounds.y[i] + planes[p].z * bounds.z[i] + planes[p].w >= -bounds.radius[i]);
+		if (inside)
+			*out++ = (GLuint)i;
+	}
+	return out;
+}
+
+static GLuint* cullSSE(const glm::vec4 planes[6], const SphereBounds& bounds, int first, int last, int& done, GLuint* out)
+{
+	__m128 px[6], py[6], pz[6], pw[6];
+	for (int p = 0; p < 6; p++)
+	{
+		px[p] = _mm_set1_ps(planes[p].x);
+		py[p] = _mm_set1_ps(planes[p].y);
+		pz[p] = _mm_set1_ps(planes[p].z);
+		pw[p] = _mm_set1_ps(planes[p].w);
+	}
+	const __m128 signBit = _mm_set1_ps(-0.0f);
+
+	int end = first + ((last - first) & ~3);
+	for (int i = first; i < end; i += 4)
+	{
+		__m128 x = _mm_loadu_ps(&bounds.x[i]);
+		__m128 y = _mm_loadu_ps(&bounds.y[i]);
+		__m128 z = _mm_loadu_ps(&bounds.z[i]);
+		__m128 negativeRadius = _mm_xor_ps(_mm_loadu_ps(&bounds.radius[i]), signBit);
+
+		// distance to the plane >= -radius, for all six planes
+		__m128 inside = _mm_castsi128_ps(_mm_set1_epi32(-1));
+		for (int p = 0; p < 6; p++)
+		{
+			__m128 distance = _mm_add_ps(_mm_add_ps(_mm_mul_ps(x, px[p]), _mm_mul_ps(y, py[p])), _mm_add_ps(_mm_mul_ps(z, pz[p]), pw[p]));
+			inside = _mm_and_ps(inside, _mm_cmpge_ps(distance, negativeRadius));
+		}
+		out = appendVisible(out, (GLuint)i, _mm_movemask_ps(inside));
+	}
+	done = end;
+	return out;
+}
+
+#ifdef __AVX__
+static GLuint* cullAVX(const glm::vec4 planes[6], const SphereBounds& bounds, int first, int last, int& done, GLuint* out)
+{
+	__m256 px[6], py[6], pz[6], pw[6];
+	for (int p = 0; p < 6; p++)
+	{
+		px[p] = _mm256_set1_ps(planes[p].x);
+		py[p] = _mm256_set1_ps(planes[p].y);
+		pz[p] = _mm256_set1_ps(planes[p].z);
+		pw[p] = _mm256_set1_ps(planes[p].w);
+	}
+	const __m256 signBit = _mm256_set1_ps(-0.0f);
+
+	int end = first + ((last - first) & ~7);
+	for (int i = first; i < end; i += 8)
+	{
+		__m256 x = _mm256_loadu_ps(&bounds.x[i]);
+		__m256 y = _mm256_loadu_ps(&bounds.y[i]);
+		__m256 z = _mm256_loadu_ps(&bounds.z[i]);
+		__m256 negativeRadius = _mm256_xor_ps(_mm256_loadu_ps(&bounds.radius[i]), signBit);
+
+		__m256 inside = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+		for (int p = 0; p < 6; p++)
+		{
+			__m256 distance = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(x, px[p]), _mm256_mul_ps(y, py[p])), _mm256_add_ps(_mm256_mul_ps(z, pz[p]), pw[p]));
+			inside = _mm256_and_ps(inside, _mm256_cmp_ps(distance, negativeRadius, _CMP_GE_OQ));
+		}
+		int mask = _mm256_movemask_ps(inside);
+		out = appendVisible(out, (GLuint)i, mask & 15);
+		out = appendVisible(out, (GLuint)i + 4, mask >> 4);
+	}
+	done = end;
+	return out;
+}
+#endif
+
+int cullSpheres(const glm::vec4 planes[6], const SphereBounds& bounds, std::vector<GLuint>& visible, CullingKernel kernel)
+{
+	return cullSpheres(planes, bounds, 0, bounds.size(), visible, kernel);
+}
+
+int cullSpheres(const glm::vec4 planes[6], const SphereBounds& bounds, int first, int last, std::vector<GLuint>& visible, CullingKernel kernel)
+{
+	// Room for every sphere, plus the entries the kernels write past the last visible one.
+	visible.resize(last - first + 8);
+	GLuint* out = &visible[0];
+	int done = first;
+
+#ifdef __AVX__
+	if (kernel == CULL_AVX || kernel == CULL_BEST)
+		out = cullAVX(planes, bounds, first, last, done, out);
+	else
+#endif
+	if (kernel != CULL_SCALAR)
+		out = cullSSE(planes, bounds, first, last, done, out);
+
+	// The last few spheres which do not fill a whole register.
+	out = cullScalar(planes, bounds, done, last, out);
+
+	int count = (int)(out - &visible[0]);
+	visible.resize(count);
+	return count;
+}
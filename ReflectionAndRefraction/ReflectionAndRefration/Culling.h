@@ -0,0 +1,77 @@
+/*
+Title: Reflection and refraction
+File Name: Culling.h
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+Frustum culling of bounding spheres on the CPU.
+
+The spheres are kept as a structure of arrays (SphereBounds): all the x
+coordinates together, then all the y, z and radii. That way one SIMD
+load gets the same component of 4 (SSE) or 8 (AVX) spheres, and every
+plane test is a multiply-add over whole registers. The result of the
+six plane tests is a bit mask, which is turned into a list of visible
+indices without branches through a lookup table.
+
+A sphere is kept unless it is completely behind one of the planes, so a
+few spheres near the corners of the frustum are kept although they are
+not visible. That is the usual trade off for such a cheap test.
+*/
+
+#ifndef _CULLING_H
+#define _CULLING_H
+
+#include "GLIncludes.h"
+
+// Bounding spheres, one array per component.
+struct SphereBounds
+{
+	std::vector<float> x;
+	std::vector<float> y;
+	std::vector<float> z;
+	std::vector<float> radius;
+
+	int size() const { return (int)x.size(); }
+	void resize(int count);
+	void set(int index, const glm::vec3& center, float r);
+
+	// Adds a sphere at the end and returns its index.
+	int add(const glm::vec3& center, float r);
+};
+
+enum CullingKernel
+{
+	CULL_SCALAR,			// One sphere at a time
+	CULL_SSE,				// 4 spheres at a time
+	CULL_AVX,				// 8 spheres at a time, only if the program is compiled with AVX enabled (/arch:AVX); SSE otherwise
+	CULL_BEST				// AVX if it is compiled in, SSE otherwise
+};
+
+// The six planes of the view frustum of PV as (normal, distance), normalized, pointing inwards.
+void frustumPlanes(const glm::mat4& PV, glm::vec4 planes[6]);
+
+// Writes the indices of the spheres which are not completely outside the frustum to visible, in increasing order, and returns how many there are.
+int cullSpheres(const glm::vec4 planes[6], const SphereBounds& bounds, std::vector<GLuint>& visible, CullingKernel kernel = CULL_BEST);
+
+// The same for the spheres first to last - 1 only, so parts of the bounds can be culled on different threads. The indices are still indices into bounds.
+int cullSpheres(const glm::vec4 planes[6], const SphereBounds& bounds, int first, int last, std::vector<GLuint>& visible, CullingKernel kernel = CULL_BEST);
+
+#endif //_CULLING_H
@@ -0,0 +1,164 @@
+/*
+Title: Reflection and refraction
+File Name: DrawList.cpp
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+Sort keys, radix sort and submission of the draw list, see DrawList.h.
+*/
+
+#include "DrawList.h"
+
+#define STATE_BITS 12
+#define DEPTH_BITS 24
+
+unsigned long long makeSortKey(RenderPass pass, GLuint program, GLuint texture, GLuint vao, float depth)
+{
+	const unsigned long long stateMask = (1 << STATE_BITS) - 1;
+	const unsigned long long depthMask = (1 << DEPTH_BITS) - 1;
+
+	unsigned long long quantizedDepth = (unsigned long long)(glm::clamp(depth, 0.0f, 1.0f) * depthMask);
+	unsigned long long state = ((program & stateMask) << (2 * STATE_BITS)) | ((texture & stateMask) << STATE_BITS) | (vao & stateMask);
+
+	// 4 bits of pass, then 36 bits of state and 24 bits of depth, in the order of the pass.
+	unsigned long long key = (unsigned long long)pass << 60;
+	if (pass == PASS_TRANSPARENT)
+		key |= ((depthMask - quantizedDepth) << (3 * STATE_BITS)) | state;
+	else
+		key |= (state << DEPTH_BITS) | quantizedDepth;
+	return key;
+}
+
+void radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch)
+{
+	size_t count = entries.size();
+	scratch.resize(count);
+	if (count < 2)
+		return;
+
+	// All eight histograms in one pass over the keys.
+	size_t histograms[8][256];
+	memset(histograms, 0, sizeof(histograms));
+	for (size_t i = 0; i < count; i++)
+	{
+		unsigned long long key = entries[i].key;
+		for (int b = 0; b < 8; b++)
+			histograms[b][(key >> (8 * b)) & 255]++;
+	}
+
+	SortEntry* from = &entries[0];
+	SortEntry* to = &scratch[0];
+	for (int b = 0; b < 8; b++)
+	{
+		size_t* histogram = histograms[b];
+
+		// Every key has the same byte here, this pass would not move anything.
+		if (histogram[(from[0].key >> (8 * b)) & 255] == count)
+			continue;
+
+		size_t offset = 0;
+		for (int d = 0; d < 256; d++)
+		{
+			size_t n = histogram[d];
+			histogram[d] = offset;
+			offset += n;
+		}
+		for (size_t i = 0; i < count; i++)
+			to[histogram[(from[i].key >> (8 * b)) & 255]++] = from[i];
+		std::swap(from, to);
+	}
+
+	// An odd number of passes leaves the result in scratch.
+	if (from != &entries[0])
+		entries.swap(scratch);
+}
+
+void DrawList::clear()
+{
+	commands.clear();
+	order.clear();
+}
+
+void DrawList::add(RenderPass pass, GLuint program, GLuint texture, GLuint vao, float distance, const CommandList& recorded, size_t begin)
+{
+	DrawCommand command;
+	command.program = program;
+	command.texture = texture;
+	command.vao = vao;
+	command.commands = &recorded;
+	command.begin = begin;
+	command.end = recorded.size();
+
+	SortEntry entry;
+	entry.key = makeSortKey(pass, program, texture, vao, distance / farDistance);
+	entry.index = (GLuint)commands.size();
+
+	commands.push_back(command);
+	order.push_back(entry);
+}
+
+void DrawList::append(const DrawList& other)
+{
+	GLuint first = (GLuint)commands.size();
+	commands.insert(commands.end(), other.commands.begin(), other.commands.end());
+	for (size_t i = 0; i < other.order.size(); i++)
+	{
+		SortEntry entry = other.order[i];
+		entry.index += first;
+		order.push_back(entry);
+	}
+}
+
+void DrawList::sort()
+{
+	radixSort(order, scratch);
+}
+
+void DrawList::submit(GLStateCache& state)
+{
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		const DrawCommand& command = commands[order[i].index];
+		state.useProgram(command.program);
+		state.activeTexture(GL_TEXTURE0);
+		state.bindTexture(GL_TEXTURE_CUBE_MAP, command.texture);
+		state.bindVertexArray(command.vao);
+		command.commands->replay(command.begin, command.end, state);
+	}
+}
+
+DrawStats DrawList::countStateChanges() const
+{
+	DrawStats stats = { 0, 0, 0, 0 };
+	GLuint program = 0, texture = 0, vao = 0;
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		const DrawCommand& command = commands[order[i].index];
+		stats.programChanges += command.program != program;
+		stats.textureChanges += command.texture != texture;
+		stats.vaoChanges += command.vao != vao;
+		program = command.program;
+		texture = command.texture;
+		vao = command.vao;
+		stats.draws++;
+	}
+	return stats;
+}
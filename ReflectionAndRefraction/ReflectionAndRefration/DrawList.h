@@ -0,0 +1,122 @@
+/*
+Title: Reflection and refraction
+File Name: DrawList.h
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+A list of the draws of one frame, sorted by the render state they need
+before they are submitted.
+
+Every draw gets a 64 bit sort key. The highest bits are the pass, so the
+passes are drawn in order. Inside the opaque pass the key continues with
+the program, the texture and the VAO, and ends with the depth: draws
+which share a program end up next to each other, and the same for the
+texture and VAO below it, so each of them is bound as few times as
+possible, and draws with the same state go front to back so the depth
+test rejects more hidden pixels. In the transparent pass the depth comes
+first, inverted, so the draws go back to front as blending needs, and
+the state only decides between draws at the same depth.
+
+The keys are sorted with a radix sort, 8 bits per pass, skipping the
+passes where all the keys have the same byte (the pass and program bytes
+usually do).
+
+The program, texture and VAO names are cut to 12 bits in the key. Names
+which collide only sort less well: submit() binds the real names through
+a GLStateCache, which drops the calls that change nothing.
+
+The draw itself (uniform ranges, draw calls) is a range of a CommandList.
+Worker threads can each fill their own DrawList and CommandList for a
+part of the scene; the GL thread appends the lists together, sorts once
+and replays the ranges in the sorted order.
+*/
+
+#ifndef _DRAW_LIST_H
+#define _DRAW_LIST_H
+
+#include "GLIncludes.h"
+#include "GLStateCache.h"
+#include "CommandList.h"
+
+enum RenderPass
+{
+	PASS_OPAQUE,			// Sorted by state, then front to back
+	PASS_SKY,				// After the opaque draws, at the far plane, so it only shades the pixels nothing else covers
+	PASS_TRANSPARENT		// Sorted back to front, over the sky
+};
+
+struct DrawCommand
+{
+	GLuint program;
+	GLuint texture;			// Cube map bound to texture unit 0, 0 for none
+	GLuint vao;
+	// The per draw commands: bytes begin to end of commands, replayed once the program, texture and VAO are bound.
+	const CommandList* commands;
+	size_t begin;
+	size_t end;
+};
+
+// How much state changes between the draws, in the order of the list.
+struct DrawStats
+{
+	int draws;
+	int programChanges;
+	int textureChanges;
+	int vaoChanges;
+};
+
+// Packs the pass, state and depth into a key as described above. depth is the distance to the camera divided by the far distance.
+unsigned long long makeSortKey(RenderPass pass, GLuint program, GLuint texture, GLuint vao, float depth);
+
+// Sorts the entries by key, using scratch as the second buffer. The order of entries with the same key is kept.
+struct SortEntry
+{
+	unsigned long long key;
+	GLuint index;
+};
+void radixSort(std::vector<SortEntry>& entries, std::vector<SortEntry>& scratch);
+
+struct DrawList
+{
+	std::vector<DrawCommand> commands;
+	std::vector<SortEntry> order;			// After sort(), the commands in the order they are submitted
+	float farDistance;						// Distance which maps to the largest depth in the key
+
+	DrawList() : farDistance(100.0f) {}
+
+	void clear();
+	// Adds a draw made of the commands in recorded from byte begin up to its end. recorded has to outlive the submit().
+	void add(RenderPass pass, GLuint program, GLuint texture, GLuint vao, float distance, const CommandList& recorded, size_t begin);
+	// Adds all the draws of another list, with the keys they already have.
+	void append(const DrawList& other);
+	void sort();
+
+	// Binds the state of every draw through the cache and replays its commands. Call sort() first.
+	void submit(GLStateCache& state);
+
+	// The state changes between the sorted commands, without calling OpenGL.
+	DrawStats countStateChanges() const;
+
+private:
+	std::vector<SortEntry> scratch;
+};
+
+#endif //_DRAW_LIST_H
@@ -54,6 +54,8 @@ in vec3 refractDir;						// This variable hold the refracted vector
 
 uniform samplerCube CubeMapTex;
 
+// FrameUniforms and ObjectUniforms come from UniformBlocks.glsl, which readShader puts in after #version.
+
 layout(location = 0) out vec4 out_color; // Establishes the variable we will pass out of this shader.
 
 void main(void)
@@ -62,5 +64,5 @@ void main(void)
 	vec4 reflectColor = texture(CubeMapTex, reflectDir);
 	vec4 refractColor = texture(CubeMapTex, refractDir);
 	// use a small portion of the reflected color and a larger portion of the refracted color for a more realistic look.
-	out_color = reflectColor * 0.2f + refractColor * 0.75f + max((color * 0.5f),0.0f);
+	out_color = reflectColor * material.y + refractColor * material.z + max((color * material.w),0.0f);
 }
\ No newline at end of file
@@ -0,0 +1,111 @@
+/*
+Title: Reflection and refraction
+File Name: FragmentShaderImpostor.glsl
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+Fragment shader of the impostor path. Each pixel of the quad made by
+VertexShaderImpostor.glsl intersects its view ray with the sphere. Pixels
+which miss are discarded; the others get the exact point on the sphere,
+its depth, and the same lighting, reflection and refraction as the mesh,
+only computed for every pixel instead of every vertex.
+*/
+
+#version 430 core // Identifies the version of the shader, this line must be on a separate line from the rest of the shader code
+
+in vec3 worldPos;
+
+// FrameUniforms and ObjectUniforms come from UniformBlocks.glsl, which readShader puts in after #version.
+
+uniform samplerCube CubeMapTex;
+
+layout(location = 0) out vec4 out_color; // Establishes the variable we will pass out of this shader.
+
+// The quad is in front of the whole sphere, so the depth written here is never smaller than the depth of the quad itself.
+// Telling the GPU so keeps early depth testing working even though the shader writes gl_FragDepth.
+layout(depth_greater) out float gl_FragDepth;
+
+vec3 LightPos;								// Light properties.
+vec3 DiffuseLight;
+vec3 SpecularLight;
+
+//This function returns the component of the light reflected as diffuse texture.
+vec3 diffuseComponent(vec3 position, vec3 normal)
+{
+	vec3 s = normalize(LightPos - position);
+
+	return DiffuseLight * max(dot(s, normal),0.0f);
+}
+
+//This function deals with the light reflected due to specular behaviour
+vec3 specularComponent(vec3 position, vec3 normal)
+{
+	vec3 s = normalize(LightPos - position);
+	vec3 r = (2 * dot(s,normal) * normal) - s;
+	vec3 v = normalize(camPos - position);
+	
+	//the more the power of dot(v,r), the smaller the shinier the surface.
+	return SpecularLight * max(pow(dot(v,r),3),0.0f);
+}
+
+vec4 diffuseAndSpecular (vec3 position, vec3 normal)
+{
+	// This function uses the above two functions to calculate the lighting values.
+	return vec4((diffuseComponent(position,normal) + specularComponent(position, normal)),1.0f);
+}
+
+void main(void)
+{
+	// Ray from the camera through this pixel, against the sphere: |camPos + t * rayDir - center| = radius
+	vec3 rayDir = normalize(worldPos - camPos);
+	vec3 oc = camPos - center;
+	float b = dot(oc, rayDir);
+	float c = dot(oc, oc) - radius * radius;
+	float h = b * b - c;
+	if (h < 0.0f)
+		discard;
+
+	// The nearest of the two intersections.
+	vec3 hit = camPos + rayDir * (-b - sqrt(h));
+
+	// Depth of the hit point, in the same way the rasterizer would compute it for a triangle.
+	vec4 clip = PV * vec4(hit, 1.0f);
+	gl_FragDepth = (gl_DepthRange.diff * (clip.z / clip.w) + gl_DepthRange.near + gl_DepthRange.far) * 0.5f;
+
+	LightPos = vec3(3.0f, 3.0f,0.0f);
+	DiffuseLight = vec3 (0.5f,0.5f,0.5f);
+	SpecularLight = vec3(0.74f,0.74f,0.74f);
+
+	// The same calculations as VertexShader.glsl, with the point relative to the center of the sphere as position and normal.
+	vec3 pos = hit - center;
+	vec3 normal = pos;
+	vec3 viewDirection = normalize(camPos - pos);
+
+	vec3 reflectDir = reflect(-viewDirection, normal);
+	vec3 refractDir = refract(-viewDirection, normal, material.x);
+	vec4 color = diffuseAndSpecular(pos, normalize(normal));
+
+	//Sample the skybox texture.
+	vec4 reflectColor = texture(CubeMapTex, reflectDir);
+	vec4 refractColor = texture(CubeMapTex, refractDir);
+	// use a small portion of the reflected color and a larger portion of the refracted color for a more realistic look.
+	out_color = reflectColor * material.y + refractColor * material.z + max((color * material.w),0.0f);
+}
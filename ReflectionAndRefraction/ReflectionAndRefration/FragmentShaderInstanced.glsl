@@ -0,0 +1,46 @@
+/*
+Title: Reflection and refraction
+File Name: FragmentShaderInstanced.glsl
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+Fragment shader for the instanced spheres. The same as FragmentShader.glsl,
+with the weights of the reflection, refraction and lighting coming from
+the material of the instance.
+*/
+
+#version 430 core // Identifies the version of the shader, this line must be on a separate line from the rest of the shader code
+
+in vec4 color;
+in vec3 reflectDir;
+in vec3 refractDir;
+flat in vec3 weights;
+
+uniform samplerCube CubeMapTex;
+
+layout(location = 0) out vec4 out_color;
+
+void main(void)
+{
+	vec4 reflectColor = texture(CubeMapTex, reflectDir);
+	vec4 refractColor = texture(CubeMapTex, refractDir);
+	out_color = reflectColor * weights.x + refractColor * weights.y + max((color * weights.z),0.0f);
+}
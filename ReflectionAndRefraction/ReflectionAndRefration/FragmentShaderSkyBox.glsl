@@ -49,14 +49,21 @@ OpenGL 4 shading language cookbook by David Wolff
 
 #version 430 core // Identifies the version of the shader, this line must be on a separate line from the rest of the shader code
 
-in vec3 texCoord;
+in vec2 screenPosition;
 
 out vec4 out_color; // Establishes the variable we will pass out of this shader.
 
 layout(binding = 0) uniform samplerCube CubeMapTex;			
 
+// FrameUniforms and ObjectUniforms come from UniformBlocks.glsl, which readShader puts in after #version.
+
 void main(void)
 {	
+	//The point on the far plane behind this pixel, back in world space. The view ray goes from the camera through it,
+	//and the direction of the ray is the texture coordinate of the cube map.
+	vec4 farPoint = inversePV * vec4(screenPosition, 1.0, 1.0);
+	vec3 texCoord = farPoint.xyz / farPoint.w - camPos;
+
 	//Sample the cubemap
 	vec4 reflectColor = texture(CubeMapTex, texCoord);
 	out_color = (reflectColor);// Set our out_color equal to our in color, basically making this a pass-through shader.
@@ -53,6 +53,8 @@ OpenGL 4 shading language cookbook by David Wolff
 #include <fstream>
 #include <vector>
 #include <string>
+#include <cstring>
+#include <cstdlib>
 #include <algorithm>
 #include <Windows.h>
 #include "glew\glew.h"
@@ -64,7 +66,7 @@ OpenGL 4 shading language cookbook by David Wolff
 #include "glm\gtx\quaternion.hpp"
 #include <soil\SOIL.h>
 
-#define PI 3.147f
+#define PI 3.14159265f
 
 // We create a VertexFormat struct, which defines how the data passed into the shader code wil be formatted
 struct VertexFormat
@@ -0,0 +1,181 @@
+/*
+Title: Reflection and refraction
+File Name: GLStateCache.cpp
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+Redundant state call elimination, see GLStateCache.h.
+*/
+
+#include "GLStateCache.h"
+#include <iomanip>
+
+GLStateCache::GLStateCache()
+{
+	capabilities[0] = GL_DEPTH_TEST;
+	capabilities[1] = GL_CULL_FACE;
+	capabilities[2] = GL_BLEND;
+	capabilities[3] = GL_TEXTURE_CUBE_MAP_SEAMLESS;
+	invalidate();
+	beginFrame();
+}
+
+void GLStateCache::invalidate()
+{
+	program = UNKNOWN;
+	vao = UNKNOWN;
+	activeUnit = UNKNOWN;
+	for (int i = 0; i < GL_STATE_CACHE_TEXTURE_UNITS; i++)
+	{
+		textureTargets[i] = UNKNOWN;
+		textures[i] = UNKNOWN;
+	}
+	depthMaskValue = UNKNOWN;
+	depthFunction = UNKNOWN;
+	for (int i = 0; i < 4; i++)
+		capabilityValues[i] = UNKNOWN;
+}
+
+void GLStateCache::beginFrame()
+{
+	for (int i = 0; i < STATE_CALL_KINDS; i++)
+	{
+		issued[i] = 0;
+		skipped[i] = 0;
+	}
+}
+
+// Stores value and returns true if the call has to be made.
+bool GLStateCache::change(StateCall kind, GLuint& current, GLuint value)
+{
+	if (current == value)
+	{
+		skipped[kind]++;
+		return false;
+	}
+	current = value;
+	issued[kind]++;
+	return true;
+}
+
+void GLStateCache::useProgram(GLuint newProgram)
+{
+	if (change(STATE_PROGRAM, program, newProgram))
+		glUseProgram(newProgram);
+}
+
+void GLStateCache::bindVertexArray(GLuint newVao)
+{
+	if (change(STATE_VERTEX_ARRAY, vao, newVao))
+		glBindVertexArray(newVao);
+}
+
+void GLStateCache::activeTexture(GLenum unit)
+{
+	if (change(STATE_ACTIVE_TEXTURE, activeUnit, unit))
+		glActiveTexture(unit);
+}
+
+void GLStateCache::bindTexture(GLenum target, GLuint texture)
+{
+	// Nothing is known about the binding while the active unit is not.
+	GLuint unit = activeUnit - GL_TEXTURE0;
+	if (activeUnit == UNKNOWN || unit >= GL_STATE_CACHE_TEXTURE_UNITS)
+	{
+		issued[STATE_TEXTURE]++;
+		glBindTexture(target, texture);
+		return;
+	}
+
+	if (textureTargets[unit] != target)
+		textures[unit] = UNKNOWN;
+	textureTargets[unit] = target;
+	if (change(STATE_TEXTURE, textures[unit], texture))
+		glBindTexture(target, texture);
+}
+
+void GLStateCache::depthMask(GLboolean enabled)
+{
+	if (change(STATE_DEPTH_MASK, depthMaskValue, enabled ? GL_TRUE : GL_FALSE))
+		glDepthMask(enabled);
+}
+
+void GLStateCache::depthFunc(GLenum function)
+{
+	if (change(STATE_DEPTH_FUNC, depthFunction, function))
+		glDepthFunc(function);
+}
+
+void GLStateCache::setCapability(GLenum capability, bool enabled)
+{
+	// Capabilities which are not tracked are always passed on.
+	bool tracked = false;
+	for (int i = 0; i < 4; i++)
+	{
+		if (capabilities[i] != capability)
+			continue;
+		if (!change(STATE_CAPABILITY, capabilityValues[i], enabled ? 1 : 0))
+			return;
+		tracked = true;
+	}
+	if (!tracked)
+		issued[STATE_CAPABILITY]++;
+
+	if (enabled)
+		glEnable(capability);
+	else
+		glDisable(capability);
+}
+
+void GLStateCache::enable(GLenum capability)
+{
+	setCapability(capability, true);
+}
+
+void GLStateCache::disable(GLenum capability)
+{
+	setCapability(capability, false);
+}
+
+int GLStateCache::totalIssued() const
+{
+	int total = 0;
+	for (int i = 0; i < STATE_CALL_KINDS; i++)
+		total += issued[i];
+	return total;
+}
+
+int GLStateCache::totalSkipped() const
+{
+	int total = 0;
+	for (int i = 0; i < STATE_CALL_KINDS; i++)
+		total += skipped[i];
+	return total;
+}
+
+void GLStateCache::printCounters() const
+{
+	const char* names[STATE_CALL_KINDS] = { "glUseProgram", "glBindVertexArray", "glActiveTexture", "glBindTexture", "glDepthMask", "glDepthFunc", "glEnable/glDisable" };
+	std::cout << "\n" << std::setw(20) << "state call" << std::setw(10) << "issued" << std::setw(10) << "skipped";
+	for (int i = 0; i < STATE_CALL_KINDS; i++)
+		std::cout << "\n" << std::setw(20) << names[i] << std::setw(10) << issued[i] << std::setw(10) << skipped[i];
+	std::cout << "\n" << std::setw(20) << "total" << std::setw(10) << totalIssued() << std::setw(10) << totalSkipped() << "\n";
+}
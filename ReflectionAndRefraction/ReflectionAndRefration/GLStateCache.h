@@ -0,0 +1,106 @@
+/*
+Title: Reflection and refraction
+File Name: GLStateCache.h
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+A shadow copy of the OpenGL state the program changes while drawing: the
+program, the VAO, the active texture unit, the textures bound to each
+unit, the depth mask, the depth function and a few capabilities. The
+functions of GLStateCache take the same arguments as the OpenGL calls
+they replace, and only make the call if the value differs from the one
+already set. Every call is counted as issued or skipped, so the savings
+can be printed per frame.
+
+The cache has to see every change of the state it tracks. Code which
+changes it directly (the compute shader dispatch in GpuCulling, the
+upload functions of stuff_for_drawing) has to call invalidate() before
+the cache is used again, which makes it forget everything.
+*/
+
+#ifndef _GL_STATE_CACHE_H
+#define _GL_STATE_CACHE_H
+
+#include "GLIncludes.h"
+
+#define GL_STATE_CACHE_TEXTURE_UNITS 16
+
+// The kinds of calls the cache counts.
+enum StateCall
+{
+	STATE_PROGRAM,
+	STATE_VERTEX_ARRAY,
+	STATE_ACTIVE_TEXTURE,
+	STATE_TEXTURE,
+	STATE_DEPTH_MASK,
+	STATE_DEPTH_FUNC,
+	STATE_CAPABILITY,
+	STATE_CALL_KINDS
+};
+
+struct GLStateCache
+{
+	// Calls made and calls dropped since beginFrame(), per kind.
+	int issued[STATE_CALL_KINDS];
+	int skipped[STATE_CALL_KINDS];
+
+	GLStateCache();
+
+	// Forgets the state, so the next call of every kind reaches OpenGL.
+	void invalidate();
+
+	// Starts counting again.
+	void beginFrame();
+
+	void useProgram(GLuint program);
+	void bindVertexArray(GLuint vao);
+	void activeTexture(GLenum unit);
+	void bindTexture(GLenum target, GLuint texture);		// On the active unit
+	void depthMask(GLboolean enabled);
+	void depthFunc(GLenum function);
+	void enable(GLenum capability);
+	void disable(GLenum capability);
+
+	int totalIssued() const;
+	int totalSkipped() const;
+
+	// One line per kind of call with the counts since beginFrame().
+	void printCounters() const;
+
+private:
+	// Values which mean that the state is not known. 0xFFFFFFFF is not a valid name or enum.
+	enum { UNKNOWN = 0xFFFFFFFF };
+
+	GLuint program;
+	GLuint vao;
+	GLenum activeUnit;
+	GLenum textureTargets[GL_STATE_CACHE_TEXTURE_UNITS];		// The target of the texture bound to every unit, texture units hold one per target
+	GLuint textures[GL_STATE_CACHE_TEXTURE_UNITS];				// but this program only ever binds one target per unit.
+	GLuint depthMaskValue;
+	GLenum depthFunction;
+	GLenum capabilities[4];										// GL_DEPTH_TEST, GL_CULL_FACE, GL_BLEND, GL_TEXTURE_CUBE_MAP_SEAMLESS
+	GLuint capabilityValues[4];
+
+	bool change(StateCall kind, GLuint& current, GLuint value);
+	void setCapability(GLenum capability, bool enabled);
+};
+
+#endif //_GL_STATE_CACHE_H
@@ -0,0 +1,184 @@
+/*
+Title: Reflection and refraction
+File Name: GpuCulling.cpp
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+GPU driven culling and multi-draw indirect submission, see GpuCulling.h.
+*/
+
+#include "GpuCulling.h"
+#include <iterator>
+
+void GpuCulling::init(stuff_for_drawing& mesh, const SphereInstance* instanceData, int numInstances, float meshRadius, GLuint cullProgram)
+{
+	program = cullProgram;
+	instanceCount = numInstances;
+	boundingRadius = meshRadius;
+	indexType = mesh.indexType;
+	instances.assign(instanceData, instanceData + numInstances);
+	lods.assign(mesh.lods.begin(), mesh.lods.begin() + std::min((int)mesh.lods.size(), GPU_CULLING_MAX_LODS));
+	visibleBuffer = mesh.instanceVbo;
+
+	uniPlanes = glGetUniformLocation(program, "planes");
+	uniPV = glGetUniformLocation(program, "PV");
+	uniInstanceCount = glGetUniformLocation(program, "instanceCount");
+	uniViewportHeight = glGetUniformLocation(program, "viewportHeight");
+	uniMaxPixelError = glGetUniformLocation(program, "maxPixelError");
+	uniLodErrors = glGetUniformLocation(program, "lodErrors");
+	uniLodCount = glGetUniformLocation(program, "lodCount");
+	uniBoundingRadius = glGetUniformLocation(program, "boundingRadius");
+
+	//// The instances only go one way, to the compute shader.
+	glGenBuffers(1, &instanceBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, instanceBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(SphereInstance) * numInstances, instanceData, GL_STATIC_DRAW);
+
+	//// The commands and the count are written by the compute shader and read by the draw, without ever coming back to the CPU.
+	glGenBuffers(1, &commandBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(DrawElementsIndirectCommand) * lods.size(), NULL, GL_DYNAMIC_DRAW);
+
+	glGenBuffers(1, &drawCountBuffer);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawCountBuffer);
+	glBufferData(GL_SHADER_STORAGE_BUFFER, sizeof(GLuint), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GpuCulling::cull(const glm::mat4& PV, float viewportHeight, float maxPixelError)
+{
+	// Start every level with no instances. baseInstance is where the level's part of the visible instance buffer starts.
+	std::vector<DrawElementsIndirectCommand> commands(lods.size());
+	float errors[GPU_CULLING_MAX_LODS];
+	for (size_t i = 0; i < lods.size(); i++)
+	{
+		commands[i].count = lods[i].indexCount;
+		commands[i].instanceCount = 0;
+		commands[i].firstIndex = lods[i].firstIndex;
+		commands[i].baseVertex = lods[i].baseVertex;
+		commands[i].baseInstance = (GLuint)(i * instanceCount);
+		errors[i] = lods[i].error;
+	}
+	GLuint zero = 0;
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(DrawElementsIndirectCommand) * commands.size(), &commands[0]);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, drawCountBuffer);
+	glBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(GLuint), &zero);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	glm::vec4 planes[6];
+	frustumPlanes(PV, planes);
+
+	glUseProgram(program);
+	glUniform4fv(uniPlanes, 6, glm::value_ptr(planes[0]));
+	glUniformMatrix4fv(uniPV, 1, GL_FALSE, glm::value_ptr(PV));
+	glUniform1ui(uniInstanceCount, instanceCount);
+	glUniform1f(uniViewportHeight, viewportHeight);
+	glUniform1f(uniMaxPixelError, maxPixelError);
+	glUniform1fv(uniLodErrors, (GLsizei)lods.size(), errors);
+	glUniform1i(uniLodCount, (GLint)lods.size());
+	glUniform1f(uniBoundingRadius, boundingRadius);
+
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 0, instanceBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 1, visibleBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 2, commandBuffer);
+	glBindBufferBase(GL_SHADER_STORAGE_BUFFER, 3, drawCountBuffer);
+
+	// 64 instances per work group, see local_size_x in the shader.
+	glDispatchCompute((instanceCount + 63) / 64, 1, 1);
+
+	//// The draw reads the commands as indirect parameters and the visible instances as vertex attributes, both written by the shader above.
+	glMemoryBarrier(GL_COMMAND_BARRIER_BIT | GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_SHADER_STORAGE_BARRIER_BIT);
+}
+
+void GpuCulling::record(CommandList& commands) const
+{
+	commands.drawIndexedIndirect(GL_TRIANGLES, indexType, commandBuffer, drawCountBuffer, (int)lods.size());
+}
+
+void GpuCulling::readCommands(std::vector<DrawElementsIndirectCommand>& commands)
+{
+	commands.resize(lods.size());
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, commandBuffer);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(DrawElementsIndirectCommand) * commands.size(), &commands[0]);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+}
+
+void GpuCulling::cullOnCPU(const glm::mat4& PV, float viewportHeight, float maxPixelError, std::vector<int>& visible)
+{
+	glm::vec4 planes[6];
+	frustumPlanes(PV, planes);
+
+	visible.assign(instanceCount, -1);
+	for (int i = 0; i < instanceCount; i++)
+	{
+		glm::vec3 center(instances[i].model[3]);
+		float radius = glm::length(glm::vec3(instances[i].model[0])) * boundingRadius;
+
+		bool inside = true;
+		for (int p = 0; p < 6; p++)
+			inside = inside && glm::dot(glm::vec3(planes[p]), center) + planes[p].w >= -radius;
+		if (inside)
+			visible[i] = selectLOD(lods, projectedRadius(PV, center, radius, viewportHeight), 0, maxPixelError, 1.0f);
+	}
+}
+
+int GpuCulling::validate(const glm::mat4& PV, float viewportHeight, float maxPixelError)
+{
+	std::vector<int> expected;
+	cullOnCPU(PV, viewportHeight, maxPixelError, expected);
+
+	cull(PV, viewportHeight, maxPixelError);
+	std::vector<DrawElementsIndirectCommand> commands;
+	readCommands(commands);
+
+	// The order inside a level depends on which invocation got to the counter first, so the instances are matched by their model matrix.
+	std::vector<SphereInstance> visible(lods.size() * instanceCount);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, visibleBuffer);
+	glGetBufferSubData(GL_SHADER_STORAGE_BUFFER, 0, sizeof(SphereInstance) * visible.size(), &visible[0]);
+	glBindBuffer(GL_SHADER_STORAGE_BUFFER, 0);
+
+	int differences = 0;
+	for (size_t level = 0; level < lods.size(); level++)
+	{
+		std::vector<glm::vec3> cpuCenters, gpuCenters;
+		for (int i = 0; i < instanceCount; i++)
+			if (expected[i] == (int)level)
+				cpuCenters.push_back(glm::vec3(instances[i].model[3]));
+		for (GLuint i = 0; i < std::min(commands[level].instanceCount, (GLuint)instanceCount); i++)
+			gpuCenters.push_back(glm::vec3(visible[level * instanceCount + i].model[3]));
+
+		struct { bool operator()(const glm::vec3& a, const glm::vec3& b) const { return a.x != b.x ? a.x < b.x : a.y != b.y ? a.y < b.y : a.z < b.z; } } less;
+		std::sort(cpuCenters.begin(), cpuCenters.end(), less);
+		std::sort(gpuCenters.begin(), gpuCenters.end(), less);
+		std::vector<glm::vec3> onlyOne;
+		std::set_symmetric_difference(cpuCenters.begin(), cpuCenters.end(), gpuCenters.begin(), gpuCenters.end(), std::back_inserter(onlyOne), less);
+		differences += (int)onlyOne.size();
+	}
+	return differences;
+}
+
+void GpuCulling::release()
+{
+	glDeleteBuffers(1, &instanceBuffer);
+	glDeleteBuffers(1, &commandBuffer);
+	glDeleteBuffers(1, &drawCountBuffer);
+}
@@ -0,0 +1,110 @@
+/*
+Title: Reflection and refraction
+File Name: GpuCulling.h
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+GPU driven culling and submission for the instances of one mesh.
+
+Every frame a compute shader (ComputeShaderCulling.glsl) runs once per
+instance. It tests the bounding sphere of the instance against the six
+planes of the view frustum, picks its level of detail from its size on
+screen (like selectLOD in Mesh.h, without the hysteresis, since nothing
+is kept from frame to frame), and appends the instance to the part of
+the visible instance buffer which belongs to that level. The instance
+count of that level's DrawElementsIndirectCommand is the append counter.
+
+The commands are then drawn with one glMultiDrawElementsIndirect (or
+glMultiDrawElementsIndirectCountARB, where the compute shader also
+writes the number of levels used), so the CPU does the same work for
+ten instances as for fifty thousand. The visible instance buffer is the
+instance buffer of the mesh's VAO, and every command's baseInstance
+points to its level's part of it, so the instanced vertex shader does
+not change.
+*/
+
+#ifndef _GPU_CULLING_H
+#define _GPU_CULLING_H
+
+#include "Mesh.h"
+#include "Culling.h"
+#include "CommandList.h"
+
+// The layout glMultiDrawElementsIndirect reads.
+struct DrawElementsIndirectCommand
+{
+	GLuint count;
+	GLuint instanceCount;
+	GLuint firstIndex;
+	GLint baseVertex;
+	GLuint baseInstance;
+};
+
+// At most this many levels of detail; the compute shader has an array of their errors.
+#define GPU_CULLING_MAX_LODS 8
+
+struct GpuCulling
+{
+	GLuint program;				// ComputeShaderCulling.glsl, made by the caller
+	GLuint instanceBuffer;		// All the instances (binding 0)
+	GLuint visibleBuffer;		// The mesh's instance buffer: lodCount parts of instanceCount instances (binding 1)
+	GLuint commandBuffer;		// One DrawElementsIndirectCommand per level (binding 2)
+	GLuint drawCountBuffer;		// Number of commands to draw (binding 3)
+	GLenum indexType;
+
+	int instanceCount;
+	float boundingRadius;		// Radius of the mesh's bounding sphere before the model matrix scales it
+	std::vector<SphereInstance> instances;
+	std::vector<MeshLOD> lods;
+
+	GLint uniPlanes;
+	GLint uniPV;
+	GLint uniInstanceCount;
+	GLint uniViewportHeight;
+	GLint uniMaxPixelError;
+	GLint uniLodErrors;
+	GLint uniLodCount;
+	GLint uniBoundingRadius;
+
+	// Creates the buffers. mesh must have an instance buffer of numInstances * lods.size() instances, which becomes the visible instance buffer.
+	void init(stuff_for_drawing& mesh, const SphereInstance* instanceData, int numInstances, float meshRadius, GLuint cullProgram);
+
+	// Runs the compute shader. The commands are ready for the draw record() puts in a command list afterwards.
+	void cull(const glm::mat4& PV, float viewportHeight, float maxPixelError);
+
+	// Records the draw of what cull() leaves in the command buffer into a command list, to be replayed after cull() with the mesh's
+	// VAO bound.
+	void record(CommandList& commands) const;
+
+	// Reads back the commands written by the last cull().
+	void readCommands(std::vector<DrawElementsIndirectCommand>& commands);
+
+	// The same culling on the CPU, one instance after the other. visible[i] is the level of instance i, or -1 if it is culled.
+	void cullOnCPU(const glm::mat4& PV, float viewportHeight, float maxPixelError, std::vector<int>& visible);
+
+	// Runs cull() and compares its result with cullOnCPU(): the instance count of every level, and which instances went into it.
+	// Returns the number of instances that differ (0 if the GPU agrees with the CPU).
+	int validate(const glm::mat4& PV, float viewportHeight, float maxPixelError);
+
+	void release();
+};
+
+#endif //_GPU_CULLING_H
@@ -0,0 +1,273 @@
+/*
+Title: Reflection and refraction
+File Name: JobSystem.cpp
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Description:
+Worker threads, deques and dependencies of the job system, see JobSystem.h.
+*/
+
+#include "JobSystem.h"
+
+// The index of the worker running on this thread. The thread which calls start() is worker 0.
+#ifdef _MSC_VER
+static __declspec(thread) int workerIndex = 0;
+#else
+static __thread int workerIndex = 0;
+#endif
+
+JobSystem::JobSystem()
+{
+	running = false;
+	queued = 0;
+	// Worker 0 is the calling thread, so jobs can be created and run before start().
+	start(1);
+}
+
+JobSystem::~JobSystem()
+{
+	stop();
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		delete[] workers[i]->pool;
+		delete workers[i];
+	}
+}
+
+void JobSystem::start(int threadCount)
+{
+	stop();
+	threadCount = std::max(1, threadCount);
+	while ((int)workers.size() < threadCount)
+	{
+		Worker* worker = new Worker();
+		worker->pool = new Job[JOB_POOL_SIZE];
+		for (int j = 0; j < JOB_POOL_SIZE; j++)
+		{
+			worker->pool[j].unfinished = 0;
+			worker->pool[j].waitingFor = 0;
+			worker->pool[j].finished = true;
+			worker->pool[j].released = true;
+		}
+		worker->allocated = 0;
+		worker->executed = 0;
+		worker->stolen = 0;
+		workers.push_back(worker);
+	}
+
+	running = true;
+	for (int i = 1; i < threadCount; i++)
+		threads.push_back(std::thread(&JobSystem::workerLoop, this, i));
+}
+
+void JobSystem::stop()
+{
+	{
+		std::lock_guard<std::mutex> guard(sleepLock);
+		running = false;
+	}
+	wakeUp.notify_all();
+	for (size_t i = 0; i < threads.size(); i++)
+		threads[i].join();
+	threads.clear();
+}
+
+JobSystem::Worker& JobSystem::current()
+{
+	return *workers[workerIndex];
+}
+
+Job* JobSystem::create(std::function<void()> work, Job* parent)
+{
+	Worker& worker = current();
+	// The next job of the ring which is done with. A job which lives long, like a parent or one waiting for a dependency,
+	// keeps its slot and the ring goes around it.
+	Job* job = NULL;
+	while (!job)
+	{
+		for (int tries = 0; tries < JOB_POOL_SIZE && !job; tries++)
+		{
+			Job* slot = &worker.pool[worker.allocated++ % JOB_POOL_SIZE];
+			if (slot->released)
+				job = slot;
+		}
+		// Every job of the ring is still live: run one, as wait() does, and look again.
+		if (!job && !runOne())
+			std::this_thread::yield();
+	}
+	job->released = false;
+	job->work = work;
+	job->parent = parent;
+	job->unfinished = 1;
+	job->waitingFor = 1;
+	job->finished = false;
+	job->continuationCount = 0;
+	if (parent)
+		parent->unfinished++;
+	return job;
+}
+
+void JobSystem::addDependency(Job* job, Job* dependency)
+{
+	std::unique_lock<std::mutex> guard(dependency->lock);
+	if (dependency->finished)
+		return;
+	if (dependency->continuationCount == JOB_MAX_CONTINUATIONS)
+	{
+		// No room left: wait for the dependency here instead.
+		guard.unlock();
+		wait(dependency);
+		return;
+	}
+	job->waitingFor++;
+	dependency->continuations[dependency->continuationCount++] = job;
+}
+
+void JobSystem::run(Job* job)
+{
+	if (--job->waitingFor == 0)
+		push(job);
+}
+
+void JobSystem::wait(Job* job)
+{
+	while (!isFinished(job))
+	{
+		if (!runOne())
+			std::this_thread::yield();
+	}
+}
+
+bool JobSystem::runOne()
+{
+	Job* job = next();
+	if (!job)
+		return false;
+	execute(job);
+	return true;
+}
+
+void JobSystem::push(Job* job)
+{
+	Worker& worker = current();
+	{
+		std::lock_guard<std::mutex> guard(worker.lock);
+		worker.jobs.push_back(job);
+	}
+	queued++;
+	if (threads.size() > 0)
+		wakeUp.notify_one();
+}
+
+Job* JobSystem::next()
+{
+	// The newest job of this thread first.
+	Worker& own = current();
+	{
+		std::lock_guard<std::mutex> guard(own.lock);
+		if (!own.jobs.empty())
+		{
+			Job* job = own.jobs.back();
+			own.jobs.pop_back();
+			queued--;
+			return job;
+		}
+	}
+
+	// Then the oldest job of another thread, starting with the next one so the thieves spread out.
+	int count = (int)workers.size();
+	for (int i = 1; i < count; i++)
+	{
+		Worker& victim = *workers[(workerIndex + i) % count];
+		std::lock_guard<std::mutex> guard(victim.lock);
+		if (!victim.jobs.empty())
+		{
+			Job* job = victim.jobs.front();
+			victim.jobs.pop_front();
+			queued--;
+			own.stolen++;
+			return job;
+		}
+	}
+	return NULL;
+}
+
+void JobSystem::execute(Job* job)
+{
+	if (job->work)
+		job->work();
+	current().executed++;
+	finish(job);
+}
+
+void JobSystem::finish(Job* job)
+{
+	if (--job->unfinished > 0)
+		return;
+
+	// Nothing can be added to the continuations once finished is set, so they can be run outside the lock. They are copied
+	// first, because create() may reuse the job as soon as it is released.
+	Job* parent = job->parent;
+	Job* continuations[JOB_MAX_CONTINUATIONS];
+	int continuationCount;
+	{
+		std::lock_guard<std::mutex> guard(job->lock);
+		job->finished = true;
+		continuationCount = job->continuationCount;
+		for (int i = 0; i < continuationCount; i++)
+			continuations[i] = job->continuations[i];
+	}
+	job->released = true;
+
+	for (int i = 0; i < continuationCount; i++)
+		run(continuations[i]);
+
+	if (parent)
+		finish(parent);
+}
+
+void JobSystem::workerLoop(int index)
+{
+	workerIndex = index;
+	while (running)
+	{
+		Job* job = next();
+		if (job)
+		{
+			execute(job);
+			continue;
+		}
+
+		// Nothing to do: sleep until a job is pushed. The timeout covers a push which happens between next() and the wait.
+		std::unique_lock<std::mutex> guard(sleepLock);
+		wakeUp.wait_for(guard, std::chrono::milliseconds(1), [this]() { return queued > 0 || !running; });
+	}
+}
+
+void JobSystem::printCounters()
+{
+	std::cout << "\n Jobs run (stolen) per thread:";
+	for (size_t i = 0; i < workers.size(); i++)
+	{
+		std::cout << " " << workers[i]->executed.exchange(0) << " (" << workers[i]->stolen.exchange(0) << ")";
+	}
+}
@@ -0,0 +1,162 @@
+/*
+Title: Reflection and refraction
+File Name: JobSystem.h
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Description:
+A fixed set of worker threads which run jobs, small pieces of work given
+as functions, with work stealing.
+
+Every thread, the calling thread included, has its own deque of jobs.
+A thread pushes the jobs it creates onto the back of its own deque and
+takes its next job from the back too, so it keeps working on what it
+just split up while the data is still in its cache. A thread with an
+empty deque steals from the front of the others, where the older and
+usually bigger jobs are. The deques are short and each one has its own
+lock, which the owner and the occasional thief rarely fight over.
+
+Jobs can be children of another job: the parent only counts as finished
+when its own function and all its children have finished. parallelFor()
+uses that to split a range into jobs, and addDependency() makes a job
+wait for another one to finish before it starts, which is how the steps
+of a frame are chained (update, cull, record, sort).
+
+wait() does not block: the waiting thread runs jobs until the one it
+waits for is finished, so waiting on the main thread does not cost a
+core. Without start(), there are no workers and wait() runs everything
+on the calling thread.
+
+The jobs come from a ring of JOB_POOL_SIZE jobs per thread, which is
+reused without being freed. create() skips the jobs of the ring which
+are still live, and when all of them are, it runs jobs until one of
+them is done. So a thread can have at most JOB_POOL_SIZE jobs created and
+not finished at a time, and must not create more than that many before
+it calls run() on them, or create() waits for a job which never starts.
+*/
+
+#ifndef _JOB_SYSTEM_H
+#define _JOB_SYSTEM_H
+
+#include "GLIncludes.h"
+#include <functional>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <deque>
+
+// Jobs per thread which can be live at a time, see above.
+#define JOB_POOL_SIZE 4096
+#define JOB_MAX_CONTINUATIONS 16
+
+struct Job
+{
+	std::function<void()> work;
+	Job* parent;
+	std::atomic<int> unfinished;		// 1 for the job itself, plus its children which have not finished
+	std::atomic<int> waitingFor;		// Dependencies which have not finished, plus 1 until run() is called
+	std::mutex lock;					// Guards finished and the continuations
+	bool finished;
+	std::atomic<bool> released;			// Set once finish() no longer touches the job, so create() can reuse it
+	Job* continuations[JOB_MAX_CONTINUATIONS];	// Jobs waiting for this one
+	int continuationCount;
+};
+
+struct JobSystem
+{
+	JobSystem();
+	~JobSystem();
+
+	// Starts threadCount - 1 worker threads; the calling thread is the last one. Call it once, before any job is created.
+	void start(int threadCount);
+	void stop();
+	int threadCount() const { return (int)workers.size(); }
+
+	// A job which runs work. With a parent, the parent does not finish before it. The job runs once run() has been called
+	// and its dependencies have finished.
+	Job* create(std::function<void()> work, Job* parent = NULL);
+
+	// job will not start before dependency has finished. Call it before run(job); dependency may already be running or finished.
+	void addDependency(Job* job, Job* dependency);
+
+	void run(Job* job);
+
+	// Runs jobs on this thread until job and its children have finished.
+	void wait(Job* job);
+	bool isFinished(Job* job) const { return job->unfinished.load() == 0; }
+
+	// Runs one waiting job on this thread, if there is one. For threads which wait for something else than a job (see CubeMapLoader.h).
+	bool runOne();
+
+	// A job which calls work(first, last) for consecutive parts of [0, count) of at most grain items, each part as a child job,
+	// so the parts run on all the threads. Like create(), it only starts with run().
+	template <typename Work>
+	Job* parallelFor(int count, int grain, Work work);
+
+	// Prints the jobs every thread ran and stole since the last call.
+	void printCounters();
+
+private:
+	struct Worker
+	{
+		std::mutex lock;
+		std::deque<Job*> jobs;
+		Job* pool;
+		unsigned int allocated;
+		std::atomic<int> executed;
+		std::atomic<int> stolen;
+	};
+	std::vector<Worker*> workers;
+	std::vector<std::thread> threads;
+	std::atomic<bool> running;
+
+	// Idle workers sleep here until a job is pushed.
+	std::mutex sleepLock;
+	std::condition_variable wakeUp;
+	std::atomic<int> queued;
+
+	Worker& current();
+	void push(Job* job);
+	Job* next();
+	void execute(Job* job);
+	void finish(Job* job);
+	void workerLoop(int index);
+};
+
+template <typename Work>
+Job* JobSystem::parallelFor(int count, int grain, Work work)
+{
+	Job* parent = create(std::function<void()>());
+	grain = std::max(1, grain);
+	// The parts are only created when the parent runs, so they wait for the dependencies of the parent too.
+	parent->work = [this, parent, count, grain, work]()
+	{
+		for (int first = 0; first < count; first += grain)
+		{
+			int last = std::min(count, first + grain);
+			run(create([work, first, last]() { work(first, last); }, parent));
+		}
+	};
+	return parent;
+}
+
+#endif //_JOB_SYSTEM_H
@@ -0,0 +1,136 @@
+/*
+Title: Reflection and refraction
+File Name: LockFreeQueue.h
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Description:
+A bounded queue which any number of threads can push to and pop from at
+the same time without locks (the array based queue of Dmitry Vyukov).
+
+Every cell of the ring has a sequence number which says whose turn it is:
+when it equals the position a producer wants to write, the cell is free
+for that producer; when it is one more, the cell holds a value for the
+consumer at that position. A thread claims a position by moving the head
+or tail on with a compare and swap, and hands the cell on by storing the
+next sequence number with release order, which publishes the value it
+wrote together with it. A full queue makes push() fail instead of
+waiting, an empty one makes pop() fail.
+*/
+
+#ifndef _LOCK_FREE_QUEUE_H
+#define _LOCK_FREE_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+
+template <typename T>
+struct LockFreeQueue
+{
+	// capacity is rounded up to a power of two.
+	explicit LockFreeQueue(size_t capacity)
+	{
+		size_t size = 2;
+		while (size < capacity)
+			size *= 2;
+		mask = size - 1;
+		cells = new Cell[size];
+		for (size_t i = 0; i < size; i++)
+			cells[i].sequence.store(i, std::memory_order_relaxed);
+		head.store(0, std::memory_order_relaxed);
+		tail.store(0, std::memory_order_relaxed);
+	}
+
+	~LockFreeQueue() { delete[] cells; }
+
+	// Returns false if the queue is full.
+	bool push(const T& value)
+	{
+		size_t position = tail.load(std::memory_order_relaxed);
+		Cell* cell;
+		for (;;)
+		{
+			cell = &cells[position & mask];
+			size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			ptrdiff_t difference = (ptrdiff_t)sequence - (ptrdiff_t)position;
+			if (difference == 0)
+			{
+				if (tail.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (difference < 0)
+				return false;
+			else
+				position = tail.load(std::memory_order_relaxed);
+		}
+		cell->value = value;
+		cell->sequence.store(position + 1, std::memory_order_release);
+		return true;
+	}
+
+	// Returns false if the queue is empty.
+	bool pop(T& value)
+	{
+		size_t position = head.load(std::memory_order_relaxed);
+		Cell* cell;
+		for (;;)
+		{
+			cell = &cells[position & mask];
+			size_t sequence = cell->sequence.load(std::memory_order_acquire);
+			ptrdiff_t difference = (ptrdiff_t)sequence - (ptrdiff_t)(position + 1);
+			if (difference == 0)
+			{
+				if (head.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+					break;
+			}
+			else if (difference < 0)
+				return false;
+			else
+				position = head.load(std::memory_order_relaxed);
+		}
+		value = cell->value;
+		// The cell is free again for the producer one lap later.
+		cell->sequence.store(position + mask + 1, std::memory_order_release);
+		return true;
+	}
+
+private:
+	struct Cell
+	{
+		std::atomic<size_t> sequence;
+		T value;
+	};
+
+	Cell* cells;
+	size_t mask;
+	// On different cache lines, so the producers and the consumers do not slow each other down.
+	char padding0[64];
+	std::atomic<size_t> tail;
+	char padding1[64];
+	std::atomic<size_t> head;
+	char padding2[64];
+
+	// Not copyable.
+	LockFreeQueue(const LockFreeQueue&);
+	LockFreeQueue& operator=(const LockFreeQueue&);
+};
+
+#endif //_LOCK_FREE_QUEUE_H
@@ -0,0 +1,427 @@
+/*
+Title: Reflection and refraction
+File Name: Mesh.cpp
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+Uploads meshes to the GPU. See Mesh.h.
+*/
+
+#include "Mesh.h"
+#include "glm\gtc\packing.hpp"
+#include <cmath>
+#include <cstddef>
+
+VertexLayout makeVertexLayout(PositionEncoding positionEncoding, NormalEncoding normalEncoding)
+{
+	VertexLayout layout;
+	layout.positionEncoding = positionEncoding;
+	layout.normalEncoding = normalEncoding;
+	layout.posScale = glm::vec3(1.0f);
+	layout.posOffset = glm::vec3(0.0f);
+	layout.normalScale = 1.0f;
+
+	if (positionEncoding == POSITION_FLOAT && normalEncoding == NORMAL_FLOAT)
+	{
+		// Exactly VertexFormat.
+		layout.positionOffset = 0;
+		layout.normalOffset = 3 * sizeof(float);
+		layout.stride = sizeof(VertexFormat);
+		return layout;
+	}
+
+	// The normal goes first and takes a multiple of 4 bytes (the two bytes of NORMAL_OCT8 are padded), so both attributes start on
+	// a 4 byte boundary, which vertex fetch needs to read them at full speed.
+	GLuint normalBytes = (normalEncoding == NORMAL_FLOAT) ? 12 : 4;
+	GLuint positionBytes = (positionEncoding == POSITION_FLOAT) ? 12 : 6;
+	layout.normalOffset = 0;
+	layout.positionOffset = normalBytes;
+	layout.stride = (normalBytes + positionBytes + 3) & ~3;
+	return layout;
+}
+
+static GLshort toSnorm16(float value)
+{
+	return (GLshort)floorf(glm::clamp(value, -1.0f, 1.0f) * 32767.0f + 0.5f);
+}
+
+static GLbyte toSnorm8(float value)
+{
+	return (GLbyte)floorf(glm::clamp(value, -1.0f, 1.0f) * 127.0f + 0.5f);
+}
+
+// Octahedral encoding: the unit sphere is projected onto the octahedron |x| + |y| + |z| = 1, and the lower half is folded
+// over the upper half, which turns any direction into a point of the [-1, 1] square.
+static glm::vec2 octEncode(glm::vec3 n)
+{
+	n /= (fabsf(n.x) + fabsf(n.y) + fabsf(n.z));
+	if (n.z >= 0.0f)
+		return glm::vec2(n.x, n.y);
+	return glm::vec2((1.0f - fabsf(n.y)) * (n.x >= 0.0f ? 1.0f : -1.0f), (1.0f - fabsf(n.x)) * (n.y >= 0.0f ? 1.0f : -1.0f));
+}
+
+void encodeVertices(const VertexFormat* vertices, int count, VertexLayout& layout, std::vector<unsigned char>& data)
+{
+	data.resize((size_t)count * layout.stride);
+	if (count == 0)
+		return;
+
+	if (layout.positionEncoding == POSITION_FLOAT && layout.normalEncoding == NORMAL_FLOAT)
+	{
+		memcpy(data.data(), vertices, data.size());
+		return;
+	}
+
+	// The bounding box, and the average length of the normals.
+	glm::vec3 lower = vertices[0].position, upper = vertices[0].position;
+	float normalLength = 0.0f;
+	for (int i = 0; i < count; i++)
+	{
+		lower = glm::min(lower, vertices[i].position);
+		upper = glm::max(upper, vertices[i].position);
+		normalLength += glm::length(vertices[i].normal);
+	}
+
+	if (layout.positionEncoding != POSITION_FLOAT)
+	{
+		layout.posOffset = (upper + lower) * 0.5f;
+		layout.posScale = (upper - lower) * 0.5f;
+		// A flat mesh has no extent along one axis; any scale will do there.
+		for (int k = 0; k < 3; k++)
+			if (layout.posScale[k] <= 0.0f)
+				layout.posScale[k] = 1.0f;
+	}
+	if (layout.normalEncoding != NORMAL_FLOAT)
+		layout.normalScale = normalLength / count;
+
+	for (int i = 0; i < count; i++)
+	{
+		unsigned char* vertex = &data[(size_t)i * layout.stride];
+		glm::vec3 position = (vertices[i].position - layout.posOffset) / layout.posScale;
+		glm::vec3 normal = vertices[i].normal;
+		float length = glm::length(normal);
+		glm::vec3 unitNormal = length > 0.0f ? normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+
+		if (layout.positionEncoding == POSITION_FLOAT)
+		{
+			memcpy(vertex + layout.positionOffset, &position, sizeof(position));
+		}
+		else
+		{
+			GLushort* out = (GLushort*)(vertex + layout.positionOffset);
+			for (int k = 0; k < 3; k++)
+				out[k] = (layout.positionEncoding == POSITION_SNORM16) ? (GLushort)toSnorm16(position[k]) : glm::packHalf1x16(position[k]);
+		}
+
+		switch (layout.normalEncoding)
+		{
+		case NORMAL_FLOAT:
+			memcpy(vertex + layout.normalOffset, &normal, sizeof(normal));
+			break;
+		case NORMAL_OCT16:
+		{
+			glm::vec2 oct = octEncode(unitNormal);
+			GLshort* out = (GLshort*)(vertex + layout.normalOffset);
+			out[0] = toSnorm16(oct.x);
+			out[1] = toSnorm16(oct.y);
+			break;
+		}
+		case NORMAL_OCT8:
+		{
+			glm::vec2 oct = octEncode(unitNormal);
+			GLbyte* out = (GLbyte*)(vertex + layout.normalOffset);
+			out[0] = toSnorm8(oct.x);
+			out[1] = toSnorm8(oct.y);
+			break;
+		}
+		case NORMAL_INT_2_10_10_10:
+		{
+			// x in bits 0-9, y in bits 10-19, z in bits 20-29, each a signed 10 bit integer. The 2 bits of w are unused.
+			GLuint packed = 0;
+			for (int k = 0; k < 3; k++)
+				packed |= ((GLuint)(int)floorf(glm::clamp(unitNormal[k], -1.0f, 1.0f) * 511.0f + 0.5f) & 0x3FF) << (10 * k);
+			memcpy(vertex + layout.normalOffset, &packed, sizeof(packed));
+			break;
+		}
+		}
+	}
+}
+
+//This function gets the number of vertices and all the vertex values and stores them in the buffer.
+void stuff_for_drawing::initBuffer(int numVertices, VertexFormat* vertices, GLuint programID)
+{
+	initBuffer(numVertices, vertices, makeVertexLayout(POSITION_FLOAT, NORMAL_FLOAT), programID);
+}
+
+//Same as above, for vertices which are already in the format of vertexLayout.
+void stuff_for_drawing::initBuffer(int numVertices, const void* vertexData, const VertexLayout& vertexLayout, GLuint programID)
+{
+	numberOfVertices = numVertices;
+	layout = vertexLayout;
+
+	glGenVertexArrays(1, &vao);
+	// This generates buffer object names
+	// The first parameter is the number of buffer objects, and the second parameter is a pointer to an array of buffer objects (yes, before this call, vbo was an empty variable)
+	glGenBuffers(1, &vbo);
+
+	glBindVertexArray(vao);
+	//// Binds a named buffer object to the specified buffer binding point. Give it a target (GL_ARRAY_BUFFER) to determine where to bind the buffer.
+	//// There are several different target parameters, GL_ARRAY_BUFFER is for vertex attributes, feel free to Google the others to find out what else there is.
+	//// The second paramter is the buffer object reference. If no buffer object with the given name exists, it will create one.
+	//// Buffer object names are unsigned integers (like vbo). Zero is a reserved value, and there is no default buffer for each target (targets, like GL_ARRAY_BUFFER).
+	//// Passing in zero as the buffer name (second parameter) will result in unbinding any buffer bound to that target, and frees up the memory.
+	glBindBuffer(GL_ARRAY_BUFFER, vbo);
+
+	//// Creates and initializes a buffer object's data.
+	//// First parameter is the target, second parameter is the size of the buffer, third parameter is a pointer to the data that will copied into the buffer, and fourth parameter is the 
+	//// expected usage pattern of the data. Possible usage patterns: GL_STREAM_DRAW, GL_STREAM_READ, GL_STREAM_COPY, GL_STATIC_DRAW, GL_STATIC_READ, GL_STATIC_COPY, GL_DYNAMIC_DRAW, 
+	//// GL_DYNAMIC_READ, or GL_DYNAMIC_COPY
+	//// Stream means that the data will be modified once, and used only a few times at most. Static means that the data will be modified once, and used a lot. Dynamic means that the data 
+	//// will be modified repeatedly, and used a lot. Draw means that the data is modified by the application, and used as a source for GL drawing. Read means the data is modified by 
+	//// reading data from GL, and used to return that data when queried by the application. Copy means that the data is modified by reading from the GL, and used as a source for drawing.
+	glBufferData(GL_ARRAY_BUFFER, layout.stride * numVertices, vertexData, GL_STATIC_DRAW);
+
+	//// By default, all client-side capabilities are disabled, including all generic vertex attribute arrays.
+	//// When enabled, the values in a generic vertex attribute array will be accessed and used for rendering when calls are made to vertex array commands (like glDrawArrays/glDrawElements)
+	//// A GL_INVALID_VALUE will be generated if the index parameter is greater than or equal to GL_MAX_VERTEX_ATTRIBS
+	glEnableVertexAttribArray(glGetAttribLocation(programID, "in_position"));
+
+	//// Defines an array of generic vertex attribute data. Takes an index, a size specifying the number of components (in this case, floats)(has a max of 4)
+	//// The third parameter, type, can be GL_BYTE, GL_UNSIGNED_BYTE, GL_SHORT, GL_UNSIGNED_SHORT, GL_FIXED, or GL_FLOAT
+	//// The fourth parameter specifies whether to normalize fixed-point data values, the fifth parameter is the stride which is the offset (in bytes) between generic vertex attributes
+	//// The fifth parameter is a pointer to the first component of the first generic vertex attribute in the array. If a named buffer object is bound to GL_ARRAY_BUFFER (and it is, in this case) 
+	//// then the pointer parameter is treated as a byte offset into the buffer object's data.
+	//// For the compact layouts, GL_TRUE for normalized turns the shorts (or bytes) into floats in the [-1, 1] range as they are read.
+	if (layout.positionEncoding == POSITION_FLOAT)
+		glVertexAttribPointer(glGetAttribLocation(programID, "in_position"), 3, GL_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)layout.positionOffset);
+	else if (layout.positionEncoding == POSITION_SNORM16)
+		glVertexAttribPointer(glGetAttribLocation(programID, "in_position"), 3, GL_SHORT, GL_TRUE, layout.stride, (void*)(size_t)layout.positionOffset);
+	else
+		glVertexAttribPointer(glGetAttribLocation(programID, "in_position"), 3, GL_HALF_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)layout.positionOffset);
+	//// You'll note sizeof(VertexFormat) is our stride, because each vertex contains data that adds up to that size.
+	//// You'll also notice we offset this parameter by 16 bytes, this is because the vec3 position attribute is after the vec4 color attribute. A vec4 has 4 floats, each being 4 bytes 
+	//// so we offset by 4*4=16 to make sure that our first attribute is actually the position. The reason we put position after color in the struct has to do with padding.
+	//// For more info on padding, Google it.
+
+	glEnableVertexAttribArray(glGetAttribLocation(programID, "in_normal"));
+	//// The octahedral normals only have two components; the shader gets 0 for z and decodes them from x and y.
+	if (layout.normalEncoding == NORMAL_FLOAT)
+		glVertexAttribPointer(glGetAttribLocation(programID, "in_normal"), 3, GL_FLOAT, GL_FALSE, layout.stride, (void*)(size_t)layout.normalOffset);
+	else if (layout.normalEncoding == NORMAL_OCT16)
+		glVertexAttribPointer(glGetAttribLocation(programID, "in_normal"), 2, GL_SHORT, GL_TRUE, layout.stride, (void*)(size_t)layout.normalOffset);
+	else if (layout.normalEncoding == NORMAL_OCT8)
+		glVertexAttribPointer(glGetAttribLocation(programID, "in_normal"), 2, GL_BYTE, GL_TRUE, layout.stride, (void*)(size_t)layout.normalOffset);
+	else
+		glVertexAttribPointer(glGetAttribLocation(programID, "in_normal"), 4, GL_INT_2_10_10_10_REV, GL_TRUE, layout.stride, (void*)(size_t)layout.normalOffset);
+
+	//glBindBuffer(GL_ARRAY_BUFFER, 0);
+	glBindVertexArray(0);
+
+	// No element buffer, so this mesh is drawn with glDrawArrays.
+	ebo = 0;
+	numberOfIndices = 0;
+}
+
+//Indexed version of the above. Vertices shared between triangles are stored once, and the vertex shader results are kept in the post-transform cache,
+//so a vertex that is referenced again shortly after is not run through the vertex shader a second time.
+void stuff_for_drawing::initBuffer(int numVertices, VertexFormat* vertices, int numIndices, GLuint* indices, GLuint programID)
+{
+	initBuffer(numVertices, vertices, programID);
+
+	std::vector<unsigned char> indexData;
+	GLenum type = packIndices(indices, numIndices, numVertices, indexData);
+	initIndexBuffer(numIndices, indexData.data(), type);
+
+	// The whole mesh is a single level of detail.
+	MeshLOD lod;
+	lod.baseVertex = 0;
+	lod.firstIndex = 0;
+	lod.indexCount = numIndices;
+	lod.error = 0.0f;
+	lods.push_back(lod);
+}
+
+//Uploads an indexed mesh built on the CPU, with its vertices converted to the given encodings.
+void stuff_for_drawing::initBuffer(const MeshData& mesh, GLuint programID, PositionEncoding positions, NormalEncoding normals)
+{
+	std::vector<MeshData> levels(1, mesh);
+	std::vector<float> errors(1, 0.0f);
+	initBuffer(levels, errors, programID, positions, normals);
+}
+
+//Uploads every level of detail into one vertex buffer and one index buffer.
+void stuff_for_drawing::initBuffer(const std::vector<MeshData>& levels, const std::vector<float>& errors, GLuint programID,
+	PositionEncoding positions, NormalEncoding normals)
+{
+	PackedMesh packed;
+	packMesh(levels, errors, positions, normals, packed);
+	initBuffer(packed.view(), programID);
+}
+
+//Uploads a mesh which is already in its final format. Nothing is converted, the blobs go straight to glBufferData.
+void stuff_for_drawing::initBuffer(const MeshView& mesh, GLuint programID)
+{
+	initBuffer(mesh.vertexCount, mesh.vertexData, mesh.layout, programID);
+	initIndexBuffer(mesh.indexCount, mesh.indexData, mesh.indexType);
+	lods.assign(mesh.lods, mesh.lods + mesh.lodCount);
+}
+
+//Creates the element buffer and attaches it to the VAO.
+void stuff_for_drawing::initIndexBuffer(int numIndices, const void* indices, GLenum type)
+{
+	numberOfIndices = numIndices;
+	indexType = type;
+
+	glGenBuffers(1, &ebo);
+
+	//// The element array buffer binding is part of the VAO state, so binding it while the VAO is bound is enough for glDrawElements to find the indices later.
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, ebo);
+	glBufferData(GL_ELEMENT_ARRAY_BUFFER, (type == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint)) * numIndices, indices, GL_STATIC_DRAW);
+	glBindVertexArray(0);
+}
+
+//Copies the indices into data, as 16 bit integers if every one of them fits. indexRange is the number of vertices the indices can refer to.
+GLenum packIndices(const GLuint* indices, int numIndices, int indexRange, std::vector<unsigned char>& data)
+{
+	//// If every index fits in 16 bits, we only need half the memory (and half the bandwidth) for the index buffer.
+	if (indexRange <= 65536)
+	{
+		data.resize(sizeof(GLushort) * numIndices);
+		GLushort* shortIndices = (GLushort*)data.data();
+		for (int i = 0; i < numIndices; i++)
+			shortIndices[i] = (GLushort)indices[i];
+		return GL_UNSIGNED_SHORT;
+	}
+
+	data.resize(sizeof(GLuint) * numIndices);
+	memcpy(data.data(), indices, data.size());
+	return GL_UNSIGNED_INT;
+}
+
+MeshView PackedMesh::view() const
+{
+	MeshView mesh;
+	mesh.layout = layout;
+	mesh.vertexCount = (int)(vertexData.size() / layout.stride);
+	mesh.vertexData = vertexData.data();
+	mesh.indexType = indexType;
+	mesh.indexCount = (int)(indexData.size() / (indexType == GL_UNSIGNED_SHORT ? sizeof(GLushort) : sizeof(GLuint)));
+	mesh.indexData = indexData.data();
+	mesh.lodCount = (int)lods.size();
+	mesh.lods = lods.data();
+	mesh.boundsMin = boundsMin;
+	mesh.boundsMax = boundsMax;
+	return mesh;
+}
+
+//Puts every level of detail into one vertex blob and one index blob, in the format they are uploaded in.
+void packMesh(const std::vector<MeshData>& levels, const std::vector<float>& errors, PositionEncoding positions, NormalEncoding normals, PackedMesh& packed)
+{
+	std::vector<VertexFormat> allVertices;
+	std::vector<GLuint> allIndices;
+	size_t largestLevel = 0;
+
+	packed.lods.clear();
+	for (size_t i = 0; i < levels.size(); i++)
+	{
+		// The indices of each level stay relative to its own first vertex; glDrawElementsBaseVertex adds baseVertex when drawing.
+		MeshLOD lod;
+		lod.baseVertex = (GLint)allVertices.size();
+		lod.firstIndex = (GLuint)allIndices.size();
+		lod.indexCount = (GLsizei)levels[i].indices.size();
+		lod.error = errors[i];
+		packed.lods.push_back(lod);
+
+		allVertices.insert(allVertices.end(), levels[i].vertices.begin(), levels[i].vertices.end());
+		allIndices.insert(allIndices.end(), levels[i].indices.begin(), levels[i].indices.end());
+		largestLevel = std::max(largestLevel, levels[i].vertices.size());
+	}
+
+	packed.boundsMin = packed.boundsMax = allVertices.empty() ? glm::vec3(0.0f) : allVertices[0].position;
+	for (size_t i = 0; i < allVertices.size(); i++)
+	{
+		packed.boundsMin = glm::min(packed.boundsMin, allVertices[i].position);
+		packed.boundsMax = glm::max(packed.boundsMax, allVertices[i].position);
+	}
+
+	packed.layout = makeVertexLayout(positions, normals);
+	encodeVertices(allVertices.data(), (int)allVertices.size(), packed.layout, packed.vertexData);
+	packed.indexType = packIndices(allIndices.data(), (int)allIndices.size(), (int)largestLevel, packed.indexData);
+}
+
+//Stores one SphereInstance per copy of the mesh, and attaches it to the VAO with a divisor of 1 so every instance reads its own.
+void stuff_for_drawing::initInstanceBuffer(int numInstances, const SphereInstance* instances, GLuint programID)
+{
+	glGenBuffers(1, &instanceVbo);
+	glBindVertexArray(vao);
+	glBindBuffer(GL_ARRAY_BUFFER, instanceVbo);
+	glBufferData(GL_ARRAY_BUFFER, sizeof(SphereInstance) * numInstances, instances, GL_STATIC_DRAW);
+
+	//// A mat4 attribute takes four locations, one per column.
+	GLint modelLocation = glGetAttribLocation(programID, "in_model");
+	for (int column = 0; column < 4; column++)
+	{
+		glEnableVertexAttribArray(modelLocation + column);
+		glVertexAttribPointer(modelLocation + column, 4, GL_FLOAT, GL_FALSE, sizeof(SphereInstance), (void*)(column * sizeof(glm::vec4)));
+		//// With a divisor of 1 the attribute moves to the next element once per instance instead of once per vertex.
+		glVertexAttribDivisor(modelLocation + column, 1);
+	}
+
+	GLint materialLocation = glGetAttribLocation(programID, "in_material");
+	glEnableVertexAttribArray(materialLocation);
+	glVertexAttribPointer(materialLocation, 4, GL_FLOAT, GL_FALSE, sizeof(SphereInstance), (void*)offsetof(SphereInstance, material));
+	glVertexAttribDivisor(materialLocation, 1);
+
+	glBindVertexArray(0);
+}
+
+//Radius of a sphere on screen, in pixels. The view matrix has no scaling, so the length of the second row of PV is the
+//vertical scale of the projection, and the fourth row gives the distance of the center along the view direction (w).
+float projectedRadius(const glm::mat4& PV, const glm::vec3& center, float radius, float viewportHeight)
+{
+	float projectionScale = glm::length(glm::vec3(PV[0][1], PV[1][1], PV[2][1]));
+	float w = PV[0][3] * center.x + PV[1][3] * center.y + PV[2][3] * center.z + PV[3][3];
+
+	// Too close (or behind the camera) to tell; use the finest level.
+	if (w <= radius)
+		return viewportHeight;
+
+	return radius * projectionScale / w * (viewportHeight * 0.5f);
+}
+
+//Picks the coarsest level whose error on screen stays below maxPixelError.
+//Moving to a coarser level needs the error to be below hysteresis * maxPixelError, so a sphere sitting right on a threshold does not
+//flicker between two levels every frame.
+int selectLOD(const std::vector<MeshLOD>& lods, float radiusInPixels, int currentLOD, float maxPixelError, float hysteresis)
+{
+	int level = (int)lods.size() - 1;
+	for (int i = 0; i < (int)lods.size(); i++)
+	{
+		float threshold = (i < currentLOD) ? maxPixelError * hysteresis : maxPixelError;
+		if (lods[i].error * radiusInPixels <= threshold)
+		{
+			level = i;
+			break;
+		}
+	}
+	return level;
+}
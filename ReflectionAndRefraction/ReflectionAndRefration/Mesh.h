@@ -0,0 +1,204 @@
+/*
+Title: Reflection and refraction
+File Name: Mesh.h
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+MeshData holds a mesh on the CPU side: a list of unique vertices and the
+index list which builds triangles out of them. stuff_for_drawing holds the
+same mesh once it has been uploaded to the GPU (VAO, vertex buffer and
+element buffer).
+
+The vertex buffer does not have to hold VertexFormat as it is (two vec3,
+24 bytes per vertex). A VertexLayout can store positions as 16 bit
+integers or half floats relative to the bounding box of the mesh, and
+normals as octahedral encoded 16 or 8 bit pairs or as one packed
+2_10_10_10 integer. With the default encodings that is 12 bytes per
+vertex, with both attributes on a 4 byte boundary. VertexShader.glsl
+decodes them again with the posScale, posOffset, normalEncoding and
+normalScale uniforms.
+*/
+
+#ifndef _MESH_H
+#define _MESH_H
+
+#include "GLIncludes.h"
+
+// One level of detail inside the shared vertex and index buffers of a stuff_for_drawing.
+struct MeshLOD
+{
+	GLint baseVertex;		// Added to every index of this level, so the indices stay relative to the level's first vertex.
+	GLuint firstIndex;		// Where this level starts in the index buffer.
+	GLsizei indexCount;
+	float error;			// Largest distance between this level and the true surface, as a fraction of the radius.
+};
+
+// How positions are stored in the vertex buffer.
+enum PositionEncoding
+{
+	POSITION_FLOAT,				// 3 floats, 12 bytes
+	POSITION_SNORM16,			// 3 normalized shorts relative to the bounding box, 6 bytes
+	POSITION_HALF				// 3 half floats relative to the bounding box, 6 bytes
+};
+
+// How normals are stored in the vertex buffer.
+enum NormalEncoding
+{
+	NORMAL_FLOAT,				// 3 floats, 12 bytes
+	NORMAL_OCT16,				// octahedral encoding in 2 normalized shorts, 4 bytes
+	NORMAL_OCT8,				// octahedral encoding in 2 normalized bytes, 2 bytes padded to 4
+	NORMAL_INT_2_10_10_10		// x, y and z in 10 bits each (GL_INT_2_10_10_10_REV), 4 bytes
+};
+
+// Where the position and normal are in a vertex, and how the vertex shader turns them back into VertexFormat values.
+struct VertexLayout
+{
+	PositionEncoding positionEncoding;
+	NormalEncoding normalEncoding;
+	GLsizei stride;				// Bytes per vertex
+	GLuint positionOffset;		// Byte offsets inside a vertex
+	GLuint normalOffset;
+
+	// position = in_position * posScale + posOffset. For the compact encodings this is the half size and the center of the bounding box.
+	glm::vec3 posScale;
+	glm::vec3 posOffset;
+
+	// Compact normals are stored as unit vectors; the shader scales them back to this length.
+	// The sphere normals are equal to the positions, so their length is the radius and the reflections depend on it.
+	float normalScale;
+};
+
+// Fills in the offsets and the stride for the given encodings. The bounds are filled in by encodeVertices.
+VertexLayout makeVertexLayout(PositionEncoding positionEncoding, NormalEncoding normalEncoding);
+
+// Converts vertices into the format of the layout, and stores the bounding box and normal length in it.
+void encodeVertices(const VertexFormat* vertices, int count, VertexLayout& layout, std::vector<unsigned char>& data);
+
+// A mesh in CPU memory. Every three indices make a triangle.
+struct MeshData
+{
+	std::vector<VertexFormat> vertices;
+	std::vector<GLuint> indices;
+};
+
+// A mesh ready for upload: vertices already in their layout, indices already 16 or 32 bit, and the levels of detail.
+// The pointers point into a PackedMesh, or straight into a memory mapped cache file (see MeshCache.h).
+struct MeshView
+{
+	VertexLayout layout;
+	int vertexCount;
+	const void* vertexData;
+	int indexCount;
+	GLenum indexType;			// GL_UNSIGNED_SHORT or GL_UNSIGNED_INT
+	const void* indexData;
+	int lodCount;
+	const MeshLOD* lods;
+	glm::vec3 boundsMin;		// Bounding box of the decoded positions
+	glm::vec3 boundsMax;
+};
+
+// Owns the blobs a MeshView points to.
+struct PackedMesh
+{
+	VertexLayout layout;
+	GLenum indexType;
+	std::vector<unsigned char> vertexData;
+	std::vector<unsigned char> indexData;
+	std::vector<MeshLOD> lods;
+	glm::vec3 boundsMin;
+	glm::vec3 boundsMax;
+
+	MeshView view() const;
+};
+
+// Concatenates the levels of detail (coarsest first), encodes the vertices and packs the indices. errors[i] goes into lods[i].error.
+void packMesh(const std::vector<MeshData>& levels, const std::vector<float>& errors, PositionEncoding positions, NormalEncoding normals, PackedMesh& packed);
+
+// Copies the indices into data, as 16 bit integers if indexRange (the number of vertices they can refer to) allows it. Returns the index type.
+GLenum packIndices(const GLuint* indices, int numIndices, int indexRange, std::vector<unsigned char>& data);
+
+// Per instance data for drawing many copies of a mesh in one draw call. The vertex shader reads it as instanced attributes
+// (in_model and in_material in VertexShaderInstanced.glsl).
+struct SphereInstance
+{
+	glm::mat4 model;			// Object to world transformation
+	glm::vec4 material;			// x: ratio of the indices of refraction, y: reflection weight, z: refraction weight, w: lighting weight
+};
+
+struct stuff_for_drawing{
+
+	GLuint vao;
+
+	//This stores the address the buffer/memory in the GPU. It acts as a handle to access the buffer memory in GPU.
+	GLuint vbo;
+
+	//This stores the handle to the element (index) buffer. It is 0 for meshes which are not indexed.
+	GLuint ebo;
+
+	//This will be used to tell the GPU, how many vertices will be needed to draw during drawcall.
+	int numberOfVertices;
+
+	//For indexed meshes, this is the number of indices to draw and their type (GL_UNSIGNED_SHORT or GL_UNSIGNED_INT).
+	int numberOfIndices;
+	GLenum indexType;
+
+	//How the vertices are stored in the vertex buffer.
+	VertexLayout layout;
+
+	//This function gets the number of vertices and all the vertex values and stores them in the buffer.
+	void initBuffer(int numVertices, VertexFormat* vertices, GLuint programID);
+
+	//Same as above, for vertices which are already in the format of vertexLayout.
+	void initBuffer(int numVertices, const void* vertexData, const VertexLayout& vertexLayout, GLuint programID);
+
+	//This function does the same as above, but also stores an index list in an element buffer so that vertices shared between triangles are only stored (and shaded) once.
+	void initBuffer(int numVertices, VertexFormat* vertices, int numIndices, GLuint* indices, GLuint programID);
+
+	//Uploads an indexed mesh built on the CPU, with its vertices converted to the given encodings.
+	void initBuffer(const MeshData& mesh, GLuint programID, PositionEncoding positions = POSITION_FLOAT, NormalEncoding normals = NORMAL_FLOAT);
+
+	//Uploads a chain of levels of detail, coarsest first, into a single vertex buffer and index buffer. errors[i] goes into lods[i].error.
+	void initBuffer(const std::vector<MeshData>& levels, const std::vector<float>& errors, GLuint programID,
+		PositionEncoding positions = POSITION_FLOAT, NormalEncoding normals = NORMAL_FLOAT);
+
+	//Uploads a mesh which is already packed. The vertex and index blobs are passed to glBufferData as they are.
+	void initBuffer(const MeshView& mesh, GLuint programID);
+
+	//The levels of detail stored in the buffers. An indexed mesh uploaded without levels has a single one.
+	std::vector<MeshLOD> lods;
+
+	//The per instance buffer, attached to the same VAO. 0 if the mesh has no instances.
+	GLuint instanceVbo;
+
+	//Stores one SphereInstance per copy of the mesh, and attaches it to the VAO with a divisor of 1 so every instance reads its own.
+	void initInstanceBuffer(int numInstances, const SphereInstance* instances, GLuint programID);
+
+private:
+	void initIndexBuffer(int numIndices, const void* indices, GLenum type);
+};
+
+// Radius of a sphere on screen, in pixels.
+float projectedRadius(const glm::mat4& PV, const glm::vec3& center, float radius, float viewportHeight);
+
+// Picks the coarsest level whose error on screen stays below maxPixelError, with hysteresis against popping.
+int selectLOD(const std::vector<MeshLOD>& lods, float radiusInPixels, int currentLOD, float maxPixelError, float hysteresis);
+
+#endif //_MESH_H
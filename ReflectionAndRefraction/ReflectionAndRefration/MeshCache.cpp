@@ -0,0 +1,295 @@
+/*
+Title: Reflection and refraction
+File Name: MeshCache.cpp
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+The binary mesh cache, see MeshCache.h.
+*/
+
+#include "MeshCache.h"
+#include <cstdio>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+MappedFile::MappedFile()
+{
+	data = NULL;
+	size = 0;
+#ifdef _WIN32
+	file = INVALID_HANDLE_VALUE;
+	mapping = NULL;
+#else
+	file = -1;
+#endif
+}
+
+MappedFile::~MappedFile()
+{
+	close();
+}
+
+bool MappedFile::open(const std::string& path)
+{
+	close();
+#ifdef _WIN32
+	file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+	if (file == INVALID_HANDLE_VALUE)
+		return false;
+
+	LARGE_INTEGER fileSize;
+	if (!GetFileSizeEx(file, &fileSize) || fileSize.QuadPart == 0)
+	{
+		close();
+		return false;
+	}
+	size = (size_t)fileSize.QuadPart;
+
+	mapping = CreateFileMappingA(file, NULL, PAGE_READONLY, 0, 0, NULL);
+	if (mapping == NULL)
+	{
+		close();
+		return false;
+	}
+	data = (const unsigned char*)MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0);
+#else
+	file = ::open(path.c_str(), O_RDONLY);
+	if (file < 0)
+		return false;
+
+	struct stat info;
+	if (fstat(file, &info) != 0 || info.st_size == 0)
+	{
+		close();
+		return false;
+	}
+	size = (size_t)info.st_size;
+
+	void* address = mmap(NULL, size, PROT_READ, MAP_PRIVATE, file, 0);
+	data = (address == MAP_FAILED) ? NULL : (const unsigned char*)address;
+#endif
+	if (data == NULL)
+	{
+		close();
+		return false;
+	}
+	return true;
+}
+
+void MappedFile::close()
+{
+#ifdef _WIN32
+	if (data != NULL)
+		UnmapViewOfFile(data);
+	if (mapping != NULL)
+		CloseHandle(mapping);
+	if (file != INVALID_HANDLE_VALUE)
+		CloseHandle(file);
+	mapping = NULL;
+	file = INVALID_HANDLE_VALUE;
+#else
+	if (data != NULL)
+		munmap((void*)data, size);
+	if (file >= 0)
+		::close(file);
+	file = -1;
+#endif
+	data = NULL;
+	size = 0;
+}
+
+std::string meshCachePath(const std::string& name)
+{
+	return std::string(MESH_CACHE_DIRECTORY) + "/" + name + ".mesh";
+}
+
+static unsigned long long alignTo16(unsigned long long offset)
+{
+	return (offset + 15) & ~15ULL;
+}
+
+static size_t indexSize(GLenum indexType)
+{
+	return (indexType == GL_UNSIGNED_SHORT) ? sizeof(GLushort) : sizeof(GLuint);
+}
+
+// The layout has to be the one makeVertexLayout makes for its encodings, and every level of detail has to stay inside the
+// vertex and index blobs, down to each of its indices plus its base vertex, or a stale or corrupt file would have the GPU read
+// past the end of the buffers. Scanning the indices costs far less than generating the mesh again.
+static bool validContents(const MeshCacheHeader* header, const MeshLOD* lods, const unsigned char* indexData)
+{
+	if (header->positionEncoding < POSITION_FLOAT || header->positionEncoding > POSITION_HALF
+		|| header->normalEncoding < NORMAL_FLOAT || header->normalEncoding > NORMAL_INT_2_10_10_10)
+		return false;
+	VertexLayout layout = makeVertexLayout((PositionEncoding)header->positionEncoding, (NormalEncoding)header->normalEncoding);
+	if (header->stride != layout.stride || header->positionOffset != layout.positionOffset || header->normalOffset != layout.normalOffset)
+		return false;
+
+	for (int i = 0; i < header->lodCount; i++)
+	{
+		if (lods[i].baseVertex < 0 || lods[i].baseVertex >= header->vertexCount || lods[i].indexCount < 0
+			|| (unsigned long long)lods[i].firstIndex + (unsigned long long)lods[i].indexCount > (unsigned long long)header->indexCount)
+			return false;
+
+		unsigned int largest = 0;
+		for (GLsizei j = 0; j < lods[i].indexCount; j++)
+		{
+			GLuint index = lods[i].firstIndex + j;
+			if (header->indexType == GL_UNSIGNED_SHORT)
+				largest = std::max(largest, (unsigned int)((const GLushort*)indexData)[index]);
+			else
+				largest = std::max(largest, (unsigned int)((const GLuint*)indexData)[index]);
+		}
+		if (lods[i].indexCount > 0 && (long long)lods[i].baseVertex + largest >= header->vertexCount)
+			return false;
+	}
+	return true;
+}
+
+bool mapMeshCache(const std::string& name, MappedFile& file, MeshView& mesh)
+{
+	if (!file.open(meshCachePath(name)))
+		return false;
+
+	// Everything in the header is checked against the size of the file before any pointer is made from it. The offsets are
+	// checked on their own first, so adding the sizes of the blocks to them cannot wrap around.
+	const MeshCacheHeader* header = (const MeshCacheHeader*)file.data;
+	bool valid = file.size >= sizeof(MeshCacheHeader)
+		&& memcmp(header->magic, "RRMC", 4) == 0
+		&& header->version == MESH_CACHE_VERSION
+		&& header->headerSize == sizeof(MeshCacheHeader)
+		&& header->fileSize == file.size
+		&& header->vertexCount >= 0 && header->indexCount >= 0 && header->lodCount >= 0
+		&& (header->indexType == GL_UNSIGNED_SHORT || header->indexType == GL_UNSIGNED_INT)
+		&& header->stride > 0
+		&& header->lodOffset <= file.size && header->vertexOffset <= file.size && header->indexOffset <= file.size
+		&& header->indexOffset % indexSize(header->indexType) == 0
+		&& header->lodOffset + (unsigned long long)header->lodCount * sizeof(MeshLOD) <= file.size
+		&& header->vertexOffset + (unsigned long long)header->vertexCount * header->stride <= file.size
+		&& header->indexOffset + (unsigned long long)header->indexCount * indexSize(header->indexType) <= file.size
+		&& validContents(header, (const MeshLOD*)(file.data + header->lodOffset), file.data + header->indexOffset);
+	if (!valid)
+	{
+		file.close();
+		return false;
+	}
+
+	VertexLayout& layout = mesh.layout;
+	layout.positionEncoding = (PositionEncoding)header->positionEncoding;
+	layout.normalEncoding = (NormalEncoding)header->normalEncoding;
+	layout.stride = header->stride;
+	layout.positionOffset = header->positionOffset;
+	layout.normalOffset = header->normalOffset;
+	layout.posScale = glm::vec3(header->posScale[0], header->posScale[1], header->posScale[2]);
+	layout.posOffset = glm::vec3(header->posOffset[0], header->posOffset[1], header->posOffset[2]);
+	layout.normalScale = header->normalScale;
+
+	mesh.boundsMin = glm::vec3(header->boundsMin[0], header->boundsMin[1], header->boundsMin[2]);
+	mesh.boundsMax = glm::vec3(header->boundsMax[0], header->boundsMax[1], header->boundsMax[2]);
+	mesh.vertexCount = header->vertexCount;
+	mesh.vertexData = file.data + header->vertexOffset;
+	mesh.indexCount = header->indexCount;
+	mesh.indexType = header->indexType;
+	mesh.indexData = file.data + header->indexOffset;
+	mesh.lodCount = header->lodCount;
+	mesh.lods = (const MeshLOD*)(file.data + header->lodOffset);
+	return true;
+}
+
+bool writeMeshCache(const std::string& name, const MeshView& mesh)
+{
+#ifdef _WIN32
+	CreateDirectoryA(MESH_CACHE_DIRECTORY, NULL);
+#else
+	mkdir(MESH_CACHE_DIRECTORY, 0755);
+#endif
+
+	MeshCacheHeader header;
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, "RRMC", 4);
+	header.version = MESH_CACHE_VERSION;
+	header.headerSize = sizeof(MeshCacheHeader);
+
+	header.positionEncoding = mesh.layout.positionEncoding;
+	header.normalEncoding = mesh.layout.normalEncoding;
+	header.stride = mesh.layout.stride;
+	header.positionOffset = mesh.layout.positionOffset;
+	header.normalOffset = mesh.layout.normalOffset;
+	for (int k = 0; k < 3; k++)
+	{
+		header.posScale[k] = mesh.layout.posScale[k];
+		header.posOffset[k] = mesh.layout.posOffset[k];
+		header.boundsMin[k] = mesh.boundsMin[k];
+		header.boundsMax[k] = mesh.boundsMax[k];
+	}
+	header.normalScale = mesh.layout.normalScale;
+
+	header.vertexCount = mesh.vertexCount;
+	header.indexCount = mesh.indexCount;
+	header.indexType = mesh.indexType;
+	header.lodCount = mesh.lodCount;
+
+	unsigned long long lodBytes = (unsigned long long)mesh.lodCount * sizeof(MeshLOD);
+	unsigned long long vertexBytes = (unsigned long long)mesh.vertexCount * mesh.layout.stride;
+	unsigned long long indexBytes = (unsigned long long)mesh.indexCount * indexSize(mesh.indexType);
+	header.lodOffset = alignTo16(sizeof(MeshCacheHeader));
+	header.vertexOffset = alignTo16(header.lodOffset + lodBytes);
+	header.indexOffset = alignTo16(header.vertexOffset + vertexBytes);
+	header.fileSize = header.indexOffset + indexBytes;
+
+	std::string path = meshCachePath(name);
+	std::string temporaryPath = path + ".tmp";
+	FILE* out = fopen(temporaryPath.c_str(), "wb");
+	if (out == NULL)
+		return false;
+
+	// Each block is written at its offset, fseek past the end fills the padding.
+	bool written = fwrite(&header, sizeof(header), 1, out) == 1
+		&& fseek(out, (long)header.lodOffset, SEEK_SET) == 0 && fwrite(mesh.lods, 1, (size_t)lodBytes, out) == lodBytes
+		&& fseek(out, (long)header.vertexOffset, SEEK_SET) == 0 && fwrite(mesh.vertexData, 1, (size_t)vertexBytes, out) == vertexBytes
+		&& fseek(out, (long)header.indexOffset, SEEK_SET) == 0 && fwrite(mesh.indexData, 1, (size_t)indexBytes, out) == indexBytes;
+	written = (fclose(out) == 0) && written;
+
+	// rename does not replace an existing file on Windows, so an old (invalid) cache file is removed first.
+	remove(path.c_str());
+	if (!written || rename(temporaryPath.c_str(), path.c_str()) != 0)
+	{
+		remove(temporaryPath.c_str());
+		return false;
+	}
+	return true;
+}
+
+bool uploadCachedMesh(const std::string& name, stuff_for_drawing& drawable, GLuint programID)
+{
+	MappedFile file;
+	MeshView mesh;
+	if (!mapMeshCache(name, file, mesh))
+		return false;
+
+	// The blobs go from the mapped pages straight into the buffers.
+	drawable.initBuffer(mesh, programID);
+	return true;
+}
@@ -0,0 +1,122 @@
+/*
+Title: Reflection and refraction
+File Name: MeshCache.h
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+A binary cache for meshes which are expensive to build. The first run
+writes the packed mesh (see PackedMesh in Mesh.h) to a file in
+MESH_CACHE_DIRECTORY, named after the parameters it was generated from.
+Later runs map that file into memory and hand the vertex and index blobs
+to glBufferData as they are, so loading is just the copy into the
+buffer plus the page faults of reading the file.
+
+File layout, in the byte order of the machine which wrote it:
+	MeshCacheHeader
+	MeshLOD[lodCount]
+	vertex blob		(vertexCount * layout.stride bytes)
+	index blob		(indexCount 16 or 32 bit indices)
+Every block starts on a 16 byte boundary. A file whose magic, version or
+sizes do not match, whose vertex layout is not the one makeVertexLayout
+gives for its encodings, or which has a level of detail outside its
+vertex or index blob, is ignored and written again.
+*/
+
+#ifndef _MESH_CACHE_H
+#define _MESH_CACHE_H
+
+#include "Mesh.h"
+
+#define MESH_CACHE_DIRECTORY "MeshCache"
+
+// Increase this whenever the file layout, or the output of the generators and the optimizer, changes.
+#define MESH_CACHE_VERSION 2
+
+struct MeshCacheHeader
+{
+	char magic[4];				// "RRMC"
+	unsigned int version;		// MESH_CACHE_VERSION
+	unsigned int headerSize;	// sizeof(MeshCacheHeader)
+
+	// VertexLayout
+	int positionEncoding;
+	int normalEncoding;
+	int stride;
+	unsigned int positionOffset;
+	unsigned int normalOffset;
+	float posScale[3];
+	float posOffset[3];
+	float normalScale;
+
+	float boundsMin[3];
+	float boundsMax[3];
+
+	int vertexCount;
+	int indexCount;
+	unsigned int indexType;
+	int lodCount;
+
+	// Byte offsets of the blocks from the start of the file, and the size of the whole file.
+	unsigned long long lodOffset;
+	unsigned long long vertexOffset;
+	unsigned long long indexOffset;
+	unsigned long long fileSize;
+};
+
+// A read-only view of a whole file, mapped into memory (MapViewOfFile on Windows, mmap elsewhere).
+struct MappedFile
+{
+	const unsigned char* data;
+	size_t size;
+
+	MappedFile();
+	~MappedFile();
+
+	bool open(const std::string& path);
+	void close();
+
+private:
+#ifdef _WIN32
+	HANDLE file;
+	HANDLE mapping;
+#else
+	int file;
+#endif
+
+	// Not copyable, the destructor unmaps the file.
+	MappedFile(const MappedFile&);
+	MappedFile& operator=(const MappedFile&);
+};
+
+// Where the cache file for the given name is.
+std::string meshCachePath(const std::string& name);
+
+// Maps the cache file and points mesh into it. mesh is only valid while file stays open.
+// Returns false if there is no cache file, or if it is not a valid one for this version (see the checks above).
+bool mapMeshCache(const std::string& name, MappedFile& file, MeshView& mesh);
+
+// Writes the mesh to the cache. The file is written under a temporary name first, so a crash never leaves half a file behind.
+bool writeMeshCache(const std::string& name, const MeshView& mesh);
+
+// Uploads the cached mesh called name into drawable. Returns false (and leaves drawable alone) if it is not cached.
+bool uploadCachedMesh(const std::string& name, stuff_for_drawing& drawable, GLuint programID);
+
+#endif //_MESH_CACHE_H
@@ -0,0 +1,803 @@
+/*
+Title: Reflection and refraction
+File Name: MeshImporter.cpp
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+The OBJ and PLY readers, see MeshImporter.h.
+*/
+
+#include "MeshImporter.h"
+#include "MeshCache.h"
+#include <thread>
+#include <sstream>
+#include <climits>
+#include <unordered_map>
+
+// Runs work(begin, end) on threadCount threads, each with its own part of [0, count).
+template <typename Work>
+static void parallelFor(size_t count, int threadCount, Work work)
+{
+	if (threadCount <= 1 || count < (size_t)threadCount)
+	{
+		work((size_t)0, count);
+		return;
+	}
+
+	std::vector<std::thread> threads;
+	for (int t = 1; t < threadCount; t++)
+		threads.push_back(std::thread(work, count * t / threadCount, count * (t + 1) / threadCount));
+	// The calling thread takes the first part itself.
+	work((size_t)0, count / threadCount);
+	for (size_t t = 0; t < threads.size(); t++)
+		threads[t].join();
+}
+
+#pragma region Normals
+
+// Smooth normals: every vertex gets the sum of the normals of the triangles around it, weighted by their area
+// (the cross product of two edges is twice the area long). Every thread owns a range of vertices: it reads all the triangles,
+// and adds the normal of the ones with a corner in its range to those corners only. No vertex is written by two threads, no
+// memory is needed besides the vertices, and the sums are added up in the order of the triangles whatever the number of threads.
+static void generateNormals(MeshData& mesh, int threadCount)
+{
+	size_t triangleCount = mesh.indices.size() / 3;
+	parallelFor(mesh.vertices.size(), threadCount, [&](size_t begin, size_t end)
+	{
+		for (size_t v = begin; v < end; v++)
+			mesh.vertices[v].normal = glm::vec3(0.0f);
+
+		for (size_t i = 0; i < triangleCount; i++)
+		{
+			GLuint a = mesh.indices[i * 3], b = mesh.indices[i * 3 + 1], c = mesh.indices[i * 3 + 2];
+			bool ownsA = (a >= begin && a < end), ownsB = (b >= begin && b < end), ownsC = (c >= begin && c < end);
+			if (!ownsA && !ownsB && !ownsC)
+				continue;
+			glm::vec3 faceNormal = glm::cross(mesh.vertices[b].position - mesh.vertices[a].position, mesh.vertices[c].position - mesh.vertices[a].position);
+			if (ownsA)
+				mesh.vertices[a].normal += faceNormal;
+			if (ownsB)
+				mesh.vertices[b].normal += faceNormal;
+			if (ownsC)
+				mesh.vertices[c].normal += faceNormal;
+		}
+
+		for (size_t v = begin; v < end; v++)
+		{
+			float length = glm::length(mesh.vertices[v].normal);
+			mesh.vertices[v].normal = length > 0.0f ? mesh.vertices[v].normal / length : glm::vec3(0.0f, 0.0f, 1.0f);
+		}
+	});
+}
+
+#pragma endregion Normals
+
+#pragma region OBJ
+
+// Powers of ten for the number parser. Exponents outside the table are rare enough to fall back to pow.
+static double powerOfTen(int exponent)
+{
+	static const double table[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11,
+		1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+	if (exponent >= 0 && exponent <= 22)
+		return table[exponent];
+	if (exponent < 0 && exponent >= -22)
+		return 1.0 / table[-exponent];
+	return pow(10.0, exponent);
+}
+
+static const char* skipSpaces(const char* p, const char* end)
+{
+	while (p < end && (*p == ' ' || *p == '\t'))
+		p++;
+	return p;
+}
+
+// strtof is locale dependent and slow, this only reads what OBJ files contain: [-+]digits[.digits][e[-+]digits]
+static const char* parseFloat(const char* p, const char* end, float& value)
+{
+	p = skipSpaces(p, end);
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+		negative = (*p++ == '-');
+
+	// Up to 18 significant digits fit in a long long; later digits only move the decimal point.
+	long long mantissa = 0;
+	int digits = 0, exponent = 0;
+	for (; p < end && *p >= '0' && *p <= '9'; p++)
+	{
+		if (digits < 18)
+		{
+			mantissa = mantissa * 10 + (*p - '0');
+			digits += (mantissa != 0);
+		}
+		else
+			exponent++;
+	}
+	if (p < end && *p == '.')
+	{
+		for (p++; p < end && *p >= '0' && *p <= '9'; p++)
+		{
+			if (digits < 18)
+			{
+				mantissa = mantissa * 10 + (*p - '0');
+				digits += (mantissa != 0);
+				exponent--;
+			}
+		}
+	}
+	if (p < end && (*p == 'e' || *p == 'E'))
+	{
+		p++;
+		bool negativeExponent = false;
+		if (p < end && (*p == '-' || *p == '+'))
+			negativeExponent = (*p++ == '-');
+		int e = 0;
+		for (; p < end && *p >= '0' && *p <= '9'; p++)
+			e = std::min(e * 10 + (*p - '0'), 10000);
+		exponent += negativeExponent ? -e : e;
+	}
+
+	double result = (double)mantissa * powerOfTen(exponent);
+	value = (float)(negative ? -result : result);
+	return p;
+}
+
+static const char* parseInt(const char* p, const char* end, int& value, bool& found)
+{
+	bool negative = false;
+	if (p < end && (*p == '-' || *p == '+'))
+		negative = (*p++ == '-');
+	found = (p < end && *p >= '0' && *p <= '9');
+	long long result = 0;
+	for (; p < end && *p >= '0' && *p <= '9'; p++)
+		result = std::min(result * 10 + (*p - '0'), (long long)INT_MAX);
+	value = (int)(negative ? -result : result);
+	return p;
+}
+
+// An OBJ index which has not been resolved yet. Positive indices count from the start of the file and are stored 0 based.
+// Negative (relative) indices count back from the last position seen, which a chunk only knows relative to its own start.
+// They are stored as OBJ_RELATIVE + (positions seen in the chunk so far + index), which is below 0 and may point back past
+// the start of the chunk; the number of positions in the chunks before it is added when the chunks are joined.
+static const int OBJ_NO_INDEX = INT_MIN;
+static const int OBJ_RELATIVE = -(1 << 30);
+
+struct ObjChunk
+{
+	std::vector<glm::vec3> positions;
+	std::vector<glm::vec3> normals;
+	std::vector<int> corners;			// Position and normal index of every triangle corner, in pairs
+	size_t firstPosition;				// Number of positions and normals in the chunks before this one
+	size_t firstNormal;
+	bool valid;
+};
+
+static int objIndex(int index, size_t countSoFar)
+{
+	if (index > 0)
+		return index - 1;
+	long long inChunk = (long long)countSoFar + index;
+	if (index < 0 && inChunk > OBJ_RELATIVE && inChunk < -OBJ_RELATIVE)
+		return OBJ_RELATIVE + (int)inChunk;
+	return OBJ_NO_INDEX;
+}
+
+// The index in the whole file, or -1 for none.
+static long long resolveObjIndex(int index, size_t chunkStart)
+{
+	if (index == OBJ_NO_INDEX)
+		return -1;
+	if (index >= 0)
+		return index;
+	return (long long)chunkStart + (index - OBJ_RELATIVE);
+}
+
+static void parseObjChunk(const char* p, const char* end, ObjChunk& chunk)
+{
+	chunk.valid = true;
+	std::vector<int> face;
+
+	while (p < end)
+	{
+		const char* lineEnd = (const char*)memchr(p, '\n', end - p);
+		if (lineEnd == NULL)
+			lineEnd = end;
+
+		p = skipSpaces(p, lineEnd);
+		if (lineEnd - p > 2 && p[0] == 'v' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			glm::vec3 position;
+			const char* q = parseFloat(p + 2, lineEnd, position.x);
+			q = parseFloat(q, lineEnd, position.y);
+			parseFloat(q, lineEnd, position.z);
+			chunk.positions.push_back(position);
+		}
+		else if (lineEnd - p > 3 && p[0] == 'v' && p[1] == 'n' && (p[2] == ' ' || p[2] == '\t'))
+		{
+			glm::vec3 normal;
+			const char* q = parseFloat(p + 3, lineEnd, normal.x);
+			q = parseFloat(q, lineEnd, normal.y);
+			parseFloat(q, lineEnd, normal.z);
+			chunk.normals.push_back(normal);
+		}
+		else if (lineEnd - p > 2 && p[0] == 'f' && (p[1] == ' ' || p[1] == '\t'))
+		{
+			// Every corner is v, v/vt, v//vn or v/vt/vn. Texture coordinates are not used.
+			face.clear();
+			const char* q = skipSpaces(p + 2, lineEnd);
+			while (q < lineEnd && *q != '\r')
+			{
+				int position, texture, normal = 0;
+				bool found, foundNormal = false;
+				q = parseInt(q, lineEnd, position, found);
+				if (!found)
+				{
+					chunk.valid = false;
+					break;
+				}
+				if (q < lineEnd && *q == '/')
+				{
+					q = parseInt(q + 1, lineEnd, texture, found);
+					if (q < lineEnd && *q == '/')
+						q = parseInt(q + 1, lineEnd, normal, foundNormal);
+				}
+				face.push_back(objIndex(position, chunk.positions.size()));
+				face.push_back(foundNormal ? objIndex(normal, chunk.normals.size()) : OBJ_NO_INDEX);
+				q = skipSpaces(q, lineEnd);
+			}
+
+			// Triangle fan around the first corner.
+			for (size_t i = 4; i + 1 < face.size(); i += 2)
+			{
+				chunk.corners.push_back(face[0]);
+				chunk.corners.push_back(face[1]);
+				chunk.corners.push_back(face[i - 2]);
+				chunk.corners.push_back(face[i - 1]);
+				chunk.corners.push_back(face[i]);
+				chunk.corners.push_back(face[i + 1]);
+			}
+		}
+		p = lineEnd + 1;
+	}
+}
+
+static bool importObj(const MappedFile& file, MeshData& mesh, int threadCount, bool& generatedNormals)
+{
+	const char* begin = (const char*)file.data;
+	const char* end = begin + file.size;
+
+	// Cut the file into one chunk per thread, moving every cut forward to the start of the next line.
+	std::vector<const char*> cuts(threadCount + 1);
+	cuts[0] = begin;
+	cuts[threadCount] = end;
+	for (int t = 1; t < threadCount; t++)
+	{
+		const char* cut = std::max(cuts[t - 1], begin + file.size * t / threadCount);
+		while (cut > begin && cut < end && cut[-1] != '\n')
+			cut++;
+		cuts[t] = cut;
+	}
+
+	std::vector<ObjChunk> chunks(threadCount);
+	parallelFor((size_t)threadCount, threadCount, [&](size_t first, size_t last)
+	{
+		for (size_t t = first; t < last; t++)
+			parseObjChunk(cuts[t], cuts[t + 1], chunks[t]);
+	});
+
+	size_t positionCount = 0, normalCount = 0, cornerCount = 0;
+	for (int t = 0; t < threadCount; t++)
+	{
+		if (!chunks[t].valid)
+		{
+			std::cout << "\n Malformed face in OBJ file";
+			return false;
+		}
+		chunks[t].firstPosition = positionCount;
+		chunks[t].firstNormal = normalCount;
+		positionCount += chunks[t].positions.size();
+		normalCount += chunks[t].normals.size();
+		cornerCount += chunks[t].corners.size() / 2;
+	}
+
+	// Turn the indices into indices of the whole file, each thread fixing its own chunk.
+	// If any corner has no normal, the normals of the file are not used at all.
+	std::vector<char> chunkHasNormals(threadCount, 1), chunkValid(threadCount, 1);
+	parallelFor((size_t)threadCount, threadCount, [&](size_t first, size_t last)
+	{
+		for (size_t t = first; t < last; t++)
+		{
+			std::vector<int>& corners = chunks[t].corners;
+			for (size_t i = 0; i < corners.size(); i += 2)
+			{
+				long long position = resolveObjIndex(corners[i], chunks[t].firstPosition);
+				long long normal = resolveObjIndex(corners[i + 1], chunks[t].firstNormal);
+				if (position < 0 || position >= (long long)positionCount)
+				{
+					chunkValid[t] = 0;
+					position = 0;
+				}
+				if (normal < 0 || normal >= (long long)normalCount)
+				{
+					chunkHasNormals[t] = 0;
+					normal = 0;
+				}
+				corners[i] = (int)position;
+				corners[i + 1] = (int)normal;
+			}
+		}
+	});
+
+	bool useNormals = true;
+	for (int t = 0; t < threadCount; t++)
+	{
+		if (!chunkValid[t])
+		{
+			std::cout << "\n OBJ file refers to a vertex it does not have";
+			return false;
+		}
+		useNormals = useNormals && chunkHasNormals[t];
+	}
+
+	std::vector<glm::vec3> normals;
+	mesh.vertices.resize(positionCount);
+	mesh.indices.resize(cornerCount);
+	for (int t = 0; t < threadCount; t++)
+	{
+		for (size_t i = 0; i < chunks[t].positions.size(); i++)
+			mesh.vertices[chunks[t].firstPosition + i].position = chunks[t].positions[i];
+		if (useNormals)
+			normals.insert(normals.end(), chunks[t].normals.begin(), chunks[t].normals.end());
+	}
+
+	// One vertex per position, as long as the position is always used with the same normal. A position used with a second
+	// normal gets an extra vertex. This runs on one thread, but only looks up a hash map for those extra vertices.
+	std::vector<int> normalOfPosition(useNormals ? positionCount : 0, -1);
+	std::unordered_map<unsigned long long, GLuint> extraVertices;
+	size_t corner = 0;
+	for (int t = 0; t < threadCount; t++)
+	{
+		const std::vector<int>& corners = chunks[t].corners;
+		for (size_t i = 0; i < corners.size(); i += 2, corner++)
+		{
+			int position = corners[i];
+			if (!useNormals)
+			{
+				mesh.indices[corner] = position;
+				continue;
+			}
+
+			int normal = corners[i + 1];
+			if (normalOfPosition[position] < 0)
+			{
+				normalOfPosition[position] = normal;
+				mesh.vertices[position].normal = normals[normal];
+			}
+			if (normalOfPosition[position] == normal)
+			{
+				mesh.indices[corner] = position;
+				continue;
+			}
+
+			unsigned long long key = ((unsigned long long)position << 32) | (unsigned int)normal;
+			std::unordered_map<unsigned long long, GLuint>::iterator found = extraVertices.find(key);
+			if (found == extraVertices.end())
+			{
+				found = extraVertices.insert(std::make_pair(key, (GLuint)mesh.vertices.size())).first;
+				mesh.vertices.push_back(VertexFormat(mesh.vertices[position].position, normals[normal]));
+			}
+			mesh.indices[corner] = found->second;
+		}
+	}
+
+	generatedNormals = !useNormals;
+	if (generatedNormals)
+		generateNormals(mesh, threadCount);
+	return true;
+}
+
+#pragma endregion OBJ
+
+#pragma region PLY
+
+// A scalar property of a PLY element, or a list (count followed by that many items).
+struct PlyProperty
+{
+	std::string name;
+	int size;				// Bytes of the value, or of each item for a list
+	char type;				// 'i' signed integer, 'u' unsigned integer, 'f' floating point
+	bool isList;
+	int countSize;			// Bytes of the count of a list
+};
+
+struct PlyElement
+{
+	std::string name;
+	size_t count;
+	std::vector<PlyProperty> properties;
+};
+
+static bool plyType(const std::string& name, int& size, char& type)
+{
+	static const struct { const char* name; int size; char type; } types[] = {
+		{ "char", 1, 'i' }, { "int8", 1, 'i' }, { "uchar", 1, 'u' }, { "uint8", 1, 'u' },
+		{ "short", 2, 'i' }, { "int16", 2, 'i' }, { "ushort", 2, 'u' }, { "uint16", 2, 'u' },
+		{ "int", 4, 'i' }, { "int32", 4, 'i' }, { "uint", 4, 'u' }, { "uint32", 4, 'u' },
+		{ "float", 4, 'f' }, { "float32", 4, 'f' }, { "double", 8, 'f' }, { "float64", 8, 'f' } };
+	for (size_t i = 0; i < sizeof(types) / sizeof(types[0]); i++)
+	{
+		if (name == types[i].name)
+		{
+			size = types[i].size;
+			type = types[i].type;
+			return true;
+		}
+	}
+	return false;
+}
+
+// Reads one value of the given size and type, swapping the bytes if the file's byte order is not ours.
+static double readPlyValue(const unsigned char* p, int size, char type, bool swap)
+{
+	unsigned char bytes[8];
+	for (int i = 0; i < size; i++)
+		bytes[i] = swap ? p[size - 1 - i] : p[i];
+
+	switch (size)
+	{
+	case 1: return type == 'i' ? (double)*(signed char*)bytes : (double)bytes[0];
+	case 2: { unsigned short v; memcpy(&v, bytes, 2); return type == 'i' ? (double)(short)v : (double)v; }
+	case 4:
+	{
+		if (type == 'f') { float v; memcpy(&v, bytes, 4); return v; }
+		unsigned int v; memcpy(&v, bytes, 4); return type == 'i' ? (double)(int)v : (double)v;
+	}
+	default: { double v; memcpy(&v, bytes, 8); return v; }
+	}
+}
+
+static bool importPly(const MappedFile& file, MeshData& mesh, int threadCount, bool& generatedNormals)
+{
+	const char* text = (const char*)file.data;
+	const char* end = text + file.size;
+	const char* headerEnd = NULL;
+	for (const char* p = text; p + 10 <= end; p++)
+	{
+		if (memcmp(p, "end_header", 10) == 0)
+		{
+			headerEnd = (const char*)memchr(p, '\n', end - p);
+			break;
+		}
+	}
+	if (file.size < 4 || memcmp(text, "ply", 3) != 0 || headerEnd == NULL)
+	{
+		std::cout << "\n Not a PLY file";
+		return false;
+	}
+
+	// The header is short, so it is read with a string stream.
+	std::istringstream header(std::string(text, headerEnd));
+	std::vector<PlyElement> elements;
+	std::string line, format;
+	while (std::getline(header, line))
+	{
+		std::istringstream words(line);
+		std::string keyword;
+		words >> keyword;
+		if (keyword == "format")
+			words >> format;
+		else if (keyword == "element")
+		{
+			PlyElement element;
+			words >> element.name >> element.count;
+			elements.push_back(element);
+		}
+		else if (keyword == "property" && !elements.empty())
+		{
+			PlyProperty property;
+			std::string type;
+			words >> type;
+			property.isList = (type == "list");
+			property.countSize = 0;
+			if (property.isList)
+			{
+				char countType;
+				std::string itemType;
+				words >> type >> itemType;
+				if (!plyType(type, property.countSize, countType))
+				{
+					std::cout << "\n Unknown PLY list count type " << type;
+					return false;
+				}
+				type = itemType;
+			}
+			words >> property.name;
+			if (!plyType(type, property.size, property.type))
+			{
+				std::cout << "\n Unknown PLY property type " << type;
+				return false;
+			}
+			elements.back().properties.push_back(property);
+		}
+	}
+
+	bool swap;
+	unsigned int one = 1;
+	bool littleEndianMachine = (*(unsigned char*)&one == 1);
+	if (format == "binary_little_endian")
+		swap = !littleEndianMachine;
+	else if (format == "binary_big_endian")
+		swap = littleEndianMachine;
+	else
+	{
+		std::cout << "\n Only binary PLY files are supported, this one is " << format;
+		return false;
+	}
+
+	const unsigned char* p = (const unsigned char*)headerEnd + 1;
+	const unsigned char* dataEnd = file.data + file.size;
+	bool hasNormals = false, hasFaces = false;
+	for (size_t e = 0; e < elements.size(); e++)
+	{
+		PlyElement& element = elements[e];
+		size_t rowSize = 0;
+		bool fixedSize = true;
+		for (size_t i = 0; i < element.properties.size(); i++)
+		{
+			fixedSize = fixedSize && !element.properties[i].isList;
+			rowSize += element.properties[i].size;
+		}
+
+		if (element.name == "vertex")
+		{
+			if (!fixedSize || (size_t)(dataEnd - p) / std::max(rowSize, (size_t)1) < element.count)
+			{
+				std::cout << "\n PLY vertices are not readable";
+				return false;
+			}
+
+			// Where x, y, z and nx, ny, nz are in a row.
+			int offsets[6] = { -1, -1, -1, -1, -1, -1 };
+			const char* names[6] = { "x", "y", "z", "nx", "ny", "nz" };
+			int propertyOf[6] = { 0, 0, 0, 0, 0, 0 };
+			size_t offset = 0;
+			for (size_t i = 0; i < element.properties.size(); i++)
+			{
+				for (int k = 0; k < 6; k++)
+				{
+					if (element.properties[i].name == names[k])
+					{
+						offsets[k] = (int)offset;
+						propertyOf[k] = (int)i;
+					}
+				}
+				offset += element.properties[i].size;
+			}
+			if (offsets[0] < 0 || offsets[1] < 0 || offsets[2] < 0)
+			{
+				std::cout << "\n PLY vertices have no position";
+				return false;
+			}
+			hasNormals = (offsets[3] >= 0 && offsets[4] >= 0 && offsets[5] >= 0);
+
+			// Every row is the same size, so each thread can go straight to its first row.
+			mesh.vertices.resize(element.count);
+			const unsigned char* rows = p;
+			parallelFor(element.count, threadCount, [&](size_t begin, size_t end)
+			{
+				for (size_t v = begin; v < end; v++)
+				{
+					const unsigned char* row = rows + v * rowSize;
+					float values[6] = { 0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f };
+					for (int k = 0; k < (hasNormals ? 6 : 3); k++)
+					{
+						const PlyProperty& property = element.properties[propertyOf[k]];
+						values[k] = (float)readPlyValue(row + offsets[k], property.size, property.type, swap);
+					}
+					mesh.vertices[v] = VertexFormat(glm::vec3(values[0], values[1], values[2]), glm::vec3(values[3], values[4], values[5]));
+				}
+			});
+			p += element.count * rowSize;
+		}
+		else if (element.name == "face")
+		{
+			// Find the list of vertex indices, and the bytes of the other properties around it.
+			int list = -1;
+			size_t before = 0, after = 0;
+			for (size_t i = 0; i < element.properties.size(); i++)
+			{
+				const PlyProperty& property = element.properties[i];
+				if (property.isList && list < 0 && (property.name == "vertex_indices" || property.name == "vertex_index"))
+					list = (int)i;
+				else if (property.isList)
+				{
+					std::cout << "\n PLY faces with more than one list are not supported";
+					return false;
+				}
+				else
+					(list < 0 ? before : after) += property.size;
+			}
+			if (list < 0)
+			{
+				std::cout << "\n PLY faces have no vertex_indices";
+				return false;
+			}
+			const PlyProperty& indices = element.properties[list];
+
+			// If every face is a triangle, every row is the same size, and each thread can read its own rows.
+			size_t triangleRow = before + indices.countSize + 3 * indices.size + after;
+			bool allTriangles = (size_t)(dataEnd - p) / triangleRow >= element.count;
+			std::vector<char> threadOk(threadCount, 1);
+			if (allTriangles)
+			{
+				mesh.indices.resize(element.count * 3);
+				const unsigned char* rows = p;
+				parallelFor((size_t)threadCount, threadCount, [&](size_t first, size_t last)
+				{
+					for (size_t t = first; t < last; t++)
+					{
+						for (size_t f = element.count * t / threadCount; f < element.count * (t + 1) / threadCount; f++)
+						{
+							const unsigned char* row = rows + f * triangleRow + before;
+							if (readPlyValue(row, indices.countSize, 'u', swap) != 3.0)
+							{
+								threadOk[t] = 0;
+								break;
+							}
+							for (int k = 0; k < 3; k++)
+								mesh.indices[f * 3 + k] = (GLuint)readPlyValue(row + indices.countSize + k * indices.size, indices.size, indices.type, swap);
+						}
+					}
+				});
+				for (int t = 0; t < threadCount; t++)
+					allTriangles = allTriangles && threadOk[t];
+			}
+
+			if (allTriangles)
+				p += element.count * triangleRow;
+			else
+			{
+				// Polygons: read the rows one after the other and split them into triangle fans.
+				mesh.indices.clear();
+				for (size_t f = 0; f < element.count; f++)
+				{
+					if ((size_t)(dataEnd - p) < before + indices.countSize)
+					{
+						std::cout << "\n PLY file is truncated";
+						return false;
+					}
+					size_t count = (size_t)readPlyValue(p + before, indices.countSize, 'u', swap);
+					const unsigned char* items = p + before + indices.countSize;
+					if ((size_t)(dataEnd - items) < count * indices.size + after)
+					{
+						std::cout << "\n PLY file is truncated";
+						return false;
+					}
+					GLuint first = (count > 0) ? (GLuint)readPlyValue(items, indices.size, indices.type, swap) : 0;
+					for (size_t k = 2; k < count; k++)
+					{
+						mesh.indices.push_back(first);
+						mesh.indices.push_back((GLuint)readPlyValue(items + (k - 1) * indices.size, indices.size, indices.type, swap));
+						mesh.indices.push_back((GLuint)readPlyValue(items + k * indices.size, indices.size, indices.type, swap));
+					}
+					p = items + count * indices.size + after;
+				}
+			}
+			hasFaces = true;
+		}
+		else if (fixedSize && (size_t)(dataEnd - p) / std::max(rowSize, (size_t)1) >= element.count)
+			p += element.count * rowSize;
+		else
+			break;				// An element we cannot skip. Everything we need has to be before it.
+	}
+
+	if (!hasFaces)
+	{
+		std::cout << "\n PLY file has no faces";
+		return false;
+	}
+	for (size_t i = 0; i < mesh.indices.size(); i++)
+	{
+		if (mesh.indices[i] >= mesh.vertices.size())
+		{
+			std::cout << "\n PLY file refers to a vertex it does not have";
+			return false;
+		}
+	}
+
+	generatedNormals = !hasNormals;
+	if (generatedNormals)
+		generateNormals(mesh, threadCount);
+	return true;
+}
+
+#pragma endregion PLY
+
+bool importMesh(const std::string& path, MeshData& mesh, int threadCount, ImportStats* stats)
+{
+	double start = glfwGetTime();
+	if (threadCount <= 0)
+		threadCount = std::max(1, (int)std::thread::hardware_concurrency());
+
+	MappedFile file;
+	if (!file.open(path))
+	{
+		std::cout << "\n Could not open " << path;
+		return false;
+	}
+
+	std::string extension = path.substr(path.find_last_of('.') + 1);
+	std::transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+
+	mesh.vertices.clear();
+	mesh.indices.clear();
+	bool generatedNormals = false;
+	bool imported;
+	if (extension == "obj")
+		imported = importObj(file, mesh, threadCount, generatedNormals);
+	else if (extension == "ply")
+		imported = importPly(file, mesh, threadCount, generatedNormals);
+	else
+	{
+		std::cout << "\n Unknown mesh format " << path;
+		imported = false;
+	}
+
+	if (!imported)
+	{
+		std::cout << "\n Could not import " << path;
+		mesh.vertices.clear();
+		mesh.indices.clear();
+		return false;
+	}
+
+	if (stats != NULL)
+	{
+		stats->fileBytes = file.size;
+		stats->seconds = glfwGetTime() - start;
+		stats->threads = threadCount;
+		stats->generatedNormals = generatedNormals;
+	}
+	return true;
+}
+
+void fitMesh(MeshData& mesh, float radius)
+{
+	if (mesh.vertices.empty())
+		return;
+
+	glm::vec3 lower = mesh.vertices[0].position, upper = lower;
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+	{
+		lower = glm::min(lower, mesh.vertices[i].position);
+		upper = glm::max(upper, mesh.vertices[i].position);
+	}
+
+	glm::vec3 center = (lower + upper) * 0.5f;
+	float largest = 0.0f;
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+		largest = std::max(largest, glm::length(mesh.vertices[i].position - center));
+
+	float scale = largest > 0.0f ? radius / largest : 1.0f;
+	for (size_t i = 0; i < mesh.vertices.size(); i++)
+		mesh.vertices[i].position = (mesh.vertices[i].position - center) * scale;
+}
@@ -0,0 +1,71 @@
+/*
+Title: Reflection and refraction
+File Name: MeshImporter.h
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+Loads triangle meshes from Wavefront OBJ and PLY files into a MeshData,
+so any model can be drawn with the reflection and refraction shaders.
+
+Both readers map the file into memory (see MappedFile in MeshCache.h)
+and parse it on several threads:
+- OBJ is split into one chunk per thread at line boundaries. Every
+  chunk collects its own positions, normals and face corners; the
+  chunks are joined afterwards, which only has to add the number of
+  positions and normals in the chunks before it to the indices (also to
+  the relative, negative ones, which can point back into an earlier
+  chunk, so the result does not depend on where the chunks are cut).
+  Faces with more than three corners are split into a triangle fan.
+- PLY (binary_little_endian or binary_big_endian) has fixed size vertex
+  rows, so every thread reads its own range of rows directly. Faces are
+  assumed to be triangles, which makes their rows fixed size too; if a
+  face turns out not to be, the faces are read again on one thread.
+
+The vertex layout of stuff_for_drawing has one normal per vertex. OBJ
+corners which use the same position with a different normal become
+separate vertices. Files without normals get smooth, area weighted
+normals which are also computed in parallel.
+*/
+
+#ifndef _MESH_IMPORTER_H
+#define _MESH_IMPORTER_H
+
+#include "Mesh.h"
+
+// What the importer did, for reporting load times.
+struct ImportStats
+{
+	size_t fileBytes;
+	double seconds;
+	int threads;
+	bool generatedNormals;
+
+	double megabytesPerSecond() const { return seconds > 0.0 ? fileBytes / (1024.0 * 1024.0) / seconds : 0.0; }
+};
+
+// Loads an .obj or .ply file (by extension). threadCount 0 uses every hardware thread.
+// Prints the reason and returns false if the file cannot be read.
+bool importMesh(const std::string& path, MeshData& mesh, int threadCount = 0, ImportStats* stats = NULL);
+
+// Moves and scales the mesh so its bounding box is centered on the origin and its bounding sphere has the given radius.
+void fitMesh(MeshData& mesh, float radius);
+
+#endif //_MESH_IMPORTER_H
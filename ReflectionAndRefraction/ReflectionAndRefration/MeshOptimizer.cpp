@@ -0,0 +1,382 @@
+/*
+Title: Reflection and refraction
+File Name: MeshOptimizer.cpp
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+Mesh processing between generation and upload. See MeshOptimizer.h.
+*/
+
+#include "MeshOptimizer.h"
+#include <cmath>
+#include <iomanip>
+
+// The cache size the optimizer targets and the statistics are measured with. Most GPUs have a post-transform cache of
+// at least 16 vertices (it is often larger, but it is shared between several vertex shader batches).
+static const int defaultCacheSize = 16;
+
+// How much worse the ACMR may get for the overdraw order to be kept.
+static const float overdrawAcmrThreshold = 1.05f;
+
+MeshStats analyzeMesh(const MeshData& mesh, int cacheSize)
+{
+	MeshStats stats;
+	stats.triangles = mesh.indices.size() / 3;
+	stats.vertices = 0;
+
+	// The time (in number of misses) at which each vertex entered the cache. A vertex is in a FIFO cache as long as
+	// fewer than cacheSize other vertices have entered it since.
+	std::vector<long long> enteredAt(mesh.vertices.size(), -1);
+	std::vector<bool> used(mesh.vertices.size(), false);
+	long long misses = 0;
+
+	for (size_t i = 0; i < mesh.indices.size(); i++)
+	{
+		GLuint v = mesh.indices[i];
+		if (!used[v])
+		{
+			used[v] = true;
+			stats.vertices++;
+		}
+		if (enteredAt[v] < 0 || misses - enteredAt[v] >= cacheSize)
+		{
+			enteredAt[v] = misses;
+			misses++;
+		}
+	}
+
+	stats.acmr = stats.triangles ? (float)misses / stats.triangles : 0.0f;
+	stats.atvr = stats.vertices ? (float)misses / stats.vertices : 0.0f;
+	return stats;
+}
+
+size_t removeDegenerateTriangles(MeshData& mesh)
+{
+	size_t kept = 0;
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+	{
+		GLuint a = mesh.indices[i], b = mesh.indices[i + 1], c = mesh.indices[i + 2];
+		if (a == b || b == c || c == a)
+			continue;
+
+		// The poles of the UV sphere have a separate vertex for every segment, all at the same position.
+		const glm::vec3& pa = mesh.vertices[a].position;
+		const glm::vec3& pb = mesh.vertices[b].position;
+		const glm::vec3& pc = mesh.vertices[c].position;
+		if (pa == pb || pb == pc || pc == pa)
+			continue;
+
+		mesh.indices[kept++] = a;
+		mesh.indices[kept++] = b;
+		mesh.indices[kept++] = c;
+	}
+
+	size_t removed = mesh.indices.size() / 3 - kept / 3;
+	mesh.indices.resize(kept);
+	return removed;
+}
+
+// Forsyth's vertex score: vertices used by the last triangle get a fixed score, the rest of the cache scores less the older
+// the vertex is, and vertices with few triangles left get a boost so they are finished off instead of being left behind.
+static float vertexScore(int cachePosition, int remainingTriangles, int cacheSize)
+{
+	if (remainingTriangles == 0)
+		return -1.0f;
+
+	float score = 0.0f;
+	if (cachePosition >= 0)
+	{
+		if (cachePosition < 3)
+			score = 0.75f;
+		else
+			score = powf(1.0f - (float)(cachePosition - 3) / (cacheSize - 3), 1.5f);
+	}
+	return score + 2.0f * powf((float)remainingTriangles, -0.5f);
+}
+
+void optimizeVertexCache(MeshData& mesh, int cacheSize)
+{
+	size_t triangleCount = mesh.indices.size() / 3;
+	size_t vertexCount = mesh.vertices.size();
+	if (triangleCount == 0)
+		return;
+
+	// For every vertex, the list of triangles using it which have not been emitted yet.
+	// The lists are packed in one array; remaining[v] is the length of the list of v.
+	std::vector<int> remaining(vertexCount, 0);
+	std::vector<size_t> firstTriangle(vertexCount + 1, 0);
+	for (size_t i = 0; i < mesh.indices.size(); i++)
+		remaining[mesh.indices[i]]++;
+	for (size_t v = 0; v < vertexCount; v++)
+		firstTriangle[v + 1] = firstTriangle[v] + remaining[v];
+
+	std::vector<int> vertexTriangles(mesh.indices.size());
+	std::vector<int> filled(vertexCount, 0);
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		for (int k = 0; k < 3; k++)
+		{
+			GLuint v = mesh.indices[t * 3 + k];
+			vertexTriangles[firstTriangle[v] + filled[v]++] = (int)t;
+		}
+	}
+
+	std::vector<int> cachePosition(vertexCount, -1);
+	std::vector<float> score(vertexCount);
+	for (size_t v = 0; v < vertexCount; v++)
+		score[v] = vertexScore(-1, remaining[v], cacheSize);
+
+	std::vector<float> triangleScore(triangleCount);
+	std::vector<bool> emitted(triangleCount, false);
+	for (size_t t = 0; t < triangleCount; t++)
+		triangleScore[t] = score[mesh.indices[t * 3]] + score[mesh.indices[t * 3 + 1]] + score[mesh.indices[t * 3 + 2]];
+
+	std::vector<GLuint> result;
+	result.reserve(mesh.indices.size());
+
+	// The cache is modelled as a list, most recently used first. It can briefly hold three extra entries while a triangle is added.
+	std::vector<GLuint> cache, newCache;
+	cache.reserve(cacheSize + 3);
+	newCache.reserve(cacheSize + 3);
+
+	size_t nextUnemitted = 0;
+	int best = -1;
+
+	for (size_t count = 0; count < triangleCount; count++)
+	{
+		// No triangle touches the cache; continue with the first triangle which is left.
+		if (best < 0)
+		{
+			while (emitted[nextUnemitted])
+				nextUnemitted++;
+			best = (int)nextUnemitted;
+		}
+
+		emitted[best] = true;
+		const GLuint* corners = &mesh.indices[best * 3];
+		result.insert(result.end(), corners, corners + 3);
+
+		// Take the triangle off the lists of its vertices.
+		for (int k = 0; k < 3; k++)
+		{
+			GLuint v = corners[k];
+			int* list = &vertexTriangles[firstTriangle[v]];
+			for (int i = 0; i < remaining[v]; i++)
+			{
+				if (list[i] == best)
+				{
+					list[i] = list[remaining[v] - 1];
+					break;
+				}
+			}
+			remaining[v]--;
+		}
+
+		// The corners of the triangle move to the front of the cache, the other entries move back.
+		newCache.assign(corners, corners + 3);
+		for (size_t i = 0; i < cache.size(); i++)
+		{
+			if (cache[i] != corners[0] && cache[i] != corners[1] && cache[i] != corners[2])
+				newCache.push_back(cache[i]);
+		}
+
+		for (size_t i = 0; i < newCache.size(); i++)
+		{
+			GLuint v = newCache[i];
+			cachePosition[v] = (i < (size_t)cacheSize) ? (int)i : -1;
+			score[v] = vertexScore(cachePosition[v], remaining[v], cacheSize);
+		}
+
+		// Rescore the triangles around everything that changed and pick the best one for the next step.
+		best = -1;
+		float bestScore = -1.0f;
+		for (size_t i = 0; i < newCache.size(); i++)
+		{
+			GLuint v = newCache[i];
+			const int* list = &vertexTriangles[firstTriangle[v]];
+			for (int j = 0; j < remaining[v]; j++)
+			{
+				int t = list[j];
+				const GLuint* tc = &mesh.indices[t * 3];
+				triangleScore[t] = score[tc[0]] + score[tc[1]] + score[tc[2]];
+				if (triangleScore[t] > bestScore)
+				{
+					bestScore = triangleScore[t];
+					best = t;
+				}
+			}
+		}
+
+		if (newCache.size() > (size_t)cacheSize)
+			newCache.resize(cacheSize);
+		cache.swap(newCache);
+	}
+
+	mesh.indices.swap(result);
+}
+
+// A run of triangles which starts with a cold cache, with what is needed to sort it.
+struct TriangleCluster
+{
+	size_t first;
+	size_t count;
+	float sortKey;
+};
+
+static bool drawsBefore(const TriangleCluster& a, const TriangleCluster& b)
+{
+	return a.sortKey > b.sortKey;
+}
+
+bool optimizeOverdraw(MeshData& mesh, int cacheSize, float threshold)
+{
+	size_t triangleCount = mesh.indices.size() / 3;
+	if (triangleCount == 0)
+		return false;
+
+	// A cluster starts wherever a triangle misses the cache with all three vertices. The simulated cache is cold at those
+	// points, so moving the clusters around costs few extra vertex shader runs (the check at the end makes sure of it).
+	std::vector<TriangleCluster> clusters;
+	std::vector<long long> enteredAt(mesh.vertices.size(), -1);
+	long long misses = 0;
+	for (size_t t = 0; t < triangleCount; t++)
+	{
+		int triangleMisses = 0;
+		for (int k = 0; k < 3; k++)
+		{
+			GLuint v = mesh.indices[t * 3 + k];
+			if (enteredAt[v] < 0 || misses - enteredAt[v] >= cacheSize)
+			{
+				enteredAt[v] = misses;
+				misses++;
+				triangleMisses++;
+			}
+		}
+		if (t == 0 || triangleMisses == 3)
+		{
+			TriangleCluster cluster = { t, 0, 0.0f };
+			clusters.push_back(cluster);
+		}
+		clusters.back().count++;
+	}
+
+	// The center of the mesh, and for each cluster how much it faces away from it. Clusters on the outside of the mesh
+	// are drawn first, so they hide what is behind them before it is shaded.
+	glm::vec3 meshCenter(0.0f);
+	for (size_t i = 0; i < mesh.indices.size(); i++)
+		meshCenter += mesh.vertices[mesh.indices[i]].position;
+	meshCenter /= (float)mesh.indices.size();
+
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		glm::vec3 center(0.0f), normal(0.0f);
+		float area = 0.0f;
+		for (size_t t = clusters[c].first; t < clusters[c].first + clusters[c].count; t++)
+		{
+			const glm::vec3& a = mesh.vertices[mesh.indices[t * 3 + 0]].position;
+			const glm::vec3& b = mesh.vertices[mesh.indices[t * 3 + 1]].position;
+			const glm::vec3& d = mesh.vertices[mesh.indices[t * 3 + 2]].position;
+			glm::vec3 areaNormal = glm::cross(b - a, d - a);
+			float triangleArea = glm::length(areaNormal);
+			center += (a + b + d) * (triangleArea / 3.0f);
+			normal += areaNormal;
+			area += triangleArea;
+		}
+		if (area > 0.0f)
+			center /= area;
+		float normalLength = glm::length(normal);
+		clusters[c].sortKey = normalLength > 0.0f ? glm::dot(center - meshCenter, normal / normalLength) : 0.0f;
+	}
+
+	std::stable_sort(clusters.begin(), clusters.end(), drawsBefore);
+
+	std::vector<GLuint> result;
+	result.reserve(mesh.indices.size());
+	for (size_t c = 0; c < clusters.size(); c++)
+	{
+		const GLuint* first = &mesh.indices[clusters[c].first * 3];
+		result.insert(result.end(), first, first + clusters[c].count * 3);
+	}
+
+	float acmrBefore = analyzeMesh(mesh, cacheSize).acmr;
+	mesh.indices.swap(result);
+	if (analyzeMesh(mesh, cacheSize).acmr <= acmrBefore * threshold)
+		return true;
+	mesh.indices.swap(result);
+	return false;
+}
+
+void optimizeVertexFetch(MeshData& mesh)
+{
+	const GLuint unused = 0xFFFFFFFF;
+	std::vector<GLuint> remap(mesh.vertices.size(), unused);
+	std::vector<VertexFormat> vertices;
+	vertices.reserve(mesh.vertices.size());
+
+	for (size_t i = 0; i < mesh.indices.size(); i++)
+	{
+		GLuint& v = mesh.indices[i];
+		if (remap[v] == unused)
+		{
+			remap[v] = (GLuint)vertices.size();
+			vertices.push_back(mesh.vertices[v]);
+		}
+		v = remap[v];
+	}
+
+	mesh.vertices.swap(vertices);
+}
+
+static void printStats(const char* step, const MeshData& mesh)
+{
+	MeshStats stats = analyzeMesh(mesh, defaultCacheSize);
+	std::cout << std::setw(24) << step << std::setw(12) << stats.triangles << std::setw(12) << stats.vertices
+		<< std::setw(10) << std::setprecision(3) << stats.acmr
+		<< std::setw(10) << stats.atvr << "\n";
+}
+
+void optimizeMesh(MeshData& mesh, bool report, bool reduceOverdraw)
+{
+	if (report)
+	{
+		std::cout << std::setw(24) << "step" << std::setw(12) << "triangles" << std::setw(12) << "vertices" << std::setw(10) << "ACMR" << std::setw(10) << "ATVR" << "\n";
+		printStats("generated", mesh);
+	}
+
+	removeDegenerateTriangles(mesh);
+	if (report)
+		printStats("degenerates removed", mesh);
+
+	optimizeVertexCache(mesh, defaultCacheSize);
+	if (report)
+		printStats("vertex cache", mesh);
+
+	if (reduceOverdraw)
+	{
+		bool kept = optimizeOverdraw(mesh, defaultCacheSize, overdrawAcmrThreshold);
+		if (report)
+			printStats(kept ? "overdraw" : "overdraw (not kept)", mesh);
+	}
+
+	optimizeVertexFetch(mesh);
+	if (report)
+		printStats("vertex fetch", mesh);
+}
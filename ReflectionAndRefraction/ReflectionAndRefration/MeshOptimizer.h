@@ -0,0 +1,84 @@
+/*
+Title: Reflection and refraction
+File Name: MeshOptimizer.h
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+Mesh processing that runs between generating a mesh and uploading it with
+stuff_for_drawing::initBuffer. None of it changes how the mesh looks, it
+only changes the order of the triangles and vertices so the GPU does less
+work drawing them:
+- degenerate (zero area) triangles are removed,
+- triangles are reordered so vertices are reused while they are still in
+  the post-transform cache (Tom Forsyth's linear-speed algorithm),
+- for meshes which cover parts of themselves, groups of triangles are
+  ordered so that the ones facing outwards are drawn first, which reduces
+  overdraw (a convex mesh like the spheres has no overdraw once its back
+  faces are culled, so it skips this step),
+- vertices are reordered in the order the triangles first use them, so
+  the vertex fetch reads memory front to back.
+
+The quality of the triangle order is measured with a simulated FIFO
+cache:
+- ACMR (average cache miss ratio) is the number of vertex shader runs
+  per triangle. It is 3 for unindexed triangles and about 0.5 at best for
+  a regular grid.
+- ATVR (average transformed vertex ratio) is the number of vertex shader
+  runs per vertex. It is 1.0 at best.
+*/
+
+#ifndef _MESH_OPTIMIZER_H
+#define _MESH_OPTIMIZER_H
+
+#include "Mesh.h"
+
+// The result of running a mesh through a simulated vertex cache.
+struct MeshStats
+{
+	size_t triangles;
+	size_t vertices;
+	float acmr;
+	float atvr;
+};
+
+// Simulates a FIFO post-transform cache of cacheSize entries.
+MeshStats analyzeMesh(const MeshData& mesh, int cacheSize);
+
+// Removes triangles which have two identical indices or two corners at the same position. Returns how many were removed.
+size_t removeDegenerateTriangles(MeshData& mesh);
+
+// Reorders the triangles for a post-transform cache of (about) cacheSize vertices.
+void optimizeVertexCache(MeshData& mesh, int cacheSize);
+
+// Splits the triangle list into clusters where the cache starts cold, and sorts the clusters so the ones facing away from
+// the center of the mesh are drawn first. A moved cluster can lose vertices which were still in a real cache (of another size
+// or policy) from the cluster before it, so the ACMR is measured before and after, and the new order is only kept if its ACMR
+// is at most threshold times the old one. Returns whether the order was kept.
+bool optimizeOverdraw(MeshData& mesh, int cacheSize, float threshold);
+
+// Reorders the vertices in the order the index list first uses them, and drops vertices no triangle uses.
+void optimizeVertexFetch(MeshData& mesh);
+
+// Runs all the steps above, the overdraw step only with reduceOverdraw (for concave meshes). With report, the cache statistics
+// are printed after every step.
+void optimizeMesh(MeshData& mesh, bool report, bool reduceOverdraw);
+
+#endif //_MESH_OPTIMIZER_H
@@ -0,0 +1,135 @@
+/*
+Title: Reflection and refraction
+File Name: Scene.cpp
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+Component storage of the scene objects, see Scene.h.
+*/
+
+#include "Scene.h"
+
+MeshHandle Scene::addMesh()
+{
+	drawables.push_back(stuff_for_drawing());
+	return (MeshHandle)drawables.size() - 1;
+}
+
+ObjectHandle Scene::create(MeshHandle mesh, const glm::vec3& position, float radius, const glm::vec4& material)
+{
+	ObjectHandle object;
+	if (freeSlots.empty())
+	{
+		object.slot = (int)slotIndex.size();
+		slotIndex.push_back(-1);
+		slotGeneration.push_back(0);
+	}
+	else
+	{
+		object.slot = freeSlots.back();
+		freeSlots.pop_back();
+	}
+	object.generation = slotGeneration[object.slot];
+
+	slotIndex[object.slot] = size();
+	indexSlot.push_back(object.slot);
+	positions.push_back(position);
+	radii.push_back(radius);
+	worldMatrices.push_back(glm::translate(glm::mat4(1), position));
+	meshes.push_back(mesh);
+	materials.push_back(material);
+	lods.push_back(0);
+	dirty.push_back(0);
+	bounds.add(position, radius);
+	return object;
+}
+
+void Scene::destroy(ObjectHandle object)
+{
+	int index = indexOf(object);
+	if (index < 0)
+		return;
+
+	// Move the last object into the hole, and point its slot at its new index.
+	int last = size() - 1;
+	if (index != last)
+	{
+		positions[index] = positions[last];
+		radii[index] = radii[last];
+		worldMatrices[index] = worldMatrices[last];
+		meshes[index] = meshes[last];
+		materials[index] = materials[last];
+		lods[index] = lods[last];
+		dirty[index] = dirty[last];
+		bounds.set(index, glm::vec3(bounds.x[last], bounds.y[last], bounds.z[last]), bounds.radius[last]);
+		indexSlot[index] = indexSlot[last];
+		slotIndex[indexSlot[index]] = index;
+	}
+	positions.pop_back();
+	radii.pop_back();
+	worldMatrices.pop_back();
+	meshes.pop_back();
+	materials.pop_back();
+	lods.pop_back();
+	dirty.pop_back();
+	bounds.resize(last);
+	indexSlot.pop_back();
+
+	slotIndex[object.slot] = -1;
+	slotGeneration[object.slot]++;
+	freeSlots.push_back(object.slot);
+}
+
+int Scene::indexOf(ObjectHandle object) const
+{
+	if (object.slot < 0 || object.slot >= (int)slotIndex.size() || slotGeneration[object.slot] != object.generation)
+		return -1;
+	return slotIndex[object.slot];
+}
+
+void Scene::setPosition(ObjectHandle object, const glm::vec3& position)
+{
+	int index = indexOf(object);
+	if (index < 0)
+		return;
+	positions[index] = position;
+	dirty[index] = 1;
+}
+
+int Scene::updateWorldMatrices()
+{
+	return updateWorldMatrices(0, size());
+}
+
+int Scene::updateWorldMatrices(int first, int last)
+{
+	int updated = 0;
+	for (int i = first; i < last; i++)
+	{
+		if (!dirty[i])
+			continue;
+		worldMatrices[i] = glm::translate(glm::mat4(1), positions[i]);
+		bounds.set(i, positions[i], radii[i]);
+		dirty[i] = 0;
+		updated++;
+	}
+	return updated;
+}
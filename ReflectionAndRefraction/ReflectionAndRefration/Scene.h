@@ -0,0 +1,102 @@
+/*
+Title: Reflection and refraction
+File Name: Scene.h
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+The objects of the scene, stored as components: one array for the
+positions, one for the world matrices, one for the meshes and so on,
+where index i of every array belongs to the same object. The live
+objects are packed at the front of the arrays without holes, so update()
+and renderScene() walk them from start to end and only touch the
+components they need.
+
+Objects are created and destroyed through ObjectHandles. Destroying an
+object moves the last one into its place, so the index of an object can
+change; its handle does not. A handle stays valid until its object is
+destroyed, and a handle of a destroyed object is recognized as such even
+after its slot has been reused (every slot has a generation counter).
+
+The meshes are stored once in the scene and the objects refer to them by
+MeshHandle, so many objects can share a mesh.
+*/
+
+#ifndef _SCENE_H
+#define _SCENE_H
+
+#include "GLIncludes.h"
+#include "Mesh.h"
+#include "Culling.h"
+
+// Index into Scene::drawables.
+typedef int MeshHandle;
+#define NO_MESH -1
+
+struct ObjectHandle
+{
+	int slot;
+	int generation;
+};
+
+struct Scene
+{
+	// Components of the live objects.
+	std::vector<glm::vec3> positions;
+	std::vector<float> radii;				// Bounding radius around the position, for the level of detail and culling
+	std::vector<glm::mat4> worldMatrices;	// translate(position), recomputed by updateWorldMatrices when the object is dirty
+	std::vector<MeshHandle> meshes;
+	std::vector<glm::vec4> materials;		// The same as SphereInstance::material: ratio of the indices of refraction, reflection, refraction and lighting weights
+	std::vector<int> lods;					// The level of detail drawn in the last frame
+	std::vector<unsigned char> dirty;		// 1 when the position changed since the world matrix was computed
+	SphereBounds bounds;					// position and radius again, for cullSpheres; updated with the world matrix
+
+	// The meshes the objects refer to.
+	std::vector<stuff_for_drawing> drawables;
+
+	int size() const { return (int)positions.size(); }
+
+	// Adds an empty mesh to drawables, to be uploaded with one of its initBuffer functions. Adding more meshes can move the earlier ones,
+	// so keep the handle, not a reference.
+	MeshHandle addMesh();
+
+	ObjectHandle create(MeshHandle mesh, const glm::vec3& position, float radius, const glm::vec4& material);
+
+	// Removes the object. The last object takes its index.
+	void destroy(ObjectHandle object);
+
+	// The index of the object in the component arrays, or -1 if it has been destroyed.
+	int indexOf(ObjectHandle object) const;
+
+	void setPosition(ObjectHandle object, const glm::vec3& position);
+
+	// Recomputes the world matrices and bounds of the dirty objects. Returns how many there were.
+	int updateWorldMatrices();
+	// The same for the objects first to last - 1, so different threads can update different parts.
+	int updateWorldMatrices(int first, int last);
+
+private:
+	std::vector<int> slotIndex;				// Index of the object of every slot, -1 for free slots
+	std::vector<int> slotGeneration;		// Incremented when the object of the slot is destroyed
+	std::vector<int> freeSlots;
+	std::vector<int> indexSlot;				// The slot of the object at every index, to find its handle when it is moved
+};
+
+#endif //_SCENE_H
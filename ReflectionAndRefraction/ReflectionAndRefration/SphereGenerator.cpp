@@ -0,0 +1,262 @@
+/*
+Title: Reflection and refraction
+File Name: SphereGenerator.cpp
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+Procedural sphere meshes. See SphereGenerator.h.
+*/
+
+#include "SphereGenerator.h"
+#include <cmath>
+#include <xmmintrin.h>
+#include <unordered_map>
+
+// The SSE kernel below writes VertexFormat as six tightly packed floats.
+static_assert(sizeof(VertexFormat) == 6 * sizeof(float), "VertexFormat must be six packed floats");
+
+// Writes one ring of the sphere. Every vertex of the ring shares the same pitch, so the ring only needs the
+// radius scaled by sin(pitch) and cos(pitch), and the per-segment sin/cos tables for the yaw.
+static void writeRing(float* out, int count, float ringSin, float ringCos, const float* segmentCos, const float* segmentSin)
+{
+	int j = 0;
+
+	__m128 rs = _mm_set1_ps(ringSin);
+	__m128 z = _mm_set1_ps(ringCos);
+
+	// Four vertices per iteration. The positions are computed as x[4], y[4], z[4] and then shuffled into
+	// x y z x y z (position followed by the normal, which is the same vector) for each vertex.
+	for (; j + 4 <= count; j += 4)
+	{
+		__m128 x = _mm_mul_ps(rs, _mm_loadu_ps(segmentCos + j));
+		__m128 y = _mm_mul_ps(rs, _mm_loadu_ps(segmentSin + j));
+
+		__m128 xy = _mm_unpacklo_ps(x, y);	// x0 y0 x1 y1
+		__m128 zx = _mm_unpacklo_ps(z, x);	// z0 x0 z1 x1
+		__m128 yz = _mm_unpacklo_ps(y, z);	// y0 z0 y1 z1
+		_mm_storeu_ps(out + 0, _mm_shuffle_ps(xy, zx, _MM_SHUFFLE(1, 0, 1, 0)));	// x0 y0 z0 x0
+		_mm_storeu_ps(out + 4, _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 2, 1, 0)));	// y0 z0 x1 y1
+		_mm_storeu_ps(out + 8, _mm_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 2, 3, 2)));	// z1 x1 y1 z1
+
+		xy = _mm_unpackhi_ps(x, y);			// x2 y2 x3 y3
+		zx = _mm_unpackhi_ps(z, x);			// z2 x2 z3 x3
+		yz = _mm_unpackhi_ps(y, z);			// y2 z2 y3 z3
+		_mm_storeu_ps(out + 12, _mm_shuffle_ps(xy, zx, _MM_SHUFFLE(1, 0, 1, 0)));
+		_mm_storeu_ps(out + 16, _mm_shuffle_ps(yz, xy, _MM_SHUFFLE(3, 2, 1, 0)));
+		_mm_storeu_ps(out + 20, _mm_shuffle_ps(zx, yz, _MM_SHUFFLE(3, 2, 3, 2)));
+
+		out += 24;
+	}
+
+	// Whatever is left over when the ring is not a multiple of four.
+	for (; j < count; j++)
+	{
+		out[0] = out[3] = ringSin * segmentCos[j];
+		out[1] = out[4] = ringSin * segmentSin[j];
+		out[2] = out[5] = ringCos;
+		out += 6;
+	}
+}
+
+void generateUVSphere(float radius, int rings, int segments, MeshData& mesh)
+{
+	int verticesPerRing = segments + 1;
+
+	// Every size is known up front, so both arrays are allocated once instead of growing with push_back.
+	mesh.vertices.resize((size_t)(rings + 1) * verticesPerRing);
+	mesh.indices.resize((size_t)rings * segments * 6);
+
+	// sin and cos are only evaluated once per ring and once per segment. The radius is folded into the ring table.
+	std::vector<float> ringSin(rings + 1), ringCos(rings + 1);
+	std::vector<float> segmentSin(verticesPerRing), segmentCos(verticesPerRing);
+
+	double pitchDelta = PI / rings;
+	double yawDelta = 2.0 * PI / segments;
+
+	for (int i = 0; i <= rings; i++)
+	{
+		ringSin[i] = radius * (float)sin(i * pitchDelta);
+		ringCos[i] = radius * (float)cos(i * pitchDelta);
+	}
+	for (int j = 0; j < segments; j++)
+	{
+		segmentSin[j] = (float)sin(j * yawDelta);
+		segmentCos[j] = (float)cos(j * yawDelta);
+	}
+	// The last vertex of every ring sits exactly on top of the first one.
+	segmentSin[segments] = segmentSin[0];
+	segmentCos[segments] = segmentCos[0];
+	// Make sure the poles are exactly on the axis.
+	ringSin[0] = ringSin[rings] = 0.0f;
+
+	float* out = (float*)mesh.vertices.data();
+	for (int i = 0; i <= rings; i++)
+	{
+		writeRing(out, verticesPerRing, ringSin[i], ringCos[i], segmentCos.data(), segmentSin.data());
+		out += 6 * verticesPerRing;
+	}
+
+	// Two counter-clockwise triangles per quad of the grid.
+	GLuint* index = mesh.indices.data();
+	for (int i = 0; i < rings; i++)
+	{
+		GLuint row = i * verticesPerRing;
+		for (int j = 0; j < segments; j++)
+		{
+			GLuint p1 = row + j;
+			GLuint p2 = p1 + 1;
+			GLuint p3 = p2 + verticesPerRing;
+			GLuint p4 = p1 + verticesPerRing;
+
+			index[0] = p1; index[1] = p3; index[2] = p2;
+			index[3] = p1; index[4] = p4; index[5] = p3;
+			index += 6;
+		}
+	}
+}
+
+// Returns the index of the vertex halfway along the edge (a, b), pushed out onto the sphere.
+// Every edge is shared by two triangles, so the midpoint is created by whichever triangle gets there first
+// and looked up in the cache by the other one.
+static GLuint midpoint(GLuint a, GLuint b, float radius, MeshData& mesh, std::unordered_map<unsigned long long, GLuint>& cache)
+{
+	unsigned long long key = a < b ? ((unsigned long long)a << 32) | b : ((unsigned long long)b << 32) | a;
+
+	std::unordered_map<unsigned long long, GLuint>::iterator found = cache.find(key);
+	if (found != cache.end())
+		return found->second;
+
+	glm::vec3 position = glm::normalize(mesh.vertices[a].position + mesh.vertices[b].position) * radius;
+	GLuint index = (GLuint)mesh.vertices.size();
+	mesh.vertices.push_back(VertexFormat(position, position));
+	cache[key] = index;
+	return index;
+}
+
+void generateIcosphere(float radius, int subdivisions, MeshData& mesh)
+{
+	// The 12 corners of an icosahedron lie on three orthogonal golden rectangles.
+	const float t = (1.0f + sqrtf(5.0f)) / 2.0f;
+	const float corners[12][3] = {
+		{ -1, t, 0 }, { 1, t, 0 }, { -1, -t, 0 }, { 1, -t, 0 },
+		{ 0, -1, t }, { 0, 1, t }, { 0, -1, -t }, { 0, 1, -t },
+		{ t, 0, -1 }, { t, 0, 1 }, { -t, 0, -1 }, { -t, 0, 1 } };
+
+	// The 20 faces, counter-clockwise when seen from outside.
+	const GLuint faces[60] = {
+		0, 11, 5, 0, 5, 1, 0, 1, 7, 0, 7, 10, 0, 10, 11,
+		1, 5, 9, 5, 11, 4, 11, 10, 2, 10, 7, 6, 7, 1, 8,
+		3, 9, 4, 3, 4, 2, 3, 2, 6, 3, 6, 8, 3, 8, 9,
+		4, 9, 5, 2, 4, 11, 6, 2, 10, 8, 6, 7, 9, 8, 1 };
+
+	size_t finalTriangles = (size_t)20 << (2 * subdivisions);
+	size_t finalVertices = finalTriangles / 2 + 2;
+
+	mesh.vertices.clear();
+	mesh.vertices.reserve(finalVertices);
+	for (int i = 0; i < 12; i++)
+	{
+		glm::vec3 position = glm::normalize(glm::vec3(corners[i][0], corners[i][1], corners[i][2])) * radius;
+		mesh.vertices.push_back(VertexFormat(position, position));
+	}
+	mesh.indices.assign(faces, faces + 60);
+
+	std::unordered_map<unsigned long long, GLuint> cache;
+	std::vector<GLuint> subdivided;
+
+	for (int level = 0; level < subdivisions; level++)
+	{
+		size_t triangles = mesh.indices.size() / 3;
+
+		// Each level has 1.5 edges per triangle, and each edge gets one midpoint.
+		cache.clear();
+		cache.reserve(triangles * 3 / 2);
+		subdivided.resize(triangles * 12);
+
+		GLuint* out = subdivided.empty() ? NULL : &subdivided[0];
+		for (size_t i = 0; i < triangles; i++)
+		{
+			GLuint a = mesh.indices[i * 3 + 0];
+			GLuint b = mesh.indices[i * 3 + 1];
+			GLuint c = mesh.indices[i * 3 + 2];
+			GLuint ab = midpoint(a, b, radius, mesh, cache);
+			GLuint bc = midpoint(b, c, radius, mesh, cache);
+			GLuint ca = midpoint(c, a, radius, mesh, cache);
+
+			// One triangle in each corner and one in the middle, all keeping the winding of the parent.
+			out[0] = a;  out[1] = ab;  out[2] = ca;
+			out[3] = b;  out[4] = bc;  out[5] = ab;
+			out[6] = c;  out[7] = ca;  out[8] = bc;
+			out[9] = ab; out[10] = bc; out[11] = ca;
+			out += 12;
+		}
+
+		mesh.indices.swap(subdivided);
+	}
+}
+
+void generateSphere(SphereMode mode, float radius, int detail, MeshData& mesh)
+{
+	if (mode == SPHERE_ICOSPHERE)
+		generateIcosphere(radius, detail, mesh);
+	else
+		generateUVSphere(radius, detail, detail, mesh);
+}
+
+void generateSphereLODs(SphereMode mode, float radius, std::vector<MeshData>& levels, std::vector<float>& errors)
+{
+	const int uvDivisions[] = { 8, 16, 32, 64, 128, 256 };
+	const int icoSubdivisions[] = { 1, 2, 3, 4, 5, 6 };
+	const int count = 6;
+
+	levels.resize(count);
+	errors.resize(count);
+	for (int i = 0; i < count; i++)
+	{
+		generateSphere(mode, radius, mode == SPHERE_ICOSPHERE ? icoSubdivisions[i] : uvDivisions[i], levels[i]);
+		errors[i] = (float)(1.0 - cos(maxAngularError(levels[i]) * 3.14159265358979 / 180.0));
+	}
+}
+
+double maxAngularError(const MeshData& mesh)
+{
+	double worst = 0.0;
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+	{
+		glm::dvec3 a = glm::dvec3(mesh.vertices[mesh.indices[i + 0]].position);
+		glm::dvec3 b = glm::dvec3(mesh.vertices[mesh.indices[i + 1]].position);
+		glm::dvec3 c = glm::dvec3(mesh.vertices[mesh.indices[i + 2]].position);
+		glm::dvec3 faceNormal = glm::cross(b - a, c - a);
+
+		// The UV sphere has zero area triangles at the poles, they do not show up on screen.
+		if (glm::length(faceNormal) < 1e-12)
+			continue;
+		faceNormal = glm::normalize(faceNormal);
+
+		glm::dvec3 corners[3] = { a, b, c };
+		for (int k = 0; k < 3; k++)
+		{
+			double cosine = glm::clamp(glm::dot(faceNormal, glm::normalize(corners[k])), -1.0, 1.0);
+			worst = std::max(worst, acos(cosine) * 180.0 / 3.14159265358979);
+		}
+	}
+	return worst;
+}
@@ -0,0 +1,71 @@
+/*
+Title: Reflection and refraction
+File Name: SphereGenerator.h
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+Procedural sphere meshes. The UV sphere generator builds sin/cos tables
+once per ring and once per segment, and then fills a preallocated vertex
+array with SSE, four vertices at a time. The tessellation is a runtime
+parameter, so the same code builds a 8x8 sphere or a 2048x2048 one.
+
+The icosphere generator starts from an icosahedron and splits every
+triangle into four, N times. Its triangles are all about the same size,
+while the UV sphere crowds thin triangles around the poles. Both
+generators fill a MeshData, so either one can be handed to
+stuff_for_drawing::initBuffer.
+*/
+
+#ifndef _SPHERE_GENERATOR_H
+#define _SPHERE_GENERATOR_H
+
+#include "Mesh.h"
+
+// Builds a sphere of the given radius centered at the origin.
+// rings is the number of steps from pole to pole and segments is the number of steps around the equator.
+// Normals are equal to the positions, as in the original setupSphere().
+void generateUVSphere(float radius, int rings, int segments, MeshData& mesh);
+
+// Builds a sphere by subdividing an icosahedron. Every subdivision multiplies the triangle count by four,
+// so the mesh has 20 * 4^subdivisions triangles and 10 * 4^subdivisions + 2 vertices.
+void generateIcosphere(float radius, int subdivisions, MeshData& mesh);
+
+// The two ways the sphere can be tessellated.
+enum SphereMode
+{
+	SPHERE_UV,
+	SPHERE_ICOSPHERE
+};
+
+// Builds a sphere with either generator. For SPHERE_UV, detail is the number of rings and segments;
+// for SPHERE_ICOSPHERE it is the number of subdivisions.
+void generateSphere(SphereMode mode, float radius, int detail, MeshData& mesh);
+
+// Builds the chain of levels of detail for the given mode, coarsest first, and the error of each level
+// (1 - cos of the maximum angular error, so the error on screen is error * radius in pixels).
+// UV spheres go from 8 to 256 divisions and icospheres from 1 to 6 subdivisions.
+void generateSphereLODs(SphereMode mode, float radius, std::vector<MeshData>& levels, std::vector<float>& errors);
+
+// The largest angle, in degrees, between the flat face of a triangle and the true sphere normal at its corners.
+// This is how far the silhouette and the shading can be off from a perfect sphere.
+double maxAngularError(const MeshData& mesh);
+
+#endif //_SPHERE_GENERATOR_H
@@ -0,0 +1,63 @@
+/*
+Title: Reflection and refraction
+File Name: TessControlShader.glsl
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+Tessellation control shader of the hardware tessellation path. It picks
+how many segments each edge of the base mesh is split into, from the
+length of the edge and its distance to the camera, so the sphere gets
+finer as it comes closer and coarser as it moves away. The level of an
+edge only depends on its two corners, so the two triangles sharing an
+edge always agree on it and no cracks open up.
+*/
+
+#version 430 core // Identifies the version of the shader, this line must be on a separate line from the rest of the shader code
+
+layout(vertices = 3) out;
+
+in vec3 vPosition[];
+out vec3 tcPosition[];
+
+// FrameUniforms and ObjectUniforms come from UniformBlocks.glsl, which readShader puts in after #version.
+
+uniform float tessDetail;					// Segments per unit of edge length, for an edge at distance 1 from the camera.
+
+float edgeLevel(vec3 a, vec3 b)
+{
+	vec3 middle = (translation * vec4((a + b) * 0.5f, 1.0f)).xyz;
+	float distanceToCamera = max(distance(camPos, middle), 0.001f);
+	return clamp(tessDetail * distance(a, b) / distanceToCamera, 1.0f, 64.0f);
+}
+
+void main(void)
+{
+	tcPosition[gl_InvocationID] = vPosition[gl_InvocationID];
+
+	if (gl_InvocationID == 0)
+	{
+		// Outer level i is the edge opposite to corner i.
+		gl_TessLevelOuter[0] = edgeLevel(vPosition[1], vPosition[2]);
+		gl_TessLevelOuter[1] = edgeLevel(vPosition[2], vPosition[0]);
+		gl_TessLevelOuter[2] = edgeLevel(vPosition[0], vPosition[1]);
+		gl_TessLevelInner[0] = max(gl_TessLevelOuter[0], max(gl_TessLevelOuter[1], gl_TessLevelOuter[2]));
+	}
+}
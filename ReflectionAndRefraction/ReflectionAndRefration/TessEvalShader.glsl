@@ -0,0 +1,98 @@
+/*
+Title: Reflection and refraction
+File Name: TessEvalShader.glsl
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+Tessellation evaluation shader of the hardware tessellation path. Every
+vertex made by the tessellator is pushed out onto the exact sphere, and
+then lit, reflected and refracted exactly like VertexShader.glsl does for
+the vertices of the CPU built sphere.
+*/
+
+#version 430 core // Identifies the version of the shader, this line must be on a separate line from the rest of the shader code
+
+layout(triangles, fractional_odd_spacing, ccw) in;
+
+in vec3 tcPosition[];
+
+out vec4 color;								// This variable carries the light component on that pixel. 
+out vec3 reflectDir;						// this variable hold the reflected vector
+out vec3 refractDir;						// This variable hold the refracted vector
+
+// FrameUniforms and ObjectUniforms come from UniformBlocks.glsl, which readShader puts in after #version.
+
+vec3 LightPos;								// Light properties.
+vec3 DiffuseLight;
+vec3 SpecularLight;
+
+//This function returns the component of the light reflected as diffuse texture.
+vec3 diffuseComponent(vec3 position, vec3 normal)
+{
+	vec3 s = normalize(LightPos - position);
+
+	return DiffuseLight * max(dot(s, normal),0.0f);
+}
+
+//This function deals with the light reflected due to specular behaviour
+vec3 specularComponent(vec3 position, vec3 normal)
+{
+	vec3 s = normalize(LightPos - position);
+	vec3 r = (2 * dot(s,normal) * normal) - s;
+	vec3 v = normalize(camPos - position);
+	
+	//the more the power of dot(v,r), the smaller the shinier the surface.
+	return SpecularLight * max(pow(dot(v,r),3),0.0f);
+}
+
+vec4 diffuseAndSpecular (vec3 position, vec3 normal)
+{
+	// This function uses the above two functions to calculate the lighting values.
+	return vec4((diffuseComponent(position,normal) + specularComponent(position, normal)),1.0f);
+}
+
+void main(void)
+{
+	//Blend the corners of the base triangle and move the point onto the sphere. As for the CPU sphere, the normal equals the position.
+	vec3 corner = gl_TessCoord.x * tcPosition[0] + gl_TessCoord.y * tcPosition[1] + gl_TessCoord.z * tcPosition[2];
+	vec3 in_position = normalize(corner) * radius;
+	vec3 in_normal = in_position;
+
+	LightPos = vec3(3.0f, 3.0f,0.0f);
+	DiffuseLight = vec3 (0.5f,0.5f,0.5f);
+	SpecularLight = vec3(0.74f,0.74f,0.74f);
+
+	//Since the object is moving in the world space, we need to apply those transformation to the position and normals of the vertex.
+	vec3 pos = (vec4(in_position,1.0f) * translation).xyz;
+	vec3 normal = (vec4(in_normal, 1.0f) * translation).xyz;
+	vec3 viewDirection = normalize(camPos - pos);
+	
+	//Reflect the vector view direction with respect to normal.
+	reflectDir = reflect(-viewDirection, normal);
+	//Refract the vector view Direction, with respect to normal with the ration of the indices of refraction.
+	// refract(incidentVector, normalVector, ratio)
+	refractDir = refract(-viewDirection, normal, material.x);
+	
+	//Calculate the lighting calculations
+	color = diffuseAndSpecular(pos, normalize(normal));
+	//apply the transformation and multiply with the view and prespective matrix to get the final positio nof the vertex.
+	gl_Position = PV * translation * vec4(in_position, 1.0); //w is 1.0, also notice cast to a vec4
+}
\ No newline at end of file
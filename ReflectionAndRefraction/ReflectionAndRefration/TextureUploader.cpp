@@ -0,0 +1,160 @@
+/*
+Title: Reflection and refraction
+File Name: TextureUploader.cpp
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Description:
+The persistently mapped upload ring, see TextureUploader.h.
+*/
+
+#include "TextureUploader.h"
+
+TextureUploader::TextureUploader()
+{
+	buffer = 0;
+	mapped = NULL;
+	size = 0;
+	head = 0;
+}
+
+bool TextureUploader::init(size_t ringSize)
+{
+	release();
+	if (!GLEW_ARB_buffer_storage)
+		return false;
+
+	const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glGenBuffers(1, &buffer);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, buffer);
+	glBufferStorage(GL_PIXEL_UNPACK_BUFFER, ringSize, NULL, flags);
+	mapped = (unsigned char*)glMapBufferRange(GL_PIXEL_UNPACK_BUFFER, 0, ringSize, flags);
+	glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+	if (!mapped)
+	{
+		release();
+		return false;
+	}
+	size = ringSize;
+	head = 0;
+	return true;
+}
+
+void TextureUploader::release()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		if (blocks[i].fence)
+			glDeleteSync(blocks[i].fence);
+	}
+	blocks.clear();
+	// Deleting the buffer unmaps it.
+	if (buffer)
+		glDeleteBuffers(1, &buffer);
+	buffer = 0;
+	mapped = NULL;
+	size = 0;
+	head = 0;
+}
+
+bool TextureUploader::overlaps(size_t begin, size_t end) const
+{
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		if (begin < blocks[i].end && blocks[i].begin < end)
+			return true;
+	}
+	return false;
+}
+
+unsigned char* TextureUploader::allocate(size_t bytes)
+{
+	if (!mapped || bytes == 0 || bytes > size)
+		return NULL;
+	bytes = (bytes + TEXTURE_UPLOAD_ALIGNMENT - 1) & ~(size_t)(TEXTURE_UPLOAD_ALIGNMENT - 1);
+
+	std::lock_guard<std::mutex> guard(lock);
+	// After the last block, or else from the start of the ring. The blocks in use are few, so they are simply all checked.
+	size_t begin = head;
+	if (begin + bytes > size || overlaps(begin, begin + bytes))
+	{
+		begin = 0;
+		if (bytes > size || overlaps(begin, begin + bytes))
+			return NULL;
+	}
+
+	Block block;
+	block.begin = begin;
+	block.end = begin + bytes;
+	block.retired = false;
+	block.fence = NULL;
+	blocks.push_back(block);
+	head = block.end;
+	return mapped + begin;
+}
+
+void TextureUploader::retire(unsigned char* memory)
+{
+	std::lock_guard<std::mutex> guard(lock);
+	size_t begin = memory - mapped;
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		if (blocks[i].begin == begin && !blocks[i].retired)
+		{
+			blocks[i].retired = true;
+			return;
+		}
+	}
+}
+
+void TextureUploader::update()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	// A fence behind the copies from every block retired since the last frame.
+	for (size_t i = 0; i < blocks.size(); i++)
+	{
+		if (blocks[i].retired && !blocks[i].fence)
+			blocks[i].fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+	}
+
+	// Free the oldest blocks while the GPU is done with them, without waiting. The flush makes sure the fence gets to the GPU
+	// even when nothing else flushes, like CubeMapStream::finish(), which would otherwise wait for it forever.
+	while (!blocks.empty() && blocks.front().fence)
+	{
+		GLenum status = glClientWaitSync(blocks.front().fence, GL_SYNC_FLUSH_COMMANDS_BIT, 0);
+		if (status != GL_ALREADY_SIGNALED && status != GL_CONDITION_SATISFIED)
+			break;
+		glDeleteSync(blocks.front().fence);
+		blocks.pop_front();
+	}
+	if (blocks.empty())
+		head = 0;
+}
+
+size_t TextureUploader::used()
+{
+	std::lock_guard<std::mutex> guard(lock);
+	size_t bytes = 0;
+	for (size_t i = 0; i < blocks.size(); i++)
+		bytes += blocks[i].end - blocks[i].begin;
+	return bytes;
+}
@@ -0,0 +1,108 @@
+/*
+Title: Reflection and refraction
+File Name: TextureUploader.h
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+
+Description:
+A ring of pixel memory which the GPU copies textures from, so uploads do
+not block the GL thread.
+
+glTexImage2D and glTexSubImage2D from client memory do not return before
+the driver has copied the pixels, which for a 2048x2048 face is 16 MB on
+the GL thread. Here the pixels go into a GL_PIXEL_UNPACK_BUFFER which is
+mapped once, persistently and coherently (ARB_buffer_storage), so any
+thread can write into it at any time. The GL thread then only issues
+glTexSubImage2D with an offset into the buffer, which queues a copy on
+the GPU and returns.
+
+The buffer is shared out as a ring: allocate() hands out blocks after
+the last one, wrapping around to the start, and retire() marks a block
+as no longer needed once the copies from it have been issued. update()
+puts a fence behind the retired blocks, and a block is only reused when
+its fence has signaled, so the GPU never reads memory which is written
+again. Blocks are freed in the order they were allocated. When the ring
+is full, allocate() fails and the thread which wanted the memory tries
+again later; the GL thread never waits for the GPU.
+*/
+
+#ifndef _TEXTURE_UPLOADER_H
+#define _TEXTURE_UPLOADER_H
+
+#include "GLIncludes.h"
+#include <mutex>
+#include <deque>
+
+// Room for two 2048x2048 faces with all their mip levels, so one face can be written while the one before it is being copied.
+#define TEXTURE_UPLOAD_RING_SIZE (48 * 1024 * 1024)
+
+// Blocks start at multiples of this, which suits every pixel format and keeps threads off each other's cache lines.
+#define TEXTURE_UPLOAD_ALIGNMENT 256
+
+struct TextureUploader
+{
+	GLuint buffer;
+	unsigned char* mapped;		// The whole buffer, NULL until init() succeeded
+	size_t size;
+
+	TextureUploader();
+
+	// Creates and maps the buffer. Returns false if the driver has no ARB_buffer_storage; the callers then upload from their own memory.
+	bool init(size_t ringSize = TEXTURE_UPLOAD_RING_SIZE);
+	void release();
+	bool ready() const { return mapped != NULL; }
+
+	// Any thread: bytes of the ring to write pixels into, or NULL if there is no room right now.
+	unsigned char* allocate(size_t bytes);
+
+	// Any thread: the block at memory can be reused once the OpenGL commands issued so far have been executed.
+	void retire(unsigned char* memory);
+
+	// The offset to pass to glTexSubImage2D instead of a pointer, while the buffer is bound to GL_PIXEL_UNPACK_BUFFER.
+	const void* offset(const unsigned char* memory) const { return (const void*)(memory - mapped); }
+
+	// GL thread, once per frame: fences the blocks retired since the last call and frees the ones the GPU is done with.
+	void update();
+
+	// Bytes allocated and not freed yet.
+	size_t used();
+
+private:
+	struct Block
+	{
+		size_t begin;
+		size_t end;
+		bool retired;
+		GLsync fence;
+	};
+
+	std::mutex lock;
+	std::deque<Block> blocks;		// In the order they were allocated
+	size_t head;					// Where the next block goes
+
+	bool overlaps(size_t begin, size_t end) const;
+
+	// Not copyable.
+	TextureUploader(const TextureUploader&);
+	TextureUploader& operator=(const TextureUploader&);
+};
+
+#endif //_TEXTURE_UPLOADER_H
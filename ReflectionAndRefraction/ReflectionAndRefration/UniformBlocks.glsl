@@ -0,0 +1,57 @@
+/*
+Title: Reflection and refraction
+File Name: UniformBlocks.glsl
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+The uniform blocks of UniformBuffers.h, declared once for all the
+shaders. There is no #version here: readShader puts this file in after
+the #version line of every shader which asks for it, followed by a #line
+directive so the compiler still counts the lines of the shader itself.
+
+The blocks have to match FrameUniforms and ObjectUniforms in
+UniformBuffers.h member for member. A shader which does not use one of
+them just leaves it inactive.
+*/
+
+// Camera data, written once per frame (FrameUniforms in UniformBuffers.h).
+layout(std140, binding = 0) uniform FrameUniforms
+{
+	mat4 view;
+	mat4 projection;
+	mat4 PV;								// Our PV matrix to implement projection and view for the camera
+	mat4 inversePV;							// From the screen back to world space
+	vec3 camPos;							// Camera position
+	float time;								// Seconds since the start of the program
+};
+
+// Values of the object being drawn (ObjectUniforms in UniformBuffers.h).
+layout(std140, binding = 1) uniform ObjectUniforms
+{
+	mat4 translation;						// This is the transformation matrix. Since we are not rotating the sphere, this basically contains just the translation.
+	vec4 material;							// x: ratio of the indices of refraction, y: reflection weight, z: refraction weight, w: lighting weight
+	vec3 posScale;							// Compact vertex formats store positions relative to the bounding box of the mesh,
+	float normalScale;						// length of the normals before they were encoded as unit vectors,
+	vec3 posOffset;							// the real position is in_position * posScale + posOffset,
+	int normalEncoding;						// 0: in_normal is the normal, 1: octahedral encoded unit normal, 2: quantized unit normal.
+	vec3 center;							// Bounding sphere in world space
+	float radius;
+};
@@ -0,0 +1,113 @@
+/*
+Title: Reflection and refraction
+File Name: UniformBuffers.cpp
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+Per frame and per object uniform buffers, see UniformBuffers.h.
+*/
+
+#include "UniformBuffers.h"
+
+void setVertexLayout(ObjectUniforms& object, const VertexLayout& layout)
+{
+	object.posScale = layout.posScale;
+	object.posOffset = layout.posOffset;
+	object.normalScale = layout.normalScale;
+	object.normalEncoding = layout.normalEncoding == NORMAL_FLOAT ? 0 : layout.normalEncoding == NORMAL_INT_2_10_10_10 ? 2 : 1;
+}
+
+UniformBuffers::UniformBuffers()
+{
+	frameBuffer = 0;
+	objectBuffer = 0;
+	objectStride = sizeof(ObjectUniforms);
+	objectCapacity = 0;
+	bytesUploaded = 0;
+}
+
+void UniformBuffers::init()
+{
+	GLint alignment = 256;
+	glGetIntegerv(GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, &alignment);
+	objectStride = (sizeof(ObjectUniforms) + alignment - 1) / alignment * alignment;
+
+	glGenBuffers(1, &frameBuffer);
+	glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+	glBufferData(GL_UNIFORM_BUFFER, sizeof(FrameUniforms), NULL, GL_DYNAMIC_DRAW);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	glBindBufferBase(GL_UNIFORM_BUFFER, FRAME_UNIFORM_BINDING, frameBuffer);
+
+	glGenBuffers(1, &objectBuffer);
+}
+
+void UniformBuffers::setFrame(const FrameUniforms& frame)
+{
+	glBindBuffer(GL_UNIFORM_BUFFER, frameBuffer);
+	glBufferSubData(GL_UNIFORM_BUFFER, 0, sizeof(FrameUniforms), &frame);
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	bytesUploaded = sizeof(FrameUniforms);
+}
+
+void UniformBuffers::beginObjects(int count)
+{
+	objectData.assign(count * objectStride, 0);
+}
+
+ObjectUniforms& UniformBuffers::object(int index)
+{
+	return *(ObjectUniforms*)&objectData[index * objectStride];
+}
+
+void UniformBuffers::uploadObjects()
+{
+	if (objectData.empty())
+		return;
+
+	int count = (int)(objectData.size() / objectStride);
+	glBindBuffer(GL_UNIFORM_BUFFER, objectBuffer);
+	if (count > objectCapacity)
+	{
+		objectCapacity = count;
+		glBufferData(GL_UNIFORM_BUFFER, objectData.size(), &objectData[0], GL_STREAM_DRAW);
+	}
+	else
+	{
+		glBufferData(GL_UNIFORM_BUFFER, objectCapacity * objectStride, NULL, GL_STREAM_DRAW);
+		glBufferSubData(GL_UNIFORM_BUFFER, 0, objectData.size(), &objectData[0]);
+	}
+	glBindBuffer(GL_UNIFORM_BUFFER, 0);
+	bytesUploaded += (int)objectData.size();
+}
+
+void UniformBuffers::bindObject(int index)
+{
+	glBindBufferRange(GL_UNIFORM_BUFFER, OBJECT_UNIFORM_BINDING, objectBuffer, objectOffset(index), sizeof(ObjectUniforms));
+}
+
+void UniformBuffers::release()
+{
+	glDeleteBuffers(1, &frameBuffer);
+	glDeleteBuffers(1, &objectBuffer);
+	frameBuffer = 0;
+	objectBuffer = 0;
+	objectCapacity = 0;
+}
@@ -0,0 +1,118 @@
+/*
+Title: Reflection and refraction
+File Name: UniformBuffers.h
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+Uniform buffers shared by all the shader programs.
+
+FrameUniforms holds what every program needs from the camera: view,
+projection, PV and its inverse, camera position and time. It is written once per frame
+and stays bound at FRAME_UNIFORM_BINDING for every program, the skybox
+included.
+
+ObjectUniforms holds what changes from draw to draw: the translation,
+the material, how the vertices of the mesh are stored and the bounding
+sphere. The values of all the draws of a frame are written into one
+buffer with a single upload, each at a multiple of
+GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT, and every draw only binds its range
+at OBJECT_UNIFORM_BINDING with glBindBufferRange. The number of uploads
+depends on the number of frames, not on the number of draws.
+
+The std140 blocks are declared once, in UniformBlocks.glsl, which
+readShader puts into every shader which uses them. The structs have to
+match those blocks, member for member.
+std140 puts a vec3 and a following float into the same 16 bytes, which
+is what glm::vec3 followed by a float does too.
+*/
+
+#ifndef _UNIFORM_BUFFERS_H
+#define _UNIFORM_BUFFERS_H
+
+#include "GLIncludes.h"
+#include "Mesh.h"
+
+#define FRAME_UNIFORM_BINDING 0
+#define OBJECT_UNIFORM_BINDING 1
+
+// layout(std140, binding = 0) uniform FrameUniforms in the shaders.
+struct FrameUniforms
+{
+	glm::mat4 view;
+	glm::mat4 projection;
+	glm::mat4 PV;
+	glm::mat4 inversePV;			// For the skybox, which turns every pixel back into a view ray
+	glm::vec3 camPos;
+	float time;						// Seconds since the start of the program
+};
+
+// layout(std140, binding = 1) uniform ObjectUniforms in the shaders.
+struct ObjectUniforms
+{
+	glm::mat4 translation;			// Object to world transformation
+	glm::vec4 material;				// See SphereInstance::material
+	glm::vec3 posScale;				// See VertexLayout
+	float normalScale;
+	glm::vec3 posOffset;
+	GLint normalEncoding;			// 0: float normals, 1: octahedral, 2: quantized xyz
+	glm::vec3 center;				// Bounding sphere in world space
+	float radius;
+};
+
+// Copies posScale, posOffset and normalScale of the layout, and turns its normal encoding into the number the shaders use.
+void setVertexLayout(ObjectUniforms& object, const VertexLayout& layout);
+
+struct UniformBuffers
+{
+	GLuint frameBuffer;
+	GLuint objectBuffer;
+	GLsizeiptr objectStride;		// sizeof(ObjectUniforms) rounded up to the offset alignment
+	int objectCapacity;				// Objects the buffer has room for
+	int bytesUploaded;				// Since the last setFrame, for statistics
+
+	UniformBuffers();
+
+	// Creates the buffers and binds the frame buffer to its binding point.
+	void init();
+
+	// Writes the frame uniforms. Starts a new frame.
+	void setFrame(const FrameUniforms& frame);
+
+	// Makes room for count objects in the CPU side copy, to be filled in with object() and written with uploadObjects().
+	void beginObjects(int count);
+	// Different objects can be filled in on different threads at the same time.
+	ObjectUniforms& object(int index);
+	// Where the uniforms of the object are in objectBuffer.
+	GLintptr objectOffset(int index) const { return index * objectStride; }
+
+	// One upload for all of them. The buffer is orphaned first, so the GPU can still read the values of the previous frame.
+	void uploadObjects();
+
+	// Binds the uniforms of one object to OBJECT_UNIFORM_BINDING.
+	void bindObject(int index);
+
+	void release();
+
+private:
+	std::vector<unsigned char> objectData;
+};
+
+#endif //_UNIFORM_BUFFERS_H
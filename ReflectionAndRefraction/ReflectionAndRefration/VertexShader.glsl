@@ -49,20 +49,27 @@ OpenGL 4 shading language cookbook by David Wolff
 #version 430 core // Identifies the version of the shader, this line must be on a separate line from the rest of the shader code
  
 layout(location = 0) in vec3 in_position;	// Get in a vec3 for position
-layout(location = 1) in vec3 in_normal;
+layout(location = 1) in vec3 in_normal;		// Either a vec3, or an octahedral encoded normal in xy (see Mesh.h)
 
 out vec4 color;								// This variable carries the light component on that pixel. 
 out vec3 reflectDir;						// this variable hold the reflected vector
 out vec3 refractDir;						// This variable hold the refracted vector
 
-uniform mat4 PV;							// Our uniform PV matrix to implement projection and view for the camera
-uniform mat4 translation;					// This is the transformation matrix. Since we are not rotating the sphere, this basically contains just the translation.
-uniform vec3 camPos;						// camera position for specular lighting.
+// FrameUniforms and ObjectUniforms come from UniformBlocks.glsl, which readShader puts in after #version.
 
 vec3 LightPos;								// Light properties.
 vec3 DiffuseLight;
 vec3 SpecularLight;
 
+//Turns a point of the [-1, 1] square back into a unit vector by unfolding the octahedron.
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+	if (n.z < 0.0f)
+		n.xy = (1.0f - abs(n.yx)) * vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+	return normalize(n);
+}
+
 //This function returns the component of the light reflected as diffuse texture.
 vec3 diffuseComponent(vec3 position, vec3 normal)
 {
@@ -94,19 +101,27 @@ void main(void)
 	DiffuseLight = vec3 (0.5f,0.5f,0.5f);
 	SpecularLight = vec3(0.74f,0.74f,0.74f);
 
+	//Undo the vertex compression first.
+	vec3 position = in_position * posScale + posOffset;
+	vec3 objectNormal = in_normal;
+	if (normalEncoding == 1)
+		objectNormal = octDecode(in_normal.xy) * normalScale;
+	else if (normalEncoding == 2)
+		objectNormal = normalize(in_normal) * normalScale;
+
 	//Since the object is moving in the world space, we need to apply those transformation to the position and normals of the vertex.
-	vec3 pos = (vec4(in_position,1.0f) * translation).xyz;
-	vec3 normal = (vec4(in_normal, 1.0f) * translation).xyz;
+	vec3 pos = (vec4(position,1.0f) * translation).xyz;
+	vec3 normal = (vec4(objectNormal, 1.0f) * translation).xyz;
 	vec3 viewDirection = normalize(camPos - pos);
 	
 	//Reflect the vector view direction with respect to normal.
 	reflectDir = reflect(-viewDirection, normal);
 	//Refract the vector view Direction, with respect to normal with the ration of the indices of refraction.
 	// refract(incidentVector, normalVector, ratio)
-	refractDir = refract(-viewDirection, normal, 0.5f);
+	refractDir = refract(-viewDirection, normal, material.x);
 	
 	//Calculate the lighting calculations
 	color = diffuseAndSpecular(pos, normalize(normal));
 	//apply the transformation and multiply with the view and prespective matrix to get the final positio nof the vertex.
-	gl_Position = PV * translation * vec4(in_position, 1.0); //w is 1.0, also notice cast to a vec4
+	gl_Position = PV * translation * vec4(position, 1.0); //w is 1.0, also notice cast to a vec4
 }
\ No newline at end of file
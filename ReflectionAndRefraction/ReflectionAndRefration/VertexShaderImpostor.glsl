@@ -0,0 +1,57 @@
+/*
+Title: Reflection and refraction
+File Name: VertexShaderImpostor.glsl
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+Vertex shader of the impostor path. There is no vertex buffer: the four
+corners of a quad are made from gl_VertexID. The quad faces the camera and
+sits where the sphere is closest to the camera, and it is just large
+enough to cover the outline of the sphere seen from the camera. The
+fragment shader then finds the sphere inside it with a ray.
+*/
+
+#version 430 core // Identifies the version of the shader, this line must be on a separate line from the rest of the shader code
+
+out vec3 worldPos;							// Point of the quad, the fragment shader casts a ray from the camera through it.
+
+// FrameUniforms and ObjectUniforms come from UniformBlocks.glsl, which readShader puts in after #version.
+
+void main(void)
+{
+	// Triangle strip order: (-1,-1), (1,-1), (-1,1), (1,1)
+	vec2 corner = vec2(float(gl_VertexID & 1), float(gl_VertexID >> 1)) * 2.0f - 1.0f;
+
+	// Build a basis looking from the camera to the center of the sphere.
+	vec3 toCenter = center - camPos;
+	float d = length(toCenter);
+	vec3 forward = toCenter / d;
+	vec3 right = normalize(cross(forward, abs(forward.y) < 0.99f ? vec3(0.0f, 1.0f, 0.0f) : vec3(1.0f, 0.0f, 0.0f)));
+	vec3 up = cross(right, forward);
+
+	// Seen from the camera, the sphere fills a cone of half angle asin(radius / d). The quad is placed where the sphere starts,
+	// at d - radius, and the cone is (d - radius) * tan(asin(radius / d)) wide there.
+	float planeDistance = d - radius;
+	float halfSize = planeDistance * radius / sqrt(d * d - radius * radius);
+
+	worldPos = camPos + forward * planeDistance + (right * corner.x + up * corner.y) * halfSize;
+	gl_Position = PV * vec4(worldPos, 1.0f);
+}
@@ -0,0 +1,97 @@
+/*
+Title: Reflection and refraction
+File Name: VertexShaderInstanced.glsl
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+Vertex shader for drawing many spheres with a single instanced draw call.
+Every instance has its own model matrix and material (in_model and
+in_material, see SphereInstance in Mesh.h), read from an instanced
+vertex buffer. The vertices are decoded like in VertexShader.glsl.
+
+Unlike VertexShader.glsl, the lighting, reflection and refraction use the
+world space position and a unit normal, since the instances are not at
+the origin.
+*/
+
+#version 430 core // Identifies the version of the shader, this line must be on a separate line from the rest of the shader code
+
+layout(location = 0) in vec3 in_position;
+layout(location = 1) in vec3 in_normal;		// Either a vec3, or an octahedral encoded normal in xy (see Mesh.h)
+layout(location = 2) in mat4 in_model;		// Per instance, takes locations 2 to 5
+layout(location = 6) in vec4 in_material;	// Per instance: ratio of the indices of refraction, reflection, refraction and lighting weights
+
+out vec4 color;								// This variable carries the light component on that pixel.
+out vec3 reflectDir;						// this variable hold the reflected vector
+out vec3 refractDir;						// This variable hold the refracted vector
+flat out vec3 weights;						// Reflection, refraction and lighting weights for the fragment shader
+
+// FrameUniforms and ObjectUniforms come from UniformBlocks.glsl, which readShader puts in after #version.
+
+vec3 LightPos;								// Light properties.
+vec3 DiffuseLight;
+vec3 SpecularLight;
+
+vec3 octDecode(vec2 e)
+{
+	vec3 n = vec3(e, 1.0f - abs(e.x) - abs(e.y));
+	if (n.z < 0.0f)
+		n.xy = (1.0f - abs(n.yx)) * vec2(n.x >= 0.0f ? 1.0f : -1.0f, n.y >= 0.0f ? 1.0f : -1.0f);
+	return normalize(n);
+}
+
+vec3 diffuseComponent(vec3 position, vec3 normal)
+{
+	vec3 s = normalize(LightPos - position);
+
+	return DiffuseLight * max(dot(s, normal),0.0f);
+}
+
+vec3 specularComponent(vec3 position, vec3 normal)
+{
+	vec3 s = normalize(LightPos - position);
+	vec3 r = (2 * dot(s,normal) * normal) - s;
+	vec3 v = normalize(camPos - position);
+
+	return SpecularLight * max(pow(dot(v,r),3),0.0f);
+}
+
+void main(void)
+{
+	LightPos = vec3(3.0f, 3.0f,0.0f);
+	DiffuseLight = vec3 (0.5f,0.5f,0.5f);
+	SpecularLight = vec3(0.74f,0.74f,0.74f);
+
+	vec3 position = in_position * posScale + posOffset;
+	vec3 objectNormal = (normalEncoding == 1) ? octDecode(in_normal.xy) : in_normal;
+
+	// The instances are only translated and uniformly scaled, so the upper 3x3 of the model matrix works for the normal too.
+	vec4 worldPos = in_model * vec4(position, 1.0f);
+	vec3 normal = normalize(mat3(in_model) * objectNormal);
+	vec3 viewDirection = normalize(camPos - worldPos.xyz);
+
+	reflectDir = reflect(-viewDirection, normal);
+	refractDir = refract(-viewDirection, normal, in_material.x);
+	weights = in_material.yzw;
+
+	color = vec4(diffuseComponent(worldPos.xyz, normal) + specularComponent(worldPos.xyz, normal), 1.0f);
+	gl_Position = PV * worldPos;
+}
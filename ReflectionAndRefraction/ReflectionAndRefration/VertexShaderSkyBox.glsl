@@ -49,17 +49,16 @@ OpenGL 4 shading language cookbook by David Wolff
 
 #version 430 core // Identifies the version of the shader, this line must be on a separate line from the rest of the shader code
  
-layout(location = 0) in vec3 in_position;	// Get in a vec3 for position
-layout(location = 1) in vec3 in_normal;		//This is nor used in this shader. But since the vertex has an attribute called normal we just make it to avoid errors.
-//During setting up the vertexattribs, and setting the buffer data, if we set-up the offset properly,this variable does not need to be here. 
-
-out vec3 texCoord; // Our vec4 color variable containing r, g, b, a
+// There are no vertex attributes: the skybox is one triangle made from gl_VertexID.
+out vec2 screenPosition;	// Normalized device coordinates, -1 to 1 over the screen
 
 void main(void)
 {
-	//use the posiiton as the texture coorinates for the skybox
-	texCoord = normalize(in_position);
+	//Vertices 0, 1 and 2 are at (-1, -1), (3, -1) and (-1, 3): one triangle which covers the whole screen, the rest of it is clipped away.
+	//Unlike two triangles, it has no diagonal where pixels get shaded twice.
+	screenPosition = vec2((gl_VertexID & 1) * 4.0 - 1.0, (gl_VertexID >> 1) * 4.0 - 1.0);
 
-	//Call the funciton using the subroutine uniform which is set in the openGL application.
-	gl_Position = vec4(in_position, 1.0); //w is 1.0, also notice cast to a vec4
+	//z = w puts the skybox at the far plane (depth 1 after the division by w), behind everything else. It is drawn last with GL_LEQUAL,
+	//so the pixels the objects already cover fail the depth test before the fragment shader runs.
+	gl_Position = vec4(screenPosition, 1.0, 1.0);
 }
\ No newline at end of file
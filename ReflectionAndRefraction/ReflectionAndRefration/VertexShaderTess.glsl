@@ -0,0 +1,41 @@
+/*
+Title: Reflection and refraction
+File Name: VertexShaderTess.glsl
+Copyright  2015
+Original authors: Srinivasan T
+Written under the supervision of David I. Schwartz, Ph.D., and
+supported by a professional development seed grant from the B. Thomas
+Golisano College of Computing & Information Sciences
+(https://www.rit.edu/gccis) at the Rochester Institute of Technology.
+
+This program is free software: you can redistribute it and/or modify
+it under the terms of the GNU General Public License as published by
+the Free Software Foundation, either version 3 of the License, or (at
+your option) any later version.
+
+This program is distributed in the hope that it will be useful, but
+WITHOUT ANY WARRANTY; without even the implied warranty of
+MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+General Public License for more details.
+
+You should have received a copy of the GNU General Public License
+along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+Description:
+Vertex shader of the hardware tessellation path. The sphere is uploaded as
+a coarse icosahedron, so this shader only passes the corners on to the
+tessellation control shader, which decides how finely to split each
+triangle.
+*/
+
+#version 430 core // Identifies the version of the shader, this line must be on a separate line from the rest of the shader code
+
+layout(location = 0) in vec3 in_position;	// Corner of the coarse base mesh
+layout(location = 1) in vec3 in_normal;		// Not used, the normal is recomputed after tessellation.
+
+out vec3 vPosition;
+
+void main(void)
+{
+	vPosition = in_position;
+}
@@ -40,6 +40,7 @@ to a texture using a frame buffer. then sample that texture using the refracted
 ray as texture coordinates.
 
 Use the mouse to move the sphere around in xy plane.
+Press E to switch to the other skybox.
 Comment out the reflective or refractive component in the fragment shader to see the
 effects more vividly.
 
@@ -55,6 +56,23 @@ OpenGL 4 shading language cookbook by David Wolff
 
 
 #include "GLIncludes.h"
+#include "Mesh.h"
+#include "SphereGenerator.h"
+#include "MeshOptimizer.h"
+#include "MeshCache.h"
+#include "MeshImporter.h"
+#include "GpuCulling.h"
+#include "Culling.h"
+#include "Scene.h"
+#include "DrawList.h"
+#include "GLStateCache.h"
+#include "UniformBuffers.h"
+#include "CommandList.h"
+#include "JobSystem.h"
+#include "CubeMapLoader.h"
+#include "CubeMapStream.h"
+#include "TextureUploader.h"
+#include "Benchmarks.h"
 
 // Global data members
 #pragma region Base_data
@@ -63,6 +81,8 @@ OpenGL 4 shading language cookbook by David Wolff
 // This program will run on your GPU.
 GLuint program;
 GLuint programSB;
+GLuint programTess;
+GLuint programImpostor;
 
 //These are your references to your actual compiled shaders
 GLuint vertex_shader;
@@ -72,274 +92,334 @@ GLuint fragment_shader;
 GLuint vertex_shaderSB;
 GLuint fragment_shaderSB;
 
-GLuint camPosUniform;
+//Shaders of the hardware tessellation path. It uses the same fragment shader as the CPU built sphere.
+GLuint vertex_shaderTess;
+GLuint tess_control_shader;
+GLuint tess_evaluation_shader;
+
+//Shaders of the impostor path.
+GLuint vertex_shaderImpostor;
+GLuint fragment_shaderImpostor;
 
 //A reference to the texture stored in the GPU
 GLuint skybox;
-// This is a reference to your uniform MVP matrix in your vertex shader
-GLuint uniPV;
-GLuint uniTranslation;
 
+//The skybox streams in over the first frames, from one grey pixel per face up to the full size (see CubeMapStream.h), so the first frame
+//does not wait for the faces to be decoded. --no-stream loads the whole cube map in setup() instead.
+//E switches to the next environment: it streams in while the current one stays on screen, and replaces it once it is complete.
+//With ARB_buffer_storage the faces go through the upload ring (see TextureUploader.h), so the GL thread never copies pixels.
+#define ENVIRONMENT_COUNT 2
+const char* environmentFaces[ENVIRONMENT_COUNT][CUBE_MAP_FACES] = {
+	{ "posx.jpg", "negx.jpg", "posy.jpg", "negy.jpg", "posz.jpg", "negz.jpg" },
+	{ "skybox1/posx.jpg", "skybox1/negx.jpg", "skybox1/posy.jpg", "skybox1/negy.jpg", "skybox1/posz.jpg", "skybox1/negz.jpg" } };
+TextureUploader textureUploader;
+CubeMapStream environments[ENVIRONMENT_COUNT];
+int currentEnvironment = 0;
+int loadingEnvironment = -1;			//The environment streaming in to replace the current one, -1 for none
+bool switchKeyDown = false;
+bool streamSkybox = true;
+
+//The skybox is sampled trilinearly from its mip chain, and with up to this many samples along the direction it is stretched in
+//(--anisotropy, 1 is off).
+float cubeMapAnisotropy = 1.0f;
+
+//The camera and the values of every object are in uniform buffers, which all the programs share (see UniformBuffers.h).
+//Only the tessellation program has a uniform of its own.
+UniformBuffers uniformBuffers;
+GLuint uniTessDetail;
+
+//The bead field: many small spheres drawn with one instanced draw call (see SphereInstance in Mesh.h).
+GLuint programInstanced;
+GLuint vertex_shaderInstanced;
+GLuint fragment_shaderInstanced;
+
+//The compute shader which culls the beads and picks their level of detail on the GPU, see GpuCulling.h.
+GLuint programCull;
+GLuint compute_shaderCull;
+
+//The skybox triangle and the impostor quad are made in the vertex shader from gl_VertexID, so their VAO has no buffers at all.
+GLuint emptyVAO;
+
+glm::vec3 cameraPosition(0.0f, 0.0f, 2.0f);
+glm::mat4 view;
+glm::mat4 projection;
 glm::mat4 PV;
 
+//Every program, VAO, texture and depth state change of the frame goes through glState, which drops the ones that change nothing.
+GLStateCache glState;
+
+//The frame is built by jobs on all the threads (see JobSystem.h): update() starts updating the world matrices, renderScene() culls the
+//objects, records their draws and sorts them, each step waiting for the one before. --threads sets the number of threads.
+JobSystem jobs;
+int jobThreads = std::max(1, (int)std::thread::hardware_concurrency());
+Job* updateJob = NULL;
+
+//How many objects one job updates, culls or records. Smaller parts spread better over the threads, larger ones cost less to schedule.
+#define OBJECTS_PER_JOB 1024
+
+//Which generator builds the sphere, and how finely. sphereDivisions is the number of rings and segments of the UV sphere,
+//icosphereSubdivisions is the number of times the icosahedron is subdivided.
+//With sphereLOD, a chain of levels of detail is built instead and the level is picked every frame from the size of the sphere on screen.
+SphereMode sphereMode = SPHERE_UV;
+bool sphereLOD = true;
+int sphereDivisions = 40;
+int icosphereSubdivisions = 4;
+
+//The level of detail is chosen so that the sphere is never more than this many pixels away from a perfect sphere.
+float maxPixelError = 1.0f;
+
+//How the sphere is drawn:
+//	PATH_MESH			a mesh built on the CPU (see sphereMode and sphereLOD)
+//	PATH_TESSELLATION	only an icosahedron is uploaded and the tessellation shaders refine it on the GPU every frame
+//	PATH_IMPOSTOR		a single quad, the fragment shader intersects each pixel's view ray with the exact sphere
+enum SpherePath
+{
+	PATH_MESH,
+	PATH_TESSELLATION,
+	PATH_IMPOSTOR
+};
+SpherePath spherePath = PATH_MESH;
+
+//tessPixelsPerSegment is the length, on screen, the tessellator aims for when splitting an edge.
+float tessPixelsPerSegment = 8.0f;
+
+//How the mesh path stores its vertices. 16 bit positions and octahedral normals take 12 bytes per vertex instead of 24.
+PositionEncoding spherePositions = POSITION_SNORM16;
+NormalEncoding sphereNormals = NORMAL_OCT16;
+
+//Load the sphere mesh from the binary cache when it is there, and write it there when it is not.
+bool useMeshCache = true;
+
+//Number of spheres in the scene, set with --spheres. The first one follows the mouse.
+int sphereCount = 1;
+
+//An OBJ or PLY file to draw instead of the sphere. It is scaled to the size of the sphere.
+std::string modelPath;
+
 // Reference to the window object being created by GLFW.
 GLFWwindow* window;
 #pragma endregion Base_data								  
 
 
-struct stuff_for_drawing{
-
-	GLuint vao;
-
-	//This stores the address the buffer/memory in the GPU. It acts as a handle to access the buffer memory in GPU.
-	GLuint vbo;
-
-	//This will be used to tell the GPU, how many vertices will be needed to draw during drawcall.
-	int numberOfVertices;
-
-	//This function gets the number of vertices and all the vertex values and stores them in the buffer.
-	void initBuffer(int numVertices, VertexFormat* vertices, GLuint programID)
-	{
-		numberOfVertices = numVertices;
-
-		glGenVertexArrays(1, &vao);
-		// This generates buffer object names
-		// The first parameter is the number of buffer objects, and the second parameter is a pointer to an array of buffer objects (yes, before this call, vbo was an empty variable)
-		glGenBuffers(1, &vbo);
-
-		glBindVertexArray(vao);
-		//// Binds a named buffer object to the specified buffer binding point. Give it a target (GL_ARRAY_BUFFER) to determine where to bind the buffer.
-		//// There are several different target parameters, GL_ARRAY_BUFFER is for vertex attributes, feel free to Google the others to find out what else there is.
-		//// The second paramter is the buffer object reference. If no buffer object with the given name exists, it will create one.
-		//// Buffer object names are unsigned integers (like vbo). Zero is a reserved value, and there is no default buffer for each target (targets, like GL_ARRAY_BUFFER).
-		//// Passing in zero as the buffer name (second parameter) will result in unbinding any buffer bound to that target, and frees up the memory.
-		glBindBuffer(GL_ARRAY_BUFFER, vbo);
-
-		//// Creates and initializes a buffer object's data.
-		//// First parameter is the target, second parameter is the size of the buffer, third parameter is a pointer to the data that will copied into the buffer, and fourth parameter is the 
-		//// expected usage pattern of the data. Possible usage patterns: GL_STREAM_DRAW, GL_STREAM_READ, GL_STREAM_COPY, GL_STATIC_DRAW, GL_STATIC_READ, GL_STATIC_COPY, GL_DYNAMIC_DRAW, 
-		//// GL_DYNAMIC_READ, or GL_DYNAMIC_COPY
-		//// Stream means that the data will be modified once, and used only a few times at most. Static means that the data will be modified once, and used a lot. Dynamic means that the data 
-		//// will be modified repeatedly, and used a lot. Draw means that the data is modified by the application, and used as a source for GL drawing. Read means the data is modified by 
-		//// reading data from GL, and used to return that data when queried by the application. Copy means that the data is modified by reading from the GL, and used as a source for drawing.
-		glBufferData(GL_ARRAY_BUFFER, sizeof(VertexFormat) * numVertices, vertices, GL_STATIC_DRAW);
-
-		//// By default, all client-side capabilities are disabled, including all generic vertex attribute arrays.
-		//// When enabled, the values in a generic vertex attribute array will be accessed and used for rendering when calls are made to vertex array commands (like glDrawArrays/glDrawElements)
-		//// A GL_INVALID_VALUE will be generated if the index parameter is greater than or equal to GL_MAX_VERTEX_ATTRIBS
-		glEnableVertexAttribArray(glGetAttribLocation(program, "in_position"));
-
-		//// Defines an array of generic vertex attribute data. Takes an index, a size specifying the number of components (in this case, floats)(has a max of 4)
-		//// The third parameter, type, can be GL_BYTE, GL_UNSIGNED_BYTE, GL_SHORT, GL_UNSIGNED_SHORT, GL_FIXED, or GL_FLOAT
-		//// The fourth parameter specifies whether to normalize fixed-point data values, the fifth parameter is the stride which is the offset (in bytes) between generic vertex attributes
-		//// The fifth parameter is a pointer to the first component of the first generic vertex attribute in the array. If a named buffer object is bound to GL_ARRAY_BUFFER (and it is, in this case) 
-		//// then the pointer parameter is treated as a byte offset into the buffer object's data.
-		glVertexAttribPointer(glGetAttribLocation(program,"in_position"), 3, GL_FLOAT, GL_FALSE, sizeof(VertexFormat), (void*) (0 * sizeof(float)));
-		//// You'll note sizeof(VertexFormat) is our stride, because each vertex contains data that adds up to that size.
-		//// You'll also notice we offset this parameter by 16 bytes, this is because the vec3 position attribute is after the vec4 color attribute. A vec4 has 4 floats, each being 4 bytes 
-		//// so we offset by 4*4=16 to make sure that our first attribute is actually the position. The reason we put position after color in the struct has to do with padding.
-		//// For more info on padding, Google it.
-
-		glEnableVertexAttribArray(glGetAttribLocation(program, "in_normal"));
-		glVertexAttribPointer(glGetAttribLocation(program, "in_normal"), 3, GL_FLOAT, GL_FALSE, sizeof(VertexFormat), (void*)(3 * sizeof(float)));
-
-		//glBindBuffer(GL_ARRAY_BUFFER, 0);
-		glBindVertexArray(0);
-	}
-};
 
-//Since the skybox does not need any transformations as of now (since the camera is stationary). Only translations which affect the camera need to be applied onto the skybox.
-// For more info, refer to the skybox example.
-stuff_for_drawing skyBox;
+//Number of beads in the bead field, set with --instances. They share one unit sphere mesh; the model matrix of every instance scales it.
+int beadCount = 0;
+stuff_for_drawing beadMesh;
+int beadLOD;						//The level of detail drawn in the last frame.
+glm::vec3 nearestBeadCenter;		//The bead which looks the largest from the camera, which decides the level of detail of all of them.
+float nearestBeadRadius;
 
-struct sphere
+//With gpuCulling, the beads are culled and sorted into levels of detail by a compute shader and drawn with one multi-draw indirect call.
+//Without it, they are culled on the CPU against the bounding spheres in beadBounds, and the visible ones are all drawn at the level of detail of the nearest one.
+bool gpuCulling = true;
+GpuCulling beadCulling;
+std::vector<SphereInstance> beadInstances;
+SphereBounds beadBounds;
+std::vector<GLuint> visibleBeads;					//Indices of the beads which passed the culling in the last frame
+std::vector<SphereInstance> visibleBeadInstances;	//and their instances, in the order they are uploaded.
+
+//The objects of the scene and their meshes, see Scene.h. sphereObject is the sphere which follows the mouse.
+Scene scene;
+ObjectHandle sphereObject;
+
+//The name of the sphere in the mesh cache. It has every parameter the mesh is generated from, so changing one of them builds a new mesh.
+std::string sphereCacheName(float radius, bool lod)
 {
-	glm::mat4 Translation;
-	glm::vec3 origin;
-	GLuint lightingtype;			//This will hold the location of the function we want for the type of lighting.
-	stuff_for_drawing base;
-}sphere1;
+	std::string name = std::string("sphere_") + (sphereMode == SPHERE_ICOSPHERE ? "ico" : "uv");
+	if (lod)
+		name += "_lod";
+	else
+		name += "_" + std::to_string(sphereMode == SPHERE_ICOSPHERE ? icosphereSubdivisions : sphereDivisions);
+	name += "_r" + std::to_string((int)(radius * 10000.0f + 0.5f));
+	name += "_p" + std::to_string((int)spherePositions) + "_n" + std::to_string((int)sphereNormals);
+	return name;
+}
+
+//Builds the sphere mesh (the whole chain of levels of detail if lod is set) and uploads it into drawable.
+//The mesh is built once and written to MESH_CACHE_DIRECTORY. Later runs map the cache file and upload it as it is, see MeshCache.h.
+void buildSphereMesh(stuff_for_drawing& drawable, float radius, bool lod, GLuint programID)
+{
+	double start = glfwGetTime();
+	std::string cacheName = sphereCacheName(radius, lod);
+	bool cached = useMeshCache && uploadCachedMesh(cacheName, drawable, programID);
+	if (!cached)
+	{
+		std::vector<MeshData> levels;
+		std::vector<float> errors;
+		if (lod)
+		{
+			//All the levels go into the same buffers, renderScene() picks one every frame.
+			generateSphereLODs(sphereMode, radius, levels, errors);
+		}
+		else
+		{
+			levels.resize(1);
+			errors.push_back(0.0f);
+			generateSphere(sphereMode, radius, sphereMode == SPHERE_ICOSPHERE ? icosphereSubdivisions : sphereDivisions, levels[0]);
+		}
+		//Reorder every level for the vertex cache before it is uploaded, see MeshOptimizer.h.
+		for (size_t i = 0; i < levels.size(); i++)
+			optimizeMesh(levels[i], false, false);
+
+		PackedMesh packed;
+		packMesh(levels, errors, spherePositions, sphereNormals, packed);
+		drawable.initBuffer(packed.view(), programID);
+		if (useMeshCache)
+			writeMeshCache(cacheName, packed.view());
+	}
+	std::cout << "\n Sphere " << (cached ? "loaded from " + meshCachePath(cacheName) : std::string("generated")) << " in " << (glfwGetTime() - start) * 1000.0 << " ms";
+}
 
 void setupSphere()
 {
 	//Set up sphere 
-	std::vector<VertexFormat> vertexSet;
-	
-	vertexSet.clear();
+	MeshData sphereMesh;
 
 	float radius = 0.25f;
-	float DIVISIONS = 40;
-
-	float pitch, yaw;
-	yaw = 0.0f;
-	pitch = 0.0f;
-	int i, j;
-	float pitchDelta = 360 / DIVISIONS;
-	float yawDelta = 360 / DIVISIONS;
+	MeshHandle mesh = NO_MESH;
 
-	VertexFormat p1, p2, p3, p4;
-
-	for (i = 0; i < DIVISIONS; i++)
+	//The sphere is either a UV sphere built from sin/cos tables or a subdivided icosahedron, see SphereGenerator.cpp.
+	//The mode and tessellation can be changed with --divisions, --icosphere or --lod on the command line.
+	if (spherePath == PATH_IMPOSTOR)
+	{
+		//Nothing to upload, the sphere is computed in the fragment shader.
+	}
+	else if (spherePath == PATH_TESSELLATION)
 	{
-		for (j = 0; j < DIVISIONS; j++)
+		//Only the 20 triangles of the icosahedron are uploaded. Each of them is a patch for the tessellation shaders.
+		mesh = scene.addMesh();
+		generateIcosphere(radius, 0, sphereMesh);
+		scene.drawables[mesh].initBuffer(sphereMesh, programTess);
+	}
+	else if (!modelPath.empty())
+	{
+		//The model is read on all the hardware threads, see MeshImporter.h.
+		std::vector<MeshData> levels(1);
+		std::vector<float> errors(1, 0.0f);
+		ImportStats stats;
+		if (importMesh(modelPath, levels[0], 0, &stats))
 		{
-
-			//Since the shape is a sphere, the surface normal would be the vector joining the surface and the center.
-			//when the center is at the origin, the normal will be equal to the position vector of the point.
-			p1.position.x = radius * sin((pitch)* PI / 180.0) * cos((yaw)* PI / 180.0);
-			p1.position.y = radius * sin((pitch)* PI / 180.0) * sin((yaw)* PI / 180.0);;
-			p1.position.z = radius * cos((pitch)* PI / 180.0);
-			p1.normal = p1.position;
-			
-			p2.position.x = radius * sin((pitch)* PI / 180.0) * cos((yaw + yawDelta)* PI / 180.0);
-			p2.position.y = radius * sin((pitch)* PI / 180.0) * sin((yaw + yawDelta)* PI / 180.0);;
-			p2.position.z = radius * cos((pitch)* PI / 180.0);
-			p2.normal = p2.position;
-			
-			p3.position.x = radius * sin((pitch + pitchDelta)* PI / 180.0) * cos((yaw + yawDelta)* PI / 180.0);
-			p3.position.y = radius * sin((pitch + pitchDelta)* PI / 180.0) * sin((yaw + yawDelta)* PI / 180.0);;
-			p3.position.z = radius * cos((pitch + pitchDelta)* PI / 180.0);
-			p3.normal = p3.position;
-			
-			p4.position.x = radius * sin((pitch + pitchDelta)* PI / 180.0) * cos((yaw)* PI / 180.0);
-			p4.position.y = radius * sin((pitch + pitchDelta)* PI / 180.0) * sin((yaw)* PI / 180.0);;
-			p4.position.z = radius * cos((pitch + pitchDelta)* PI / 180.0);
-			p4.normal = p4.position;
-			
-			vertexSet.push_back(p1);
-			vertexSet.push_back(p2);
-			vertexSet.push_back(p3);
-			vertexSet.push_back(p1);
-			vertexSet.push_back(p3);
-			vertexSet.push_back(p4);
-
-			yaw = yaw + yawDelta;
+			std::cout << "\n Imported " << modelPath << ": " << levels[0].indices.size() / 3 << " triangles in " << stats.seconds * 1000.0 << " ms, "
+				<< stats.megabytesPerSecond() << " MB/s on " << stats.threads << " threads";
+			fitMesh(levels[0], radius);
+			//A model can cover parts of itself, so it also gets the overdraw order.
+			optimizeMesh(levels[0], false, true);
+		}
+		else
+		{
+			//Fall back to the sphere, so there is still something to look at.
+			generateSphere(sphereMode, radius, sphereMode == SPHERE_ICOSPHERE ? icosphereSubdivisions : sphereDivisions, levels[0]);
 		}
-		pitch += pitchDelta;
+		mesh = scene.addMesh();
+		scene.drawables[mesh].initBuffer(levels, errors, program, spherePositions, sphereNormals);
+	}
+	else
+	{
+		mesh = scene.addMesh();
+		buildSphereMesh(scene.drawables[mesh], radius, sphereLOD, program);
 	}
 
-	sphere1.base.initBuffer(vertexSet.size(), &vertexSet[0],program);
-	sphere1.origin = glm::vec3(0.0f, 0.0f, 0.0f);
-	sphere1.Translation = glm::translate(glm::mat4(1), sphere1.origin);
+	//Mostly refraction, some reflection and some lighting.
+	sphereObject = scene.create(mesh, glm::vec3(0.0f, 0.0f, 0.0f), radius, glm::vec4(0.5f, 0.2f, 0.75f, 0.5f));
 
+	//The other spheres share the mesh and stand still behind the first one, each with a material of its own.
+	srand(2);
+	for (int i = 1; i < sphereCount; i++)
+	{
+		glm::vec3 center(rand() / (float)RAND_MAX * 8.0f - 4.0f, rand() / (float)RAND_MAX * 8.0f - 4.0f, -2.0f - rand() / (float)RAND_MAX * 20.0f);
+		float glassiness = rand() / (float)RAND_MAX;
+		scene.create(mesh, center, radius, glm::vec4(0.5f + 0.3f * glassiness, 0.6f - 0.4f * glassiness, 0.25f + 0.5f * glassiness, 0.5f));
+	}
 }
 
-void setupSkyBox()
+//Scatters beadCount glass beads behind the sphere, each with its own size and material, and uploads them as instances of one mesh.
+void setupBeads()
 {
-	std::vector<VertexFormat> vertexSet;
-
-	vertexSet.clear();
-
-	// Setup the skybox
-	//xy plane (+z axis)
-	vertexSet.push_back(VertexFormat(glm::vec3(1.0f, 1.0f, -1.0f), glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(-1.0f, 1.0f, -1.0f), glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(0)));
-
-	vertexSet.push_back(VertexFormat(glm::vec3(1.0f, 1.0f, -1.0f),  glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(-1.0f, -1.0f, -1.0f),glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(1.0f, -1.0f, -1.0f), glm::vec3(0)));
-
-	//xy plane (-z axis)
-	vertexSet.push_back(VertexFormat(glm::vec3(1.0f, 1.0f, -1.0f), glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(-1.0f, 1.0f, -1.0f), glm::vec3(0)));
-
-	vertexSet.push_back(VertexFormat(glm::vec3(1.0f, 1.0f, -1.0f), glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(1.0f, -1.0f, -1.0f), glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(0)));
-
-	//yz plane (+x axis)
-	vertexSet.push_back(VertexFormat(glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(1.0f, 1.0f, -1.0f), glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(1.0f, -1.0f, -1.0f), glm::vec3(0)));
-
-	vertexSet.push_back(VertexFormat(glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(1.0f, -1.0f, -1.0f), glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(1.0f, -1.0f, 1.0f), glm::vec3(0)));
-
-	//yz plane (-x axis)
-	vertexSet.push_back(VertexFormat(glm::vec3(-1.0f, 1.0f, 1.0f), glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(-1.0f, -1.0f, 1.0f), glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(0)));
-
-	vertexSet.push_back(VertexFormat(glm::vec3(-1.0f, 1.0f, 1.0f),  glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(-1.0f, 1.0f, -1.0f), glm::vec3(0)));
-
-	//xz plane (+y axis)
-	vertexSet.push_back(VertexFormat(glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(-1.0f, 1.0f, 1.0f), glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(-1.0f, 1.0f, -1.0f), glm::vec3(0)));
-
-	vertexSet.push_back(VertexFormat(glm::vec3(1.0f, 1.0f, 1.0f), glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(-1.0f, 1.0f, -1.0f),glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(1.0f, 1.0f, -1.0f),  glm::vec3(0)));
-
-	//xz plane (-y axis)
-	vertexSet.push_back(VertexFormat(glm::vec3(1.0f, -1.0f, 1.0f),  glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(1.0f, -1.0f, -1.0f),  glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(0)));
-
-	vertexSet.push_back(VertexFormat(glm::vec3(1.0f, -1.0f, 1.0f),  glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(-1.0f, -1.0f, -1.0f), glm::vec3(0)));
-	vertexSet.push_back(VertexFormat(glm::vec3(-1.0f, -1.0f, 1.0f), glm::vec3(0)));
-
-	skyBox.initBuffer(vertexSet.size(), &vertexSet[0],programSB);
+	buildSphereMesh(beadMesh, 1.0f, true, programInstanced);
+	beadLOD = 0;
+
+	//The same beads every run.
+	srand(1);
+	std::vector<SphereInstance>& beads = beadInstances;
+	beads.resize(beadCount);
+	beadBounds.resize(beadCount);
+	float largestAngle = 0.0f;
+	for (int i = 0; i < beadCount; i++)
+	{
+		glm::vec3 center(rand() / (float)RAND_MAX * 6.0f - 3.0f, rand() / (float)RAND_MAX * 6.0f - 3.0f, -1.0f - rand() / (float)RAND_MAX * 11.0f);
+		float radius = 0.02f + rand() / (float)RAND_MAX * 0.04f;
+		beads[i].model = glm::scale(glm::translate(glm::mat4(1), center), glm::vec3(radius));
+		beadBounds.set(i, center, radius);
+
+		//From glass (refracting) to mirror-like (reflecting), around the look of the main sphere.
+		float glassiness = rand() / (float)RAND_MAX;
+		beads[i].material = glm::vec4(0.5f + 0.3f * glassiness, 0.6f - 0.4f * glassiness, 0.25f + 0.5f * glassiness, 0.5f);
+
+		//The camera does not move, so the bead which looks the largest is always the same one.
+		float angle = radius / glm::length(center - cameraPosition);
+		if (angle > largestAngle)
+		{
+			largestAngle = angle;
+			nearestBeadCenter = center;
+			nearestBeadRadius = radius;
+		}
+	}
+	if (gpuCulling)
+	{
+		//The instance buffer of the mesh gets a part for every level of detail, the compute shader fills them with the visible beads.
+		beadMesh.initInstanceBuffer(beadCount * (int)std::min(beadMesh.lods.size(), (size_t)GPU_CULLING_MAX_LODS), NULL, programInstanced);
+		beadCulling.init(beadMesh, &beads[0], beadCount, 1.0f, programCull);
+	}
+	else
+		beadMesh.initInstanceBuffer(beadCount, &beads[0], programInstanced);
+}
+
+//Starts streaming an environment in, see CubeMapStream.h.
+bool startEnvironment(int index)
+{
+	if (!environments[index].start(environmentFaces[index], std::max(1, jobThreads - 1), &textureUploader, cubeMapAnisotropy))
+	{
+		std::cout << "\n Can't read the size of " << environmentFaces[index][0];
+		return false;
+	}
+	//The stream bound its texture directly.
+	glState.invalidate();
+	return true;
 }
 
 void setup()
 {
+	//The skybox needs no vertices either, see VertexShaderSkyBox.glsl.
+	glGenVertexArrays(1, &emptyVAO);
 	setupSphere();
-	setupSkyBox();
-
-	camPosUniform = glGetUniformLocation(program, "camPos");
+	if (beadCount > 0)
+		setupBeads();
 
-	PV = glm::perspective(45.0f, 1.0f, 0.01f, 100.0f) * glm::lookAt(glm::vec3(0.0f, 0.0f, 2.0f), glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	view = glm::lookAt(cameraPosition, glm::vec3(0.0f, 0.0f, 0.0f), glm::vec3(0.0f, 1.0f, 0.0f));
+	projection = glm::perspective(45.0f, 1.0f, 0.01f, 100.0f);
+	PV = projection * view;
 	
-	//Set up the texture.
-	glGenTextures(1, &skybox);
+	//Set up the texture. Streamed, the faces are decoded by threads of their own and renderScene() uploads them; otherwise the six faces
+	//are decoded on the job threads and uploaded here as each one is ready.
 	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, skybox);
-
-	const char * suffixes[] = { "posx", "negx", "posy", "negy", "posz", "negz" };
-
-	GLuint targets[] = {
-		GL_TEXTURE_CUBE_MAP_POSITIVE_X,
-		GL_TEXTURE_CUBE_MAP_NEGATIVE_X,
-		GL_TEXTURE_CUBE_MAP_POSITIVE_Y,
-		GL_TEXTURE_CUBE_MAP_NEGATIVE_Y,
-		GL_TEXTURE_CUBE_MAP_POSITIVE_Z,
-		GL_TEXTURE_CUBE_MAP_NEGATIVE_Z };
-
-	GLint w, h;
-
-	unsigned char *data;
-
-	//send the 6 textures for the cube maps
-	for (int i = 0; i < 6; i++) {
-		std::string texName = (std::string)suffixes[i] +".jpg";
-		data = SOIL_load_image(texName.c_str(), &w, &h, 0, SOIL_LOAD_RGBA);
-		glTexImage2D(targets[i], 0, GL_RGBA, w, h, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-		SOIL_free_image_data(data);
+	if (!textureUploader.init())
+		std::cout << "\n No ARB_buffer_storage, textures are uploaded from client memory";
+	if (streamSkybox && startEnvironment(0))
+		skybox = environments[0].texture;
+	else
+	{
+		CubeMapLoadTimes cubeMapTimes;
+		skybox = loadCubeMap(jobs, environmentFaces[0], cubeMapTimes, cubeMapAnisotropy);
+		cubeMapTimes.print();
 	}
-
-	// Typical cube map settings
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER,
-		GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER,
-		GL_LINEAR);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S,
-		GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T,
-		GL_CLAMP_TO_EDGE);
-	glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R,
-		GL_CLAMP_TO_EDGE);
+	//The loader bound the texture directly.
+	glState.invalidate();
 }
 
 // Functions called only once every time the program is executed.
 #pragma region Helper_functions
-std::string readShader(std::string fileName)
+//Reads a shader file. With uniformBlocks, the uniform blocks of UniformBlocks.glsl are put in after its #version line.
+std::string readShader(std::string fileName, bool uniformBlocks = false)
 {
 	std::string shaderCode;
 	std::string line;
@@ -372,9 +452,21 @@ std::string readShader(std::string fileName)
 	// The size parameter is an integer that determines the number of characters to be read/written from/to the memory block.
 	file.read(&shaderCode[0], shaderCode.size());	// Reads from the file (starting at the "get" position which is currently at the start of the file) and writes that data to the beginning
 	// of the shaderCode variable, up until the full size of shaderCode. This is done with binary data, which is why we must ensure that the sizes are all correct.
+	// In text mode Windows turns every \r\n into \n, so fewer characters may have been read than the file has bytes.
+	shaderCode.resize((size_t)file.gcount());
 
 	file.close(); // Now that we're done, close the file and return the shaderCode.
 
+	// #version has to be the first thing the compiler sees, so the blocks go right after its line. The #line after them makes the
+	// compiler count the lines of this file again, so its messages still point at the right line.
+	size_t version = shaderCode.find("#version");
+	size_t versionEnd = (version == std::string::npos) ? std::string::npos : shaderCode.find('\n', version);
+	if (uniformBlocks && versionEnd != std::string::npos)
+	{
+		int nextLine = (int)std::count(shaderCode.begin(), shaderCode.begin() + versionEnd, '\n') + 2;
+		shaderCode.insert(versionEnd + 1, readShader("UniformBlocks.glsl") + "\n#line " + std::to_string(nextLine) + "\n");
+	}
+
 	return shaderCode;
 }
 
@@ -423,15 +515,22 @@ void init()
 	// Initializes the glew library
 	glewInit();
 
+	// The worker threads of the jobs which build every frame.
+	jobs.start(jobThreads);
+
 	// Enables the depth test, which you will want in most cases. You can disable this in the render loop if you need to.
-	glEnable(GL_DEPTH_TEST);
+	glState.enable(GL_DEPTH_TEST);
+
+	// Filters the cube maps across the edges of their faces, instead of clamping each face on its own, which shows seams in the
+	// smaller mip levels.
+	glState.enable(GL_TEXTURE_CUBE_MAP_SEAMLESS);
 
 	// Read in the shader code from a file.
-	std::string vertShader = readShader("VertexShader.glsl");
-	std::string fragShader = readShader("FragmentShader.glsl");
+	std::string vertShader = readShader("VertexShader.glsl", true);
+	std::string fragShader = readShader("FragmentShader.glsl", true);
 
 	std::string SBvertShader = readShader("VertexShaderSkyBox.glsl");
-	std::string SBfragShader = readShader("FragmentShaderSkyBox.glsl");
+	std::string SBfragShader = readShader("FragmentShaderSkyBox.glsl", true);
 
 	// createShader consolidates all of the shader compilation code
 	vertex_shader = createShader(vertShader, GL_VERTEX_SHADER);
@@ -457,12 +556,60 @@ void init()
 	// This links the program, using the vertex and fragment shaders to create executables to run on the GPU.
 	glLinkProgram(programSB);
 
+	if (spherePath == PATH_IMPOSTOR)
+	{
+		vertex_shaderImpostor = createShader(readShader("VertexShaderImpostor.glsl", true), GL_VERTEX_SHADER);
+		fragment_shaderImpostor = createShader(readShader("FragmentShaderImpostor.glsl", true), GL_FRAGMENT_SHADER);
+
+		programImpostor = glCreateProgram();
+		glAttachShader(programImpostor, vertex_shaderImpostor);
+		glAttachShader(programImpostor, fragment_shaderImpostor);
+		glLinkProgram(programImpostor);
+	}
+
+	if (beadCount > 0)
+	{
+		vertex_shaderInstanced = createShader(readShader("VertexShaderInstanced.glsl", true), GL_VERTEX_SHADER);
+		fragment_shaderInstanced = createShader(readShader("FragmentShaderInstanced.glsl"), GL_FRAGMENT_SHADER);
+
+		programInstanced = glCreateProgram();
+		glAttachShader(programInstanced, vertex_shaderInstanced);
+		glAttachShader(programInstanced, fragment_shaderInstanced);
+		glLinkProgram(programInstanced);
+
+		if (gpuCulling)
+		{
+			compute_shaderCull = createShader(readShader("ComputeShaderCulling.glsl"), GL_COMPUTE_SHADER);
+			programCull = glCreateProgram();
+			glAttachShader(programCull, compute_shaderCull);
+			glLinkProgram(programCull);
+		}
+	}
+
+	if (spherePath == PATH_TESSELLATION)
+	{
+		// The tessellation program has two more stages between the vertex and the fragment shader.
+		vertex_shaderTess = createShader(readShader("VertexShaderTess.glsl"), GL_VERTEX_SHADER);
+		tess_control_shader = createShader(readShader("TessControlShader.glsl", true), GL_TESS_CONTROL_SHADER);
+		tess_evaluation_shader = createShader(readShader("TessEvalShader.glsl", true), GL_TESS_EVALUATION_SHADER);
+
+		programTess = glCreateProgram();
+		glAttachShader(programTess, vertex_shaderTess);
+		glAttachShader(programTess, tess_control_shader);
+		glAttachShader(programTess, tess_evaluation_shader);
+		glAttachShader(programTess, fragment_shader);
+		glLinkProgram(programTess);
+
+		uniTessDetail = glGetUniformLocation(programTess, "tessDetail");
+
+		// Every patch is one triangle of the base mesh.
+		glPatchParameteri(GL_PATCH_VERTICES, 3);
+	}
+
 
-	// This gets us a reference to the uniform variable in the vertex shader, which is called "MVP".
-	// We're using this variable as a 4x4 transformation matrix
-	// Only 2 parameters required: A reference to the shader program and the name of the uniform variable within the shader code.
-	uniPV = glGetUniformLocation(program, "PV");
-	uniTranslation = glGetUniformLocation(program, "translation");
+	// The shaders find the camera at FRAME_UNIFORM_BINDING and the values of the object at OBJECT_UNIFORM_BINDING (layout(binding = ...) in the shaders),
+	// so there are no uniform locations to look up.
+	uniformBuffers.init();
 
 	// This is not necessary, but I prefer to handle my vertices in the clockwise order. glFrontFace defines which face of the triangles you're drawing is the front.
 	// Essentially, if you draw your vertices in counter-clockwise order, by default (in OpenGL) the front face will be facing you/the screen. If you draw them clockwise, the front face 
@@ -472,7 +619,7 @@ void init()
 
 	// This is also not necessary, but more efficient and is generally good practice. By default, OpenGL will render both sides of a triangle that you draw. By enabling GL_CULL_FACE, 
 	// we are telling OpenGL to only render the front face. This means that if you rotated the triangle over the X-axis, you wouldn't see the other side of the triangle as it rotated.
-	glEnable(GL_CULL_FACE);
+	glState.enable(GL_CULL_FACE);
 
 	// Determines the interpretation of polygons for rasterization. The first parameter, face, determines which polygons the mode applies to.
 	// The face can be either GL_FRONT, GL_BACK, or GL_FRONT_AND_BACK
@@ -481,7 +628,7 @@ void init()
 	glPolygonMode(GL_FRONT, GL_FILL);
 	//glPolygonMode(GL_FRONT_AND_BACK, GL_LINE);
 
-	glEnable(GL_BLEND);
+	glState.enable(GL_BLEND);
 	glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
 }
 
@@ -495,10 +642,143 @@ void update()
 	double x, y;
 	glfwGetCursorPos(window, &x, &y);
 
-	sphere1.origin.x = ((x / 800.0f)*2.0f) - 1.0f;
-	sphere1.origin.y = -(((y / 800.0f)*2.0f) - 1.0f);
+	scene.setPosition(sphereObject, glm::vec3(((x / 800.0f)*2.0f) - 1.0f, -(((y / 800.0f)*2.0f) - 1.0f), 0.0f));
 
-	sphere1.Translation = glm::translate(glm::mat4(1), sphere1.origin);
+	//E starts loading the next environment, unless one is loading already.
+	bool switchKey = glfwGetKey(window, GLFW_KEY_E) == GLFW_PRESS;
+	if (switchKey && !switchKeyDown && loadingEnvironment < 0)
+	{
+		int next = (currentEnvironment + 1) % ENVIRONMENT_COUNT;
+		if (startEnvironment(next))
+			loadingEnvironment = next;
+	}
+	switchKeyDown = switchKey;
+
+	//Only the objects which moved get a new world matrix. The jobs compute them while renderScene() starts; the culling waits for them.
+	updateJob = jobs.parallelFor(scene.size(), OBJECTS_PER_JOB, [](int first, int last)
+	{
+		scene.updateWorldMatrices(first, last);
+	});
+	jobs.run(updateJob);
+}
+
+//The draws of the current frame, sorted by render state before they are submitted (see DrawList.h), and the framebuffer height they are drawn at.
+DrawList drawList;
+int frameHeight;
+
+//Every part of OBJECTS_PER_JOB objects has its own FrameRecorder: the objects of the part which passed the culling, and the commands
+//and draws recorded for them (see CommandList.h). The GL thread replays them all in the sorted order.
+struct FrameRecorder
+{
+	std::vector<GLuint> visible;
+	CommandList commands;
+	DrawList draws;
+};
+std::vector<FrameRecorder> recorders;
+FrameRecorder mainRecorder;			//The skybox and the beads, recorded on the GL thread
+glm::vec4 objectPlanes[6];			//The frustum the objects are culled against in this frame
+
+//Commands which are not part of a draw, replayed before the draw list.
+CommandList frameCommands;
+
+//With --stats, the counters of glState are printed about once a second.
+bool printStats = false;
+double lastStatsTime = 0.0;
+
+//The beads which passed the CPU culling in this frame, with their instances at the front of the instance buffer.
+int visibleBeadCount;
+
+//Culls the objects of part number part of the scene.
+void cullObjects(int part)
+{
+	int first = part * OBJECTS_PER_JOB;
+	cullSpheres(objectPlanes, scene.bounds, first, std::min(scene.size(), first + OBJECTS_PER_JOB), recorders[part].visible);
+}
+
+//Fills in the object uniforms of the visible objects of the part, picks their level of detail and records their draws.
+//Nothing here calls OpenGL, and every object is only written by the job recording it, so the parts can be recorded on different threads.
+void recordObjects(int part)
+{
+	FrameRecorder& recorder = recorders[part];
+	CommandList& commands = recorder.commands;
+	for (size_t v = 0; v < recorder.visible.size(); v++)
+	{
+		int i = recorder.visible[v];
+		ObjectUniforms& object = uniformBuffers.object(i);
+		object.translation = scene.worldMatrices[i];
+		object.material = scene.materials[i];
+		object.center = scene.positions[i];
+		object.radius = scene.radii[i];
+		if (scene.meshes[i] != NO_MESH)
+			setVertexLayout(object, scene.drawables[scene.meshes[i]].layout);
+
+		// The draw only binds its part of the object buffer, which is uploaded once all the objects are recorded.
+		size_t begin = commands.size();
+		commands.bindUniformBuffer(OBJECT_UNIFORM_BINDING, uniformBuffers.objectBuffer, uniformBuffers.objectOffset(i), sizeof(ObjectUniforms));
+		float distance = glm::length(scene.positions[i] - cameraPosition);
+		if (spherePath == PATH_IMPOSTOR)
+		{
+			commands.draw(GL_TRIANGLE_STRIP, 0, 4);
+			recorder.draws.add(PASS_OPAQUE, programImpostor, skybox, emptyVAO, distance, commands, begin);
+		}
+		else if (spherePath == PATH_TESSELLATION)
+		{
+			const stuff_for_drawing& mesh = scene.drawables[scene.meshes[i]];
+			commands.drawIndexed(GL_PATCHES, mesh.numberOfIndices, mesh.indexType, 0, 0);
+			recorder.draws.add(PASS_OPAQUE, programTess, skybox, mesh.vao, distance, commands, begin);
+		}
+		else
+		{
+			// Pick the level of detail from the size of the sphere on screen, and draw the sphere using its index buffer
+			const stuff_for_drawing& mesh = scene.drawables[scene.meshes[i]];
+			float radiusInPixels = projectedRadius(PV, scene.positions[i], scene.radii[i], (float)frameHeight);
+			scene.lods[i] = selectLOD(mesh.lods, radiusInPixels, scene.lods[i], maxPixelError, 0.75f);
+			const MeshLOD& lod = mesh.lods[scene.lods[i]];
+			commands.drawIndexed(GL_TRIANGLES, lod.indexCount, mesh.indexType, lod.firstIndex, lod.baseVertex);
+			recorder.draws.add(PASS_OPAQUE, program, skybox, mesh.vao, distance, commands, begin);
+		}
+	}
+}
+
+//The skybox, drawn after the opaque objects. Its vertex shader puts it at the far plane, where GL_LEQUAL only lets it through the pixels
+//no object has written, so the depth test rejects the covered ones before they are shaded. It does not need to write depth itself.
+void recordSkyBox(FrameRecorder& recorder)
+{
+	size_t begin = recorder.commands.size();
+	recorder.commands.setDepthWrite(false);
+	recorder.commands.setDepthFunc(GL_LEQUAL);
+	recorder.commands.draw(GL_TRIANGLES, 0, 3);
+	recorder.commands.setDepthFunc(GL_LESS);
+	recorder.commands.setDepthWrite(true);
+	recorder.draws.add(PASS_SKY, programSB, skybox, emptyVAO, 0.0f, recorder.commands, begin);
+}
+
+//Every bead in a single draw call. The model matrix and material of each one come from the instance buffer.
+void recordBeads(FrameRecorder& recorder, int object)
+{
+	// The beads take their transformation and material from the instance buffer, only the vertex layout of their own object uniforms is used.
+	ObjectUniforms& uniforms = uniformBuffers.object(object);
+	uniforms.translation = glm::mat4(1);
+	setVertexLayout(uniforms, beadMesh.layout);
+
+	CommandList& commands = recorder.commands;
+	size_t begin = commands.size();
+	commands.bindUniformBuffer(OBJECT_UNIFORM_BINDING, uniformBuffers.objectBuffer, uniformBuffers.objectOffset(object), sizeof(ObjectUniforms));
+	if (gpuCulling)
+	{
+		// One command per level of detail, with the visible beads of that level as its instances.
+		beadCulling.record(commands);
+	}
+	else
+	{
+		// One level of detail for all of them, good enough for the one which looks the largest.
+		float radiusInPixels = projectedRadius(PV, nearestBeadCenter, nearestBeadRadius, (float)frameHeight);
+		beadLOD = selectLOD(beadMesh.lods, radiusInPixels, beadLOD, maxPixelError, 0.75f);
+		const MeshLOD& lod = beadMesh.lods[beadLOD];
+		if (visibleBeadCount > 0)
+			commands.drawIndexed(GL_TRIANGLES, lod.indexCount, beadMesh.indexType, lod.firstIndex, lod.baseVertex, visibleBeadCount, 0);
+	}
+	recorder.draws.add(PASS_OPAQUE, programInstanced, skybox, beadMesh.vao, glm::length(nearestBeadCenter - cameraPosition), commands, begin);
 }
 
 // This function runs every frame
@@ -510,39 +790,247 @@ void renderScene()
 	// Clear the screen to white
 	glClearColor(0.3, 0.3, 0.3, 1.0);
 
-	//render the skubox
-	glUseProgram(programSB);
-	//Disable depth buffer
-	glDepthMask(GL_FALSE);
-	glBindVertexArray(skyBox.vao);
-	glActiveTexture(GL_TEXTURE0);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, skybox);
-	glDrawArrays(GL_TRIANGLES, 0, skyBox.numberOfVertices);
-	//Enable the depth buffer
-	glDepthMask(GL_TRUE);
-	glBindVertexArray(0);
-
-	// Tell OpenGL to use the shader program you've created.
-	glUseProgram(program);
-	glBindVertexArray(sphere1.base.vao);
-	glBindTexture(GL_TEXTURE_CUBE_MAP, skybox);
-	glUniformMatrix4fv(uniPV, 1, GL_FALSE, glm::value_ptr(PV));						//Set the uniform PV
-	glUniformMatrix4fv(uniTranslation, 1, GL_FALSE, glm::value_ptr(sphere1.Translation));
-	glUniform3f(camPosUniform, 0.0f, 0.0f, 2.0f);									//Set the uniform cameraPosition
-	glDrawArrays(GL_TRIANGLES, 0, sphere1.base.numberOfVertices);					// Draw the sphere
-	glBindVertexArray(0);
-	//Do the same for the second sphere
+	int width;
+	glfwGetFramebufferSize(window, &width, &frameHeight);
+	glState.beginFrame();
+
+	// The next levels of the skybox, while it is still streaming in, and of the environment which replaces it once it is complete.
+	if (!environments[currentEnvironment].finished())
+		environments[currentEnvironment].update(glState);
+	if (loadingEnvironment >= 0)
+	{
+		environments[loadingEnvironment].update(glState);
+		if (environments[loadingEnvironment].finished())
+		{
+			if (environments[currentEnvironment].texture == skybox)
+				environments[currentEnvironment].release();
+			else
+				glDeleteTextures(1, &skybox);
+			skybox = environments[loadingEnvironment].texture;
+			currentEnvironment = loadingEnvironment;
+			loadingEnvironment = -1;
+			// The old name may be handed out again.
+			glState.invalidate();
+		}
+	}
+	if (textureUploader.ready())
+		textureUploader.update();
+
+	glm::vec3 camPos = cameraPosition;
+
+	if (beadCount > 0)
+	{
+		// The culling runs before the draw list is submitted: the compute shader binds its own program and buffers.
+		if (gpuCulling)
+		{
+			beadCulling.cull(PV, (float)frameHeight, maxPixelError);
+			glState.invalidate();
+		}
+		else
+		{
+			// Cull the bounding spheres on the CPU, and upload the instances of the visible beads to the front of the instance buffer.
+			glm::vec4 planes[6];
+			frustumPlanes(PV, planes);
+			visibleBeadCount = cullSpheres(planes, beadBounds, visibleBeads);
+			visibleBeadInstances.resize(visibleBeadCount);
+			for (int i = 0; i < visibleBeadCount; i++)
+				visibleBeadInstances[i] = beadInstances[visibleBeads[i]];
+			if (visibleBeadCount > 0)
+			{
+				glBindBuffer(GL_ARRAY_BUFFER, beadMesh.instanceVbo);
+				glBufferSubData(GL_ARRAY_BUFFER, 0, visibleBeadCount * sizeof(SphereInstance), &visibleBeadInstances[0]);
+				glBindBuffer(GL_ARRAY_BUFFER, 0);
+			}
+		}
+	}
+
+	// The camera for every program, in one upload.
+	FrameUniforms frame;
+	frame.view = view;
+	frame.projection = projection;
+	frame.PV = PV;
+	frame.inversePV = glm::inverse(PV);
+	frame.camPos = camPos;
+	frame.time = (float)glfwGetTime();
+	uniformBuffers.setFrame(frame);
+
+	// The objects are culled and recorded in parts by the jobs, after update() has moved them, while this thread goes on with the GL calls.
+	// The beads get the object uniforms after the scene objects.
+	int objectCount = scene.size();
+	int partCount = (objectCount + OBJECTS_PER_JOB - 1) / OBJECTS_PER_JOB;
+	if ((int)recorders.size() < partCount)
+		recorders.resize(partCount);
+	for (int p = 0; p < partCount; p++)
+	{
+		recorders[p].commands.clear();
+		recorders[p].draws.clear();
+	}
+	uniformBuffers.beginObjects(objectCount + (beadCount > 0 ? 1 : 0));
+	frustumPlanes(PV, objectPlanes);
+
+	Job* cullJob = jobs.parallelFor(partCount, 1, [](int first, int last)
+	{
+		for (int p = first; p < last; p++)
+			cullObjects(p);
+	});
+	Job* recordJob = jobs.parallelFor(partCount, 1, [](int first, int last)
+	{
+		for (int p = first; p < last; p++)
+			recordObjects(p);
+	});
+	// One list for the whole frame, sorted once. The objects come first, sorted by state and then front to back, the skybox after them.
+	Job* sortJob = jobs.create([partCount]()
+	{
+		drawList.clear();
+		drawList.append(mainRecorder.draws);
+		for (int p = 0; p < partCount; p++)
+			drawList.append(recorders[p].draws);
+		drawList.sort();
+	});
+	if (updateJob)
+		jobs.addDependency(cullJob, updateJob);
+	jobs.addDependency(recordJob, cullJob);
+	jobs.addDependency(sortJob, recordJob);
+	jobs.run(cullJob);
+	jobs.run(recordJob);
+
+	// The skybox and the beads are recorded here, the sort can start once they are.
+	mainRecorder.commands.clear();
+	mainRecorder.draws.clear();
+	recordSkyBox(mainRecorder);
+	if (beadCount > 0)
+		recordBeads(mainRecorder, objectCount);
+	jobs.run(sortJob);
+
+	frameCommands.clear();
+	if (spherePath == PATH_TESSELLATION)
+	{
+		// The icosahedron is refined on the GPU. tessDetail turns the length of an edge over its distance to the camera into a number of segments,
+		// using the vertical scale of the projection (the length of the second row of PV) and the size of the viewport.
+		// glProgramUniform sets it without binding the program, so the draw list stays the only place which binds programs.
+		float projectionScale = glm::length(glm::vec3(PV[0][1], PV[1][1], PV[2][1]));
+		frameCommands.setUniform(programTess, uniTessDetail, projectionScale * frameHeight * 0.5f / tessPixelsPerSegment);
+	}
+	frameCommands.replay(glState);
+
+	// The values of every object in one upload, once they are all recorded. The draws only bind their part of the buffer.
+	jobs.wait(recordJob);
+	uniformBuffers.uploadObjects();
+
+	jobs.wait(sortJob);
+	updateJob = NULL;
+	drawList.submit(glState);
+
+	if (printStats && glfwGetTime() - lastStatsTime > 1.0)
+	{
+		lastStatsTime = glfwGetTime();
+		size_t commandBytes = frameCommands.size() + mainRecorder.commands.size();
+		for (int p = 0; p < partCount; p++)
+			commandBytes += recorders[p].commands.size();
+		std::cout << "\n " << drawList.commands.size() << " draws recorded on " << jobs.threadCount() << " threads into " << commandBytes << " bytes of commands, "
+			<< uniformBuffers.bytesUploaded << " bytes of uniforms uploaded, "
+			<< glState.totalIssued() << " state calls issued, " << glState.totalSkipped() << " skipped";
+		glState.printCounters();
+		jobs.printCounters();
+	}
 }
 
 #pragma endregion Helper_functions
 
 
-void main()
+void main(int argc, char* argv[])
 {
+	//Command line options:
+	//	--divisions N	builds a UV sphere with N rings and N segments
+	//	--icosphere N	builds the sphere by subdividing an icosahedron N times
+	//	--lod uv|ico	builds a chain of UV spheres or icospheres and picks the level from the size on screen (the default)
+	//	--tessellation	uploads an icosahedron and refines it with the tessellation shaders (needs OpenGL 4.0)
+	//	--impostor		draws the sphere as a ray traced quad
+	//	--positions float|snorm16|half			how the mesh path stores positions (snorm16 by default)
+	//	--normals float|oct16|oct8|2_10_10_10	how the mesh path stores normals (oct16 by default)
+	//	--model FILE	draws an OBJ or binary PLY model instead of the sphere
+	//	--instances N	draws a field of N glass beads behind the sphere with one instanced draw call
+	//	--spheres N		puts N spheres into the scene, each one drawn with its own draw call
+	//	--threads N		builds the frame on N threads (all the hardware threads by default)
+	//	--no-gpu-culling	culls the beads on the CPU with SSE/AVX and draws them at the same level of detail, instead of using a compute shader
+	//	--no-cache		always generates the sphere instead of loading it from the mesh cache
+	//	--no-stream		loads the whole skybox before the first frame instead of streaming it in
+	//	--anisotropy N	samples the skybox with up to N times anisotropic filtering
+	//	--stats			prints how many GL state calls were issued and skipped every second
+	//	--benchmark		runs the benchmarks in Benchmarks.cpp and exits
+	bool benchmark = false;
+	for (int i = 1; i < argc; i++)
+	{
+		if (strcmp(argv[i], "--divisions") == 0 && i + 1 < argc)
+		{
+			sphereMode = SPHERE_UV;
+			sphereLOD = false;
+			sphereDivisions = std::max(3, atoi(argv[++i]));
+		}
+		else if (strcmp(argv[i], "--icosphere") == 0 && i + 1 < argc)
+		{
+			sphereMode = SPHERE_ICOSPHERE;
+			sphereLOD = false;
+			icosphereSubdivisions = std::min(std::max(0, atoi(argv[++i])), 9);
+		}
+		else if (strcmp(argv[i], "--lod") == 0 && i + 1 < argc)
+		{
+			sphereMode = (strcmp(argv[++i], "ico") == 0) ? SPHERE_ICOSPHERE : SPHERE_UV;
+			sphereLOD = true;
+		}
+		else if (strcmp(argv[i], "--tessellation") == 0)
+			spherePath = PATH_TESSELLATION;
+		else if (strcmp(argv[i], "--impostor") == 0)
+			spherePath = PATH_IMPOSTOR;
+		else if (strcmp(argv[i], "--positions") == 0 && i + 1 < argc)
+		{
+			i++;
+			spherePositions = (strcmp(argv[i], "float") == 0) ? POSITION_FLOAT : (strcmp(argv[i], "half") == 0) ? POSITION_HALF : POSITION_SNORM16;
+		}
+		else if (strcmp(argv[i], "--normals") == 0 && i + 1 < argc)
+		{
+			i++;
+			if (strcmp(argv[i], "float") == 0)
+				sphereNormals = NORMAL_FLOAT;
+			else if (strcmp(argv[i], "oct8") == 0)
+				sphereNormals = NORMAL_OCT8;
+			else if (strcmp(argv[i], "2_10_10_10") == 0)
+				sphereNormals = NORMAL_INT_2_10_10_10;
+			else
+				sphereNormals = NORMAL_OCT16;
+		}
+		else if (strcmp(argv[i], "--model") == 0 && i + 1 < argc)
+		{
+			modelPath = argv[++i];
+			spherePath = PATH_MESH;
+		}
+		else if (strcmp(argv[i], "--instances") == 0 && i + 1 < argc)
+			beadCount = std::max(0, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--spheres") == 0 && i + 1 < argc)
+			sphereCount = std::max(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+			jobThreads = std::max(1, atoi(argv[++i]));
+		else if (strcmp(argv[i], "--no-gpu-culling") == 0)
+			gpuCulling = false;
+		else if (strcmp(argv[i], "--no-cache") == 0)
+			useMeshCache = false;
+		else if (strcmp(argv[i], "--no-stream") == 0)
+			streamSkybox = false;
+		else if (strcmp(argv[i], "--anisotropy") == 0 && i + 1 < argc)
+			cubeMapAnisotropy = std::max(1.0f, (float)atof(argv[++i]));
+		else if (strcmp(argv[i], "--stats") == 0)
+			printStats = true;
+		else if (strcmp(argv[i], "--benchmark") == 0)
+			benchmark = true;
+	}
+
 	glfwInit();
 
 	// Creates a window given (width, height, title, monitorPtr, windowPtr).
 	// Don't worry about the last two, as they have to do with controlling which monitor to display on and having a reference to other windows. Leaving them as nullptr is fine.
+	// The benchmarks do not need to show anything. With a software OpenGL (LIBGL_ALWAYS_SOFTWARE=1 for Mesa's llvmpipe) they run on machines without a GPU too.
+	if (benchmark)
+		glfwWindowHint(GLFW_VISIBLE, GL_FALSE);
 	window = glfwCreateWindow(800, 800, "Reflection and refraction", nullptr, nullptr);
 
 	std::cout << "\n\n\n\n This program demonstrates the implementation of reflection adn refraction using skybox in the shaders.";
@@ -556,11 +1044,34 @@ void main()
 	glfwSwapInterval(0);
 
 	// Initializes most things needed before the main loop
+	double startupTime = glfwGetTime();
 	init();
+	double initTime = glfwGetTime();
 
 	setup();
+	double setupTime = glfwGetTime();
+	std::cout << "\n Startup: init (shaders, threads) " << (initTime - startupTime) * 1000.0 << " ms, setup (meshes, cube map) "
+		<< (setupTime - initTime) * 1000.0 << " ms";
+
+	if (benchmark)
+	{
+		// The benchmarks want the whole skybox.
+		environments[currentEnvironment].finish(glState);
+		runBenchmarks();
+		if (beadCount > 0 && gpuCulling)
+			benchmarkGpuCulling(beadCulling, PV, 800.0f, maxPixelError);
+		// One frame first, for the frame uniforms the skybox shader reads.
+		update();
+		renderScene();
+		benchmarkSkyBox(programSB, emptyVAO, 3, skybox);
+		benchmarkCubeMapFiltering(skybox);
+		benchmarkTextureUpload();
+		glfwTerminate();
+		return;
+	}
 
 	// Enter the main loop.
+	bool firstFrame = true;
 	while (!glfwWindowShouldClose(window))
 	{
 		// Call to update() which will update the gameobjects.
@@ -573,6 +1084,12 @@ void main()
 		// Remember, you're rendering to the back buffer, then once rendering is complete, you're moving the back buffer to the front so it can be displayed.
 		glfwSwapBuffers(window);
 
+		if (firstFrame)
+		{
+			std::cout << "\n First frame after " << (glfwGetTime() - startupTime) * 1000.0 << " ms";
+			firstFrame = false;
+		}
+
 		// Checks to see if any events are pending and then processes them.
 		glfwPollEvents();
 	}
@@ -581,6 +1098,36 @@ void main()
 	glDeleteShader(vertex_shader);
 	glDeleteShader(fragment_shader);
 	glDeleteProgram(program);
+	glDeleteVertexArrays(1, &emptyVAO);
+	uniformBuffers.release();
+	for (int i = 0; i < ENVIRONMENT_COUNT; i++)
+		environments[i].release();
+	textureUploader.release();
+	if (beadCount > 0)
+	{
+		glDeleteShader(vertex_shaderInstanced);
+		glDeleteShader(fragment_shaderInstanced);
+		glDeleteProgram(programInstanced);
+		if (gpuCulling)
+		{
+			beadCulling.release();
+			glDeleteShader(compute_shaderCull);
+			glDeleteProgram(programCull);
+		}
+	}
+	if (spherePath == PATH_IMPOSTOR)
+	{
+		glDeleteShader(vertex_shaderImpostor);
+		glDeleteShader(fragment_shaderImpostor);
+		glDeleteProgram(programImpostor);
+	}
+	if (spherePath == PATH_TESSELLATION)
+	{
+		glDeleteShader(vertex_shaderTess);
+		glDeleteShader(tess_control_shader);
+		glDeleteShader(tess_evaluation_shader);
+		glDeleteProgram(programTess);
+	}
 	// Note: If at any point you stop using a "program" or shaders, you should free the data up then and there.
 
 